@@ -1,5 +1,7 @@
 #include "bind_count.hpp"
 
+#include <climits>
+
 BindCount::BindCount() : value_(0) {}
 
 int BindCount::get_value() {
@@ -15,6 +17,9 @@ bool BindCount::empty() const { return value_ == 0; }
 void BindCount::add_digit(int digit) {
     if (empty()) {
         value_ = digit;
+    } else if (value_ > (INT_MAX - digit) / 10) {
+        // Saturate instead of overflowing
+        value_ = INT_MAX;
     } else {
         value_ = (value_ * 10) + digit;
     }
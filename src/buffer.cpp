@@ -1,18 +1,28 @@
 #include "buffer.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <string>
+#include <utility>
 #include <vector>
 
-Buffer::Buffer() : position(0, 0) {}
+#include "buffer_observer.hpp"
+
+Buffer::Buffer() : position(0, 0), version_(0) {}
+
+const std::vector<std::string> &Buffer::get_lines() const { return lines_; }
 
 int Buffer::get_line_length(int row) {
-    return static_cast<int>(lines[row].length());
+    return static_cast<int>(lines_[row].length());
 }
 
-int Buffer::get_size() const { return static_cast<int>(lines.size()); }
+int Buffer::get_size() const { return static_cast<int>(lines_.size()); }
 
 int Buffer::get_first_non_blank(int row) {
-    std::string::size_type index = lines[row].find_first_not_of(" \t\r\n");
+    std::string::size_type index = lines_[row].find_first_not_of(" \t\r\n");
     if (index == std::string::npos) {
         // Either the line is empty or is only whitespace
         return get_line_length(row);
@@ -20,25 +30,209 @@ int Buffer::get_first_non_blank(int row) {
     return static_cast<int>(index);
 }
 
-void Buffer::set_line(const std::string &line, int row) { lines[row] = line; }
+void Buffer::set_lines(std::vector<std::string> new_lines) {
+    int removed = get_size();
+    lines_ = std::move(new_lines);
+    notify(0, removed, get_size());
+}
+
+void Buffer::set_line(const std::string &line, int row) {
+    lines_[row] = line;
+    notify(row, 1, 1);
+}
 
-void Buffer::push_back_line(const std::string &line) { lines.push_back(line); }
+void Buffer::push_back_line(const std::string &line) {
+    lines_.push_back(line);
+    notify(get_size() - 1, 0, 1);
+}
 
 void Buffer::insert_line(const std::string &line, int row) {
-    lines.insert(lines.begin() + row, line);
+    lines_.insert(lines_.begin() + row, line);
+    notify(row, 0, 1);
+}
+
+void Buffer::insert_lines(std::vector<std::string> new_lines, int row) {
+    lines_.insert(lines_.begin() + row,
+                  std::make_move_iterator(new_lines.begin()),
+                  std::make_move_iterator(new_lines.end()));
+    notify(row, 0, static_cast<int>(new_lines.size()));
 }
 
 void Buffer::add_string_to_line(const std::string &line, int row) {
-    lines[row] += line;
+    lines_[row] += line;
+    notify(row, 1, 1);
 }
 
 void Buffer::erase(int position, int length, int row) {
-    lines[row].erase(position, length);
+    lines_[row].erase(position, length);
+    notify(row, 1, 1);
 }
 
 void Buffer::insert_char(int position, int n, char character, int row) {
     // Fill line at row with character n times from a given position
-    lines[row].insert(position, n, character);
+    lines_[row].insert(position, n, character);
+    notify(row, 1, 1);
+}
+
+Position Buffer::insert_string(int position, const std::string &str,
+                               int row) {
+    return replace_range({row, position}, {row, position}, str);
+}
+
+Position Buffer::replace_range(const Position &start, const Position &end,
+                               const std::string &text) {
+    // Replace the text with a single splice of the line storage
+    std::string::size_type newline = text.find('\n');
+    if (newline == std::string::npos && start.y == end.y) {
+        lines_[start.y].replace(start.x, end.x - start.x, text);
+        notify(start.y, 1, 1);
+        return {start.y, start.x + static_cast<int>(text.length())};
+    }
+    std::vector<std::string> new_lines;
+    new_lines.push_back(lines_[start.y].substr(0, start.x));
+    std::string::size_type first = 0;
+    while (newline != std::string::npos) {
+        new_lines.back().append(text, first, newline - first);
+        new_lines.emplace_back();
+        first = newline + 1;
+        newline = text.find('\n', first);
+    }
+    new_lines.back().append(text, first, std::string::npos);
+    int end_x = static_cast<int>(new_lines.back().length());
+    new_lines.back().append(lines_[end.y], end.x, std::string::npos);
+    int end_y = start.y + static_cast<int>(new_lines.size()) - 1;
+    replace_lines(start.y, end.y, std::move(new_lines));
+    return {end_y, end_x};
+}
+
+void Buffer::remove_line(int row) {
+    lines_.erase(lines_.begin() + row);
+    notify(row, 1, 0);
+}
+
+void Buffer::remove_lines(int first, int last) {
+    lines_.erase(lines_.begin() + first, lines_.begin() + last + 1);
+    notify(first, last - first + 1, 0);
+}
+
+void Buffer::remove_lines(const std::vector<int> &rows) {
+    if (rows.empty()) {
+        return;
+    }
+    // Kept lines are moved over the removed lines before the end is erased
+    std::size_t kept = rows.front();
+    std::size_t next = 0;
+    for (std::size_t i = kept; i < lines_.size(); ++i) {
+        if (next < rows.size() && static_cast<std::size_t>(rows[next]) == i) {
+            ++next;
+        } else {
+            lines_[kept++] = std::move(lines_[i]);
+        }
+    }
+    lines_.erase(lines_.begin() + kept, lines_.end());
+    int span = rows.back() - rows.front() + 1;
+    notify(rows.front(), span, span - static_cast<int>(rows.size()), &rows);
 }
 
-void Buffer::remove_line(int row) { lines.erase(lines.begin() + row); }
+std::vector<std::string> Buffer::extract_lines(int first, int last) {
+    std::vector<std::string> extracted(
+        std::make_move_iterator(lines_.begin() + first),
+        std::make_move_iterator(lines_.begin() + last + 1));
+    remove_lines(first, last);
+    return extracted;
+}
+
+void Buffer::replace_lines(int first, int last,
+                           std::vector<std::string> new_lines) {
+    int count = last - first + 1;
+    int new_count = static_cast<int>(new_lines.size());
+    int kept = std::min(count, new_count);
+    std::move(new_lines.begin(), new_lines.begin() + kept,
+              lines_.begin() + first);
+    if (new_count < count) {
+        lines_.erase(lines_.begin() + first + kept, lines_.begin() + last + 1);
+    } else {
+        lines_.insert(lines_.begin() + first + kept,
+                      std::make_move_iterator(new_lines.begin() + kept),
+                      std::make_move_iterator(new_lines.end()));
+    }
+    notify(first, count, new_count);
+}
+
+void Buffer::reorder_lines(int first, int last, std::vector<int> rows) {
+    int count = last - first + 1;
+    int kept = static_cast<int>(rows.size());
+    // Rows that are removed are put after the kept rows, so that rows is the
+    // row that every position takes its line from
+    std::vector<bool> done(count, false);
+    for (int row : rows) {
+        done[row - first] = true;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!done[i]) {
+            rows.push_back(first + i);
+        }
+    }
+    // Lines are moved along the cycles of the permutation
+    std::fill(done.begin(), done.end(), false);
+    for (int start = 0; start < count; ++start) {
+        if (done[start]) {
+            continue;
+        }
+        std::string line = std::move(lines_[first + start]);
+        int position = start;
+        while (rows[position] - first != start) {
+            int source = rows[position] - first;
+            lines_[first + position] = std::move(lines_[first + source]);
+            done[position] = true;
+            position = source;
+        }
+        lines_[first + position] = std::move(line);
+        done[position] = true;
+    }
+    lines_.erase(lines_.begin() + first + kept, lines_.begin() + last + 1);
+    notify(first, count, kept);
+}
+
+void Buffer::move_lines(int first, int last, int row) {
+    // Moved lines are reported as removed and inserted again, so that
+    // observers do not have to update the lines in between
+    int count = last - first + 1;
+    std::vector<std::string> moved = extract_lines(first, last);
+    int target = row > last ? row - count : row;
+    lines_.insert(lines_.begin() + target,
+                  std::make_move_iterator(moved.begin()),
+                  std::make_move_iterator(moved.end()));
+    notify(target, 0, count);
+}
+
+std::vector<int> Buffer::change_lines(
+    const std::function<std::vector<int>(std::vector<std::string> &)> &edit) {
+    std::vector<int> rows = edit(lines_);
+    if (!rows.empty()) {
+        int span = rows.back() - rows.front() + 1;
+        notify(rows.front(), span, span, &rows);
+    }
+    return rows;
+}
+
+std::uint64_t Buffer::get_version() const { return version_; }
+
+void Buffer::add_observer(BufferObserver *observer) {
+    observers_.push_back(observer);
+}
+
+void Buffer::remove_observer(BufferObserver *observer) {
+    observers_.erase(
+        std::remove(observers_.begin(), observers_.end(), observer),
+        observers_.end());
+}
+
+void Buffer::notify(int first, int removed, int inserted,
+                    const std::vector<int> *rows) {
+    ++version_;
+    BufferChange change{first, removed, inserted, version_, rows};
+    for (BufferObserver *observer : observers_) {
+        observer->on_change(lines_, change);
+    }
+}
@@ -1,26 +1,74 @@
 #ifndef CLADITOR_BUFFER_HPP
 #define CLADITOR_BUFFER_HPP
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "buffer_observer.hpp"
 #include "position.hpp"
 
+// Lines of a file. Every change goes through the buffer, which tells its
+// observers what changed
 class Buffer {
    public:
     Position position;
-    std::vector<std::string> lines;
 
     Buffer();
+    const std::vector<std::string> &get_lines() const;
     int get_line_length(int);
     int get_size() const;
     int get_first_non_blank(int);
+    // Replace every line
+    void set_lines(std::vector<std::string>);
     void set_line(const std::string&, int);
     void push_back_line(const std::string&);
     void insert_line(const std::string&, int);
+    // Insert the lines before the row with a single splice
+    void insert_lines(std::vector<std::string>, int);
     void add_string_to_line(const std::string&, int);
     void erase(int, int, int);
     void insert_char(int, int, char, int);
+    Position insert_string(int, const std::string &, int);
+    // Replace the text from start up to end with text, which may contain new
+    // lines, and return the position after it
+    Position replace_range(const Position &, const Position &,
+                           const std::string &);
     void remove_line(int);
+    // Remove the lines from first to last inclusive
+    void remove_lines(int, int);
+    // Remove the given lines in increasing order, moving every line at most
+    // once
+    void remove_lines(const std::vector<int> &);
+    // Remove the lines from first to last inclusive and return them
+    std::vector<std::string> extract_lines(int, int);
+    // Replace the lines from first to last inclusive with the given lines,
+    // changing lines in place where the counts overlap
+    void replace_lines(int, int, std::vector<std::string>);
+    // Reorder the lines from first to last inclusive so that the given rows
+    // come first in order and remove the rows that are not given, moving
+    // every line once
+    void reorder_lines(int, int, std::vector<int>);
+    // Move the lines from first to last inclusive before the row, which is
+    // outside of them, as a removal and an insertion
+    void move_lines(int, int, int);
+    // Change lines in place with edit, which returns the rows it changed in
+    // increasing order, as one change and return the rows
+    std::vector<int> change_lines(
+        const std::function<std::vector<int>(std::vector<std::string> &)> &);
+    // Incremented whenever lines change
+    std::uint64_t get_version() const;
+    // Observers are told about every change until they are removed
+    void add_observer(BufferObserver *);
+    void remove_observer(BufferObserver *);
+
+   private:
+    std::vector<std::string> lines_;
+    std::uint64_t version_;
+    std::vector<BufferObserver *> observers_;
+
+    // Count the change as a new version and tell the observers about it
+    void notify(int, int, int, const std::vector<int> * = nullptr);
 };
 #endif
@@ -0,0 +1,3 @@
+#include "buffer_observer.hpp"
+
+BufferObserver::~BufferObserver() = default;
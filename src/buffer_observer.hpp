@@ -0,0 +1,31 @@
+#ifndef CLADITOR_BUFFER_OBSERVER_HPP
+#define CLADITOR_BUFFER_OBSERVER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lines of a buffer from first were replaced, the removed lines were taken out
+// and the inserted lines are in their place. A change in place removes and
+// inserts the same number of lines
+struct BufferChange {
+    int first;
+    int removed;
+    int inserted;
+    // Version of the buffer after the change
+    std::uint64_t version;
+    // Rows of a scattered change in increasing order, or nullptr. They are the
+    // removed rows if lines were removed and the changed rows otherwise, and
+    // all lie within the replaced lines, so they only narrow the change down
+    const std::vector<int> *rows;
+};
+
+// Structure derived from the lines of a buffer that follows its changes
+class BufferObserver {
+   public:
+    virtual ~BufferObserver();
+    // Called after every change with the lines after it
+    virtual void on_change(const std::vector<std::string> &,
+                           const BufferChange &) = 0;
+};
+#endif
@@ -0,0 +1,41 @@
+#include "change.hpp"
+
+#include <string>
+
+#include "keymap.hpp"
+
+Change::Change() : action(Action::NONE), count(1) {}
+
+Change::Change(Action action, int count) : action(action), count(count) {}
+
+bool Change::is_repeatable() const { return action != Action::NONE; }
+
+bool Change::is_insert() const {
+    switch (action) {
+        case Action::INSERT_MODE:
+        case Action::APPEND_AFTER_CURSOR:
+        case Action::APPEND_END_OF_LINE:
+        case Action::BEGIN_NEW_LINE_BELOW:
+        case Action::BEGIN_NEW_LINE_ABOVE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string Change::get_insert_text(int repeat_count) const {
+    // Return the text inserted by repeating the change repeat_count times
+    std::string unit = text;
+    if (action == Action::BEGIN_NEW_LINE_BELOW) {
+        unit = '\n' + text;
+    } else if (action == Action::BEGIN_NEW_LINE_ABOVE) {
+        unit = text + '\n';
+    }
+    std::string result;
+    result.reserve(unit.length() * static_cast<std::string::size_type>(
+                                       repeat_count));
+    for (int i = 0; i < repeat_count; ++i) {
+        result += unit;
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+#ifndef CLADITOR_CHANGE_HPP
+#define CLADITOR_CHANGE_HPP
+
+#include <string>
+
+#include "keymap.hpp"
+
+// Compact record of the last change that can be repeated
+struct Change {
+    Change();
+    Change(Action, int);
+
+    bool is_repeatable() const;
+    bool is_insert() const;
+    std::string get_insert_text(int) const;
+
+    Action action;
+    int count;
+    // Text typed in insert mode, new lines are stored as '\n'
+    std::string text;
+};
+#endif
@@ -1,9 +1,13 @@
 #include "command.hpp"
 
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <limits>
 #include <stack>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 bool is_valid_number(const std::string &str) {
@@ -30,20 +34,290 @@ std::string trim(const std::string &str) {
     return str.substr(first, last - first + 1);
 }
 
+LineRange::LineRange()
+    : start(LineRange::CURRENT_LINE),
+      end(LineRange::CURRENT_LINE),
+      start_offset(0),
+      end_offset(0),
+      end_from_start(false) {}
+
+LineRange::LineRange(std::int64_t start, std::int64_t end)
+    : start(start),
+      end(end),
+      start_offset(0),
+      end_offset(0),
+      end_from_start(false) {
+    // The last line comes after every numbered line
+    bool backwards = end >= 0 && (start == LAST_LINE || start > end);
+    if (backwards) {
+        std::swap(this->start, this->end);
+    }
+}
+
+bool LineRange::is_current_line() const {
+    return start == CURRENT_LINE && end == CURRENT_LINE &&
+           start_offset == 0 && end_offset == 0;
+}
+
+bool LineRange::is_absolute() const {
+    return (start >= 0 || (start == LAST_LINE && start_offset == 0)) &&
+           (end >= 0 || (end == LAST_LINE && end_offset == 0));
+}
+
 Command::Command(CommandType type, const std::string &content,
-                 const std::string &arg)
-    : type(type), content(content), arg(arg) {}
+                 const std::string &arg, const LineRange &range,
+                 bool has_range)
+    : type(type),
+      content(content),
+      arg(arg),
+      range(range),
+      has_range(has_range) {}
+
+namespace {
+// Largest line number or offset, leaves room to add them without overflowing
+const std::int64_t MAX_LINE_NUMBER =
+    std::numeric_limits<std::int64_t>::max() / 4;
+}  // namespace
+
+std::string::size_type parse_number(const std::string &str,
+                                    std::string::size_type position,
+                                    std::int64_t &number) {
+    // Parse digits and return the position after them, the number is capped
+    number = 0;
+    while (position < str.length() && std::isdigit(str[position])) {
+        int digit = str[position] - '0';
+        number = number > (MAX_LINE_NUMBER - digit) / 10 ? MAX_LINE_NUMBER
+                                                          : number * 10 + digit;
+        ++position;
+    }
+    return position;
+}
+
+std::string::size_type parse_address(const std::string &str,
+                                     std::string::size_type position,
+                                     std::int64_t &line, std::int64_t &offset,
+                                     std::string &pattern) {
+    // Parse a line and the offsets after it and return the position after
+    // them, offsets alone are relative to the current line
+    std::string::size_type end = position;
+    char c = position < str.length() ? str[position] : '\0';
+    std::int64_t number = 0;
+    if (c == '$' || c == '.') {
+        line = c == '$' ? LineRange::LAST_LINE : LineRange::CURRENT_LINE;
+        ++end;
+    } else if (c == '\'' && position + 1 < str.length() &&
+               (str[position + 1] == '<' || str[position + 1] == '>')) {
+        line = str[position + 1] == '<' ? LineRange::VISUAL_START
+                                        : LineRange::VISUAL_END;
+        end += 2;
+    } else if (c == '/' || c == '?') {
+        // The closing delimiter may be left out at the end
+        line = c == '/' ? LineRange::NEXT_MATCH : LineRange::PREVIOUS_MATCH;
+        pattern.clear();
+        for (++end; end < str.length() && str[end] != c; ++end) {
+            if (str[end] == '\\' && end + 1 < str.length() &&
+                str[end + 1] == c) {
+                ++end;
+            }
+            pattern += str[end];
+        }
+        if (end < str.length()) {
+            ++end;
+        }
+    } else {
+        end = parse_number(str, position, number);
+        if (end > position) {
+            line = number;
+        }
+    }
+    std::int64_t total = 0;
+    std::string::size_type offset_end = end;
+    while (offset_end < str.length() &&
+           (str[offset_end] == '+' || str[offset_end] == '-')) {
+        int sign = str[offset_end] == '+' ? 1 : -1;
+        std::string::size_type number_end =
+            parse_number(str, offset_end + 1, number);
+        total += sign * (number_end > offset_end + 1 ? number : 1);
+        total = std::max(std::min(total, MAX_LINE_NUMBER), -MAX_LINE_NUMBER);
+        offset_end = number_end;
+    }
+    if (offset_end == position) {
+        return position;
+    }
+    if (end == position) {
+        line = LineRange::CURRENT_LINE;
+    }
+    offset = total;
+    if (line >= 0 && line + total >= 0) {
+        // Line numbers are known before the command runs
+        line += total;
+        offset = 0;
+    }
+    return offset_end;
+}
+
+std::string::size_type parse_range(const std::string &str, LineRange &range) {
+    // Parse the range at the start of str and return its length
+    if (!str.empty() && str[0] == '%') {
+        range = {1, LineRange::LAST_LINE};
+        return 1;
+    }
+    LineRange parsed;
+    std::string::size_type position = parse_address(
+        str, 0, parsed.start, parsed.start_offset, parsed.start_pattern);
+    if (position == 0) {
+        return 0;
+    }
+    parsed.end = parsed.start;
+    parsed.end_offset = parsed.start_offset;
+    parsed.end_pattern = parsed.start_pattern;
+    if (position < str.length() &&
+        (str[position] == ',' || str[position] == ';')) {
+        LineRange end;
+        std::string::size_type end_position =
+            parse_address(str, position + 1, end.end, end.end_offset,
+                          end.end_pattern);
+        if (end_position > position + 1) {
+            parsed.end_from_start = str[position] == ';';
+            parsed.end = end.end;
+            parsed.end_offset = end.end_offset;
+            parsed.end_pattern = end.end_pattern;
+            position = end_position;
+        }
+    }
+    // Line numbers given backwards are swapped
+    range = parsed.is_absolute() ? LineRange(parsed.start, parsed.end) : parsed;
+    return position;
+}
+
+bool is_substitute_delimiter(char c) {
+    return std::ispunct(static_cast<unsigned char>(c)) && c != '"' &&
+           c != '|' && c != '\\';
+}
+
+std::string::size_type parse_global_name(const std::string &str,
+                                        bool &inverse) {
+    // Return the length of the name of a global command at the start of str
+    // if a delimiter follows it, or zero
+    const std::vector<std::pair<std::string, bool>> NAMES = {
+        {"global!", true}, {"global", false}, {"vglobal", true},
+        {"g!", true},      {"g", false},      {"v", true}};
+    for (const std::pair<std::string, bool> &name : NAMES) {
+        if (str.compare(0, name.first.length(), name.first) == 0 &&
+            str.length() > name.first.length() + 1 &&
+            is_substitute_delimiter(str[name.first.length()])) {
+            inverse = name.second;
+            return name.first.length();
+        }
+    }
+    return 0;
+}
+
+bool takes_rest_of_line(const std::string &str) {
+    // Check if str starts a global command or a shell command, which take the
+    // rest of the line
+    std::string command_line = trim(str);
+    LineRange range;
+    command_line = trim(command_line.substr(parse_range(command_line, range)));
+    bool inverse = false;
+    return parse_global_name(command_line, inverse) > 0 ||
+           (!command_line.empty() && command_line[0] == '!');
+}
 
 std::vector<Command> parse_command(const std::string &str) {
     std::string command_line = trim(str);
+    std::vector<Command> commands_vector;
+
+    // Check for jump to line before the number is read as a range
+    if (!command_line.empty() && is_valid_number(command_line)) {
+        commands_vector.push_back({CommandType::JUMP_LINE, command_line, ""});
+        return commands_vector;
+    }
+    LineRange range;
+    std::string::size_type range_length = parse_range(command_line, range);
+    bool has_range = range_length > 0;
+    if (has_range) {
+        command_line = trim(command_line.substr(range_length));
+    }
+
+    // Substitute takes the delimited pattern directly after the command
+    if (command_line.length() > 1 && command_line[0] == 's' &&
+        is_substitute_delimiter(command_line[1])) {
+        commands_vector.push_back({CommandType::SUBSTITUTE, "s",
+                                   command_line.substr(1), range, has_range});
+        return commands_vector;
+    }
+    // So does a global command, its content is "v" if it selects the lines
+    // that do not match
+    bool inverse = false;
+    std::string::size_type global_length =
+        parse_global_name(command_line, inverse);
+    if (global_length > 0) {
+        commands_vector.push_back({CommandType::GLOBAL, inverse ? "v" : "g",
+                                   command_line.substr(global_length), range,
+                                   has_range});
+        return commands_vector;
+    }
+    // A shell command filters the lines of the range through it, or only runs
+    // if there is no range
+    if (!command_line.empty() && command_line[0] == '!') {
+        std::string shell_command = trim(command_line.substr(1));
+        CommandType type = has_range ? CommandType::FILTER : CommandType::SHELL;
+        commands_vector.push_back(
+            {shell_command.empty() ? CommandType::ERROR_INVALID_COMMAND : type,
+             "!", shell_command, range, has_range});
+        return commands_vector;
+    }
+    // A range alone jumps to its last line
+    if (command_line.empty() && has_range) {
+        commands_vector.push_back(
+            {CommandType::JUMP_LINE, "", "", range, has_range});
+        return commands_vector;
+    }
+    // Shifts are repeated once for every '>' or '<'
+    if (!command_line.empty() &&
+        command_line.find_first_not_of(command_line[0]) ==
+            std::string::npos &&
+        (command_line[0] == '>' || command_line[0] == '<')) {
+        commands_vector.push_back({command_line[0] == '>'
+                                       ? CommandType::SHIFT_RIGHT
+                                       : CommandType::SHIFT_LEFT,
+                                   command_line, "", range, has_range});
+        return commands_vector;
+    }
+    // Move and copy take the address of their destination, which may follow
+    // the command directly as in "m0" or "t."
+    const std::vector<std::pair<std::string, CommandType>> ADDRESS_COMMANDS = {
+        {"move", CommandType::MOVE}, {"m", CommandType::MOVE},
+        {"copy", CommandType::COPY}, {"co", CommandType::COPY},
+        {"t", CommandType::COPY}};
+    for (const std::pair<std::string, CommandType> &address_command :
+         ADDRESS_COMMANDS) {
+        const std::string &name = address_command.first;
+        if (command_line.compare(0, name.length(), name) == 0 &&
+            (command_line.length() == name.length() ||
+             !std::isalpha(
+                 static_cast<unsigned char>(command_line[name.length()])))) {
+            std::string destination = trim(command_line.substr(name.length()));
+            commands_vector.push_back(
+                {destination.empty() ? CommandType::ERROR_INVALID_COMMAND
+                                     : address_command.second,
+                 name, destination, range, has_range});
+            return commands_vector;
+        }
+    }
+
     // Decompose command_line to command and argument constituents
     std::string::size_type space_delimiter = command_line.find(' ');
     std::string command = command_line.substr(0, space_delimiter);
     std::string arg = space_delimiter != std::string::npos
                           ? command_line.substr(space_delimiter + 1)
                           : "";
-    std::vector<Command> commands_vector;
     if (command.empty()) {
+        if (has_range) {
+            commands_vector.push_back(
+                {CommandType::ERROR_INVALID_COMMAND, str, ""});
+        }
         return commands_vector;
     }
 
@@ -51,20 +325,50 @@ std::vector<Command> parse_command(const std::string &str) {
         {"q", {CommandType::QUIT}},
         {"q!", {CommandType::FORCE_QUIT}},
         {"w", {CommandType::WRITE}},
+        {"w!", {CommandType::WRITE}},
+        {"write", {CommandType::WRITE}},
+        {"write!", {CommandType::WRITE}},
         {"wq", {CommandType::WRITE, CommandType::QUIT}},
         {"colo", {CommandType::PRINT_COLORSCHEME}},
-        {"colorscheme", {CommandType::PRINT_COLORSCHEME}}};
+        {"colorscheme", {CommandType::PRINT_COLORSCHEME}},
+        {"latency", {CommandType::LATENCY}},
+        {"d", {CommandType::DELETE}},
+        {"delete", {CommandType::DELETE}},
+        {"y", {CommandType::YANK}},
+        {"yank", {CommandType::YANK}},
+        {"sort", {CommandType::SORT}},
+        {"sort!", {CommandType::SORT}}};
 
     std::unordered_map<std::string, std::vector<CommandType>> ARG_COMMANDS = {
-        {"set", {CommandType::SET}}, {"echo", {CommandType::ECHO}}};
+        {"w", {CommandType::WRITE}},
+        {"w!", {CommandType::WRITE}},
+        {"write", {CommandType::WRITE}},
+        {"write!", {CommandType::WRITE}},
+        {"r", {CommandType::READ}},
+        {"read", {CommandType::READ}},
+        {"set", {CommandType::SET}},
+        {"echo", {CommandType::ECHO}},
+        {"map", {CommandType::MAP}},
+        {"nmap", {CommandType::MAP}},
+        {"vmap", {CommandType::MAP}},
+        {"xmap", {CommandType::MAP}},
+        {"noremap", {CommandType::MAP}},
+        {"nnoremap", {CommandType::MAP}},
+        {"vnoremap", {CommandType::MAP}},
+        {"xnoremap", {CommandType::MAP}},
+        {"latency", {CommandType::LATENCY}},
+        {"a", {CommandType::APPEND}},
+        {"append", {CommandType::APPEND}},
+        {"sort", {CommandType::SORT}},
+        {"sort!", {CommandType::SORT}}};
 
-    bool has_arg = !arg.empty();
+    // Commands that operate on lines
+    const std::vector<CommandType> RANGE_COMMANDS = {
+        CommandType::WRITE,  CommandType::READ,       CommandType::DELETE,
+        CommandType::YANK,   CommandType::SUBSTITUTE, CommandType::APPEND,
+        CommandType::SORT};
 
-    // Check for special commands
-    if (!has_arg && is_valid_number(command)) {
-        commands_vector.push_back({CommandType::JUMP_LINE, command, arg});
-        return commands_vector;
-    }
+    bool has_arg = !arg.empty();
 
     bool is_valid_command = validate_command(COMMANDS, command);
     bool is_valid_arg_command =
@@ -86,22 +390,56 @@ std::vector<Command> parse_command(const std::string &str) {
     // Determine vector to get command types depending on if argument is present
     std::vector<CommandType> types =
         has_arg ? ARG_COMMANDS[command] : COMMANDS[command];
+    if (has_range && std::find(RANGE_COMMANDS.begin(), RANGE_COMMANDS.end(),
+                               types.front()) == RANGE_COMMANDS.end()) {
+        commands_vector.push_back(
+            {CommandType::ERROR_NO_RANGE_ALLOWED, command, arg});
+        return commands_vector;
+    }
     std::transform(types.begin(), types.end(),
                    std::back_inserter(commands_vector),
-                   [command, arg](const CommandType &type) -> Command {
-                       return {type, command, arg};
+                   [command, arg, range, has_range](const CommandType &type) {
+                       return Command(type, command, arg, range, has_range);
                    });
 
     return commands_vector;
 }
 
+bool is_closed_address(const std::string &str) {
+    // Check if a pattern at the start of str is closed by its delimiter and
+    // followed by the rest of a command or nothing
+    LineRange range;
+    std::string::size_type length = parse_range(str, range);
+    if (length < str.length()) {
+        return length > 0;
+    }
+    return length > 1 && str.back() == str.front() &&
+           str[length - 2] != '\\';
+}
+
 std::vector<Command> get_command(const std::string &str) {
+    // A search takes the rest of the line as its pattern, which may contain
+    // '|', unless the pattern is closed and is the address of a command
+    std::string::size_type first = str.find_first_not_of(' ');
+    if (first != std::string::npos &&
+        (str[first] == '/' || str[first] == '?') &&
+        !is_closed_address(str.substr(first))) {
+        CommandType type = str[first] == '/' ? CommandType::SEARCH_FORWARD
+                                             : CommandType::SEARCH_BACKWARD;
+        return {{type, str.substr(first, 1), str.substr(first + 1)}};
+    }
     // Break down str in case it contains multiple commands delimited by '|'
-    // Additionally, '|' should be ignored when in quotes
+    // Additionally, '|' should be ignored when in quotes and a global or shell
+    // command takes the rest of the line as the command it runs
     std::vector<std::string> command_strings;
     std::string current_command = "";
     std::stack<char> quotes;
-    for (const char &c : str) {
+    for (std::string::size_type i = 0; i < str.length(); ++i) {
+        char c = str[i];
+        if (c == '|' && takes_rest_of_line(current_command)) {
+            current_command += str.substr(i);
+            break;
+        }
         if (c == '|' && quotes.empty()) {
             // Found command
             command_strings.push_back(current_command);
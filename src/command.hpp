@@ -1,21 +1,72 @@
 #ifndef CLADITOR_COMMAND_HPP
 #define CLADITOR_COMMAND_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 enum class CommandType {
     WRITE,
+    READ,
     QUIT,
     FORCE_QUIT,
     PRINT_COLORSCHEME,
     SET,
     ECHO,
+    MAP,
     JUMP_LINE,
+    DELETE,
+    YANK,
+    MOVE,
+    COPY,
+    SHIFT_RIGHT,
+    SHIFT_LEFT,
+    SORT,
+    SUBSTITUTE,
+    APPEND,
+    GLOBAL,
+    FILTER,
+    SHELL,
+    LATENCY,
+    SEARCH_FORWARD,
+    SEARCH_BACKWARD,
 
     // Error
     ERROR_INVALID_COMMAND,
-    ERROR_TRAILING_CHARACTERS
+    ERROR_TRAILING_CHARACTERS,
+    ERROR_NO_RANGE_ALLOWED
+};
+
+// Inclusive range of one-based line numbers, a range given backwards is
+// swapped. Ends that are not line numbers are found when the command runs
+struct LineRange {
+    static constexpr std::int64_t CURRENT_LINE = -1;
+    static constexpr std::int64_t LAST_LINE = -2;
+    // First and last line of the last visual selection, '< and '>
+    static constexpr std::int64_t VISUAL_START = -3;
+    static constexpr std::int64_t VISUAL_END = -4;
+    // Next or previous line that matches the pattern of the end, /pattern/
+    // and ?pattern?
+    static constexpr std::int64_t NEXT_MATCH = -5;
+    static constexpr std::int64_t PREVIOUS_MATCH = -6;
+
+    // 64 bit so that streamed files can be addressed past 2^31 lines
+    std::int64_t start;
+    std::int64_t end;
+    // Added to the ends once they are found, as in .+1 or $-2
+    std::int64_t start_offset;
+    std::int64_t end_offset;
+    std::string start_pattern;
+    std::string end_pattern;
+    // The end is found from the start instead of the current line, as given
+    // with ';'
+    bool end_from_start;
+
+    LineRange();
+    LineRange(std::int64_t, std::int64_t);
+    bool is_current_line() const;
+    // Both ends are line numbers or the last line
+    bool is_absolute() const;
 };
 
 struct Command {
@@ -24,10 +75,18 @@ struct Command {
     // argument
     std::string content;
     std::string arg;
+    LineRange range;
+    // Whether a range was given, "." is the current line as is no range but
+    // commands such as :w and :sort use every line without one
+    bool has_range;
 
-    Command(CommandType, const std::string &, const std::string &);
+    Command(CommandType, const std::string &, const std::string &,
+            const LineRange & = LineRange(), bool = false);
 };
 
+// Parse the range at the start of the string and return its length, zero if
+// there is none
+std::string::size_type parse_range(const std::string &, LineRange &);
 std::vector<Command> get_command(const std::string &);
 
 #endif
@@ -1,33 +1,52 @@
 #include "editor.hpp"
 
+#include <sys/stat.h>
+
 #ifndef UNIT_TEST
 #include <ncurses.h>
 #endif
 
 #include <algorithm>
 #include <array>
+#include <cctype>
+#include <chrono>
+#include <climits>
 #include <cmath>
+#include <cstdint>
+#include <fstream>
 #include <iterator>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "bind_count.hpp"
 #include "buffer.hpp"
+#include "change.hpp"
 #include "color.hpp"
 #include "command.hpp"
+#include "file_reader.hpp"
+#include "file_writer.hpp"
 #include "interface.hpp"
+#include "job.hpp"
+#include "keymap.hpp"
+#include "latency.hpp"
+#include "macro.hpp"
+#include "match_counter.hpp"
 #include "options.hpp"
 #include "parser.hpp"
 #include "position.hpp"
 #include "runtime.hpp"
-
-// Return the equivalent input code when input and ctrl keys are held together
-#define ctrl(input) ((input)&0x1f)
+#include "shell_filter.hpp"
+#include "substitution.hpp"
+#include "thread_pool.hpp"
 
 enum class InputKey : int { TAB = 9, ENTER = 10, ESCAPE = 27, BACKSPACE = 127 };
 
+// Interrupt key read in raw mode
+const int CTRL_C = 3;
+
 // Backspace cross-platform compatibility
 #ifndef UNIT_TEST
 #define ALTERNATIVE_BACKSPACE : \
@@ -39,6 +58,37 @@ enum class InputKey : int { TAB = 9, ENTER = 10, ESCAPE = 27, BACKSPACE = 127 };
 #define IS_BACKSPACE \
     case static_cast<int>(InputKey::BACKSPACE) ALTERNATIVE_BACKSPACE
 
+// Number of screen lines used for command-line
+const int COMMAND_HEIGHT = 1;
+// Number of times user mappings may expand without reading a new key
+const int MAX_MAPPING_DEPTH = 1000;
+// Virtual dimensions used to resolve screen relative motions when headless
+const int BATCH_LINES = 24;
+const int BATCH_COLUMNS = 80;
+// Lines after the screen that the search being typed looks for a match in
+const int SEARCH_LOOKAHEAD = 100;
+// Buffers with at least this many lines are searched on a thread pool
+const int PARALLEL_SEARCH_LINES = 65536;
+// Time background jobs may run before input is checked again
+const std::chrono::milliseconds BACKGROUND_SLICE(4);
+// Time a job may run before input is handled, which keeps the screen at 60 Hz
+const std::chrono::milliseconds JOB_SLICE(16);
+
+namespace {
+std::string format_count(std::size_t count) {
+    // Group digits by thousands
+    std::string digits = std::to_string(count);
+    std::string formatted;
+    for (std::string::size_type i = 0; i < digits.length(); ++i) {
+        if (i > 0 && (digits.length() - i) % 3 == 0) {
+            formatted += ',';
+        }
+        formatted += digits[i];
+    }
+    return formatted;
+}
+}  // namespace
+
 Editor::Editor(const std::string &file_path,
                const std::stringstream &file_stream)
     : mode_(ModeType::NORMAL),
@@ -50,47 +100,108 @@ Editor::Editor(const std::string &file_path,
       previous_first_line_(0),
       current_line_(0),
       visual_line_(0),
+      visual_start_line_(-1),
+      visual_end_line_(-1),
       line_number_width_(0),
       buffer_lines_(0),
       horizontal_offset_(0),
       current_color_pair_{ColorForeground::DEFAULT, ColorBackground::DEFAULT},
       zero_lines_(false),
+      pending_node_(KeyTrie::ROOT),
+      pending_noremap_(false),
+      noremap_input_(false),
+      mapping_depth_(0),
+      typed_input_(false),
+      macro_count_(1),
+      headless_(false),
+      event_driven_(false),
+      needs_render_(false),
+      autosave_timer_(-1),
+      autosave_interval_(0),
+      latency_enabled_(false),
+      command_prefix_(':'),
+      search_count_(1),
+      last_search_forward_(true),
+      match_counter_(nullptr),
+      trigram_index_builder_(nullptr),
       file_(file_path, file_stream) {
-    buffer_.lines = file_.get_content();
+    buffer_.set_lines(file_.get_content());
     if (buffer_.get_size() == 0) {
         // Add empty line to prevent segmentation fault
         buffer_.push_back_line("");
         zero_lines_ = true;
     }
-    history_.set_content(buffer_.lines);
+    history_.set_content(buffer_.get_lines());
+    buffer_.add_observer(&match_cache_);
 }
 
 void Editor::start(const std::string &initial_command) {
-    Interface::refresh();
+    interface_.refresh();
+    interface_.install_resize_handler();
     interface_.update();
+    resize();
     update();
     options_.set_options_from_config();
+    keymap_.set_keymaps_from_config();
     colorscheme_manager_.fetch_colorschemes();
     colorscheme_manager_.set_colorscheme(
         options_.get_string_option("colorscheme"));
+#ifndef UNIT_TEST
+    add_event_sources();
+#endif
+    latency_enabled_ = options_.get_bool_option("latency");
+    update_trigram_index();
     run_command(initial_command);
-    if (mode_.get_type() != ModeType::EXIT) {
-        state_enter(&Editor::normal_state);
+    state_loop(get_mode_state());
+    if (latency_enabled_) {
+        write_latency_log();
+    }
+}
+
+std::vector<std::string> Editor::run_batch(const std::string &commands,
+                                          const std::vector<int> &keys,
+                                          const Options &options,
+                                          const Keymap &keymap) {
+    headless_ = true;
+    interface_.set_headless(true);
+    interface_.set_inputs(keys);
+    interface_.set_dimensions(BATCH_LINES, BATCH_COLUMNS);
+    options_ = options;
+    keymap_ = keymap;
+    update();
+    resize();
+    run_command(commands);
+    state_loop(get_mode_state());
+    // Exiting with unsaved changes is only possible with a forced quit
+    if (mode_.get_type() != ModeType::EXIT &&
+        history_.has_unsaved_changes(buffer_.get_lines())) {
+        run_command("w");
     }
+    return errors_;
 }
 
 void Editor::run_command(const std::string &command) {
-    std::vector<Command> commands = get_command(command);
+    run_commands(get_command(command), command);
+}
 
+void Editor::run_commands(const std::vector<Command> &commands,
+                          const std::string &command) {
+    // Run parsed commands, the command line they were parsed from is shown in
+    // errors
+    // Commands that use every line without a range are given the whole
+    // buffer, since "." is the same range as none
+    const LineRange WHOLE_BUFFER(1, LineRange::LAST_LINE);
     for (const Command &c : commands) {
         switch (c.type) {
             case CommandType::WRITE:
-                file_.write_content(buffer_.lines);
-                history_.set_content(buffer_.lines);
-                print_message("\"" + file_.get_path() + "\" written");
+                command_write(c.has_range ? c.range : WHOLE_BUFFER,
+                              c.content.back() == '!', c.arg);
+                break;
+            case CommandType::READ:
+                command_read(c.range, c.arg);
                 break;
             case CommandType::QUIT:
-                if (history_.has_unsaved_changes(buffer_.lines)) {
+                if (history_.has_unsaved_changes(buffer_.get_lines())) {
                     print_error("No write since last change");
                 } else {
                     set_mode(ModeType::EXIT);
@@ -112,6 +223,9 @@ void Editor::run_command(const std::string &command) {
                 if (!options_.set_option(c.arg)) {
                     print_error("Unknown option: " + c.arg);
                 }
+                set_autosave_timer();
+                update_trigram_index();
+                latency_enabled_ = options_.get_bool_option("latency");
                 // Check if colorscheme has changed, set new colorscheme changed
                 std::string new_colorscheme =
                     options_.get_string_option("colorscheme");
@@ -129,16 +243,81 @@ void Editor::run_command(const std::string &command) {
                     print_error("Invalid echo argument " + c.arg);
                 }
                 break;
+            case CommandType::MAP:
+                if (!keymap_.map(c.content, c.arg)) {
+                    print_error("Invalid mapping: " + c.arg);
+                }
+                break;
             case CommandType::JUMP_LINE:
+                if (c.content.empty()) {
+                    command_jump(c.range);
+                    break;
+                }
                 normal_jump_line(std::stoi(c.content) - 1);
                 normal_first_non_blank_char(first_line_ + buffer_.position.y);
                 break;
+            case CommandType::LATENCY: {
+                std::string summary;
+                if (!latency_enabled_) {
+                    print_error("Latency is not being recorded");
+                } else if (latency_.get_summary(c.arg, summary)) {
+                    print_message(summary);
+                } else {
+                    print_error("Unknown latency histogram: " + c.arg);
+                }
+            } break;
+            case CommandType::SEARCH_FORWARD:
+            case CommandType::SEARCH_BACKWARD:
+                search(c.arg, c.type == CommandType::SEARCH_FORWARD,
+                       search_count_);
+                search_count_ = 1;
+                break;
             case CommandType::ERROR_INVALID_COMMAND:
                 print_error("Not an editor command: " + command);
                 break;
+            case CommandType::DELETE:
+                command_delete(c.range);
+                break;
+            case CommandType::YANK:
+                command_yank(c.range);
+                break;
+            case CommandType::MOVE:
+                command_move(c.range, c.arg);
+                break;
+            case CommandType::COPY:
+                command_copy(c.range, c.arg);
+                break;
+            case CommandType::SHIFT_RIGHT:
+            case CommandType::SHIFT_LEFT:
+                command_shift(c.range, static_cast<int>(c.content.length()),
+                              c.type == CommandType::SHIFT_RIGHT);
+                break;
+            case CommandType::SORT:
+                command_sort(c.has_range ? c.range : WHOLE_BUFFER,
+                             c.content.back() == '!', c.arg);
+                break;
+            case CommandType::SUBSTITUTE:
+                command_substitute(c.range, c.arg);
+                break;
+            case CommandType::APPEND:
+                command_append(c.range, c.arg);
+                break;
+            case CommandType::GLOBAL:
+                command_global(c.has_range ? c.range : WHOLE_BUFFER,
+                               c.content == "v", c.arg);
+                break;
+            case CommandType::FILTER:
+                command_filter(c.range, c.arg);
+                break;
+            case CommandType::SHELL:
+                command_shell(c.arg);
+                break;
             case CommandType::ERROR_TRAILING_CHARACTERS:
                 print_error("Trailing characters");
                 break;
+            case CommandType::ERROR_NO_RANGE_ALLOWED:
+                print_error("No range allowed");
+                break;
         }
     }
 }
@@ -153,7 +332,7 @@ void Editor::set_interface(const std::vector<int> &inputs, int lines,
 std::stringstream Editor::get_buffer_stream() {
     std::stringstream buffer_stream;
     for (int i = 0; i < buffer_.get_size(); ++i) {
-        std::string line = buffer_.lines[i];
+        std::string line = buffer_.get_lines()[i];
         if (i < buffer_.get_size() - 1) {
             line.push_back('\n');
         }
@@ -161,6 +340,12 @@ std::stringstream Editor::get_buffer_stream() {
     }
     return buffer_stream;
 }
+
+std::uintptr_t Editor::get_input_stack_range() const {
+    return interface_.get_input_stack_range();
+}
+
+int Editor::get_frame_count() const { return frame_count_; }
 #endif
 
 void Editor::print_buffer() {
@@ -171,15 +356,16 @@ void Editor::print_buffer() {
     }
     bool has_scroll = previous_first_line_ != first_line_;
     if (has_scroll) {
-        Interface::cursor_set(0);
+        interface_.cursor_set(0);
     }
     set_color(ColorForeground::DEFAULT, ColorBackground::DEFAULT);
     ColorPair default_color_pair = current_color_pair_;
+    SearchPattern *highlight_pattern = get_highlight_pattern();
     for (int i = 0; i < buffer_lines_; ++i) {
         if (first_line_ + i >= buffer_.get_size()) {
-            Interface::move_cursor(i, 0);
+            interface_.move_cursor(i, 0);
         } else {
-            std::string line = buffer_.lines[first_line_ + i];
+            std::string line = buffer_.get_lines()[first_line_ + i];
             if (options_.get_bool_option("number")) {
                 std::string line_number = std::to_string(first_line_ + i + 1);
                 std::string line_number_content =
@@ -187,24 +373,43 @@ void Editor::print_buffer() {
                                 ' ') +
                     line_number;
                 // Print line number
-                Interface::mv_print(i, 0, line_number_content + ' ');
+                interface_.mv_print(i, 0, line_number_content + ' ');
             }
             // The number of characters to render should not exceed the number
             // of columns that can be used to render the buffer
             int characters_to_render =
                 std::min(static_cast<int>(line.length()) - horizontal_offset_,
                          interface_.columns - line_number_width_ - 1);
+            // Matches are only found in lines that are drawn
+            const std::vector<MatchRange> *matches =
+                highlight_pattern == nullptr || characters_to_render <= 0
+                    ? nullptr
+                    : &match_cache_.get_matches(
+                          *highlight_pattern, buffer_.get_lines(),
+                          buffer_.get_version(), first_line_ + i,
+                          horizontal_offset_ + characters_to_render);
+            std::size_t match_index = 0;
             // Print characters one by one
             for (int j = 0; j < characters_to_render; ++j) {
+                std::size_t column = j + horizontal_offset_;
+                bool is_match = false;
+                if (matches != nullptr) {
+                    while (match_index < matches->size() &&
+                           (*matches)[match_index].second <= column) {
+                        ++match_index;
+                    }
+                    is_match = match_index < matches->size() &&
+                               (*matches)[match_index].first <= column;
+                }
                 bool accent =
                     needs_visual_highlight(i, j + horizontal_offset_) ||
-                    line[j + horizontal_offset_] == '\t';
+                    line[j + horizontal_offset_] == '\t' || is_match;
                 if (accent) {
                     unset_color();
                     set_color(ColorForeground::DEFAULT,
                               ColorBackground::ACCENT);
                 }
-                Interface::mv_print_ch(
+                interface_.mv_print_ch(
                     i, static_cast<int>(line_number_width_ + 1 + j),
                     line[j + horizontal_offset_]);
                 if (accent) {
@@ -214,15 +419,15 @@ void Editor::print_buffer() {
                 }
             }
         }
-        Interface::clear_to_eol();
+        interface_.clear_to_eol();
         if (has_scroll) {
-            Interface::refresh();
+            interface_.refresh();
         }
     }
     unset_color();
-    Interface::move_cursor(cursor_position_.y, cursor_position_.x);
+    interface_.move_cursor(cursor_position_.y, cursor_position_.x);
     if (has_scroll) {
-        Interface::cursor_set(1);
+        interface_.cursor_set(1);
     }
     previous_first_line_ = first_line_;
 }
@@ -230,17 +435,17 @@ void Editor::print_buffer() {
 void Editor::print_command_line() {
     set_color(ColorForeground::DEFAULT, ColorBackground::DEFAULT);
     if (mode_.get_type() == ModeType::COMMAND) {
-        Interface::mv_print(buffer_lines_, 0, ':' + command_line_);
-        Interface::clear_to_eol();
+        interface_.mv_print(buffer_lines_, 0, command_prefix_ + command_line_);
+        interface_.clear_to_eol();
     }
     unset_color();
 }
 
 void Editor::clear_command_line() {
     command_line_ = "";
-    Interface::move_cursor(buffer_lines_, 0);
-    Interface::clear_to_eol();
-    Interface::move_cursor(cursor_position_.y, cursor_position_.x);
+    interface_.move_cursor(buffer_lines_, 0);
+    interface_.clear_to_eol();
+    interface_.move_cursor(cursor_position_.y, cursor_position_.x);
 }
 
 void Editor::update() {
@@ -256,15 +461,6 @@ void Editor::update() {
         horizontal_offset_ = std::min(horizontal_offset_, buffer_.position.x);
         cursor_position_.x -= (horizontal_offset_ - raw_offset);
     }
-    // Number of screen lines used for command-line
-    const int COMMAND_HEIGHT = 1;
-    int initial_interface_lines = interface_.lines;
-    interface_.update();
-    buffer_lines_ = interface_.lines - COMMAND_HEIGHT;
-    // Handle resizing
-    if (initial_interface_lines != interface_.lines) {
-        normal_center_line(current_line_);
-    }
     if (zero_lines_ &&
         (buffer_.get_size() != 1 || buffer_.get_line_length(0) > 0)) {
         zero_lines_ = false;
@@ -275,7 +471,260 @@ void Editor::update() {
             ? static_cast<int>(std::to_string(buffer_.get_size() + 1).length() +
                                1)
             : -1;
-    Interface::refresh();
+}
+
+void Editor::render() {
+    if (headless_) {
+        return;
+    }
+    if (latency_enabled_) {
+        LatencyRecorder::Clock::time_point start =
+            LatencyRecorder::Clock::now();
+        print_buffer();
+        latency_.record_print_buffer(LatencyRecorder::Clock::now() - start);
+    } else {
+        print_buffer();
+    }
+    print_command_line();
+    interface_.refresh();
+    if (latency_enabled_) {
+        latency_.record_frame();
+    }
+#ifdef UNIT_TEST
+    ++frame_count_;
+#endif
+}
+
+void Editor::resize() {
+    // Recompute the layout once for the current terminal dimensions
+    buffer_lines_ = interface_.lines - COMMAND_HEIGHT;
+    normal_center_line(current_line_);
+    horizontal_offset_ =
+        std::max(0, buffer_.position.x + line_number_width_ + 1 -
+                        (interface_.columns - 1));
+}
+
+int Editor::get_input() {
+    if (!typeahead_.empty()) {
+        TypeaheadKey typeahead = typeahead_.front();
+        typeahead_.pop_front();
+        noremap_input_ = typeahead.noremap;
+        typed_input_ = false;
+        return typeahead.key;
+    }
+    noremap_input_ = false;
+    mapping_depth_ = 0;
+    LatencyRecorder::Clock::time_point read_time;
+    int input =
+        event_driven_ ? wait_for_input(read_time) : read_input(read_time);
+    if (latency_enabled_) {
+        latency_.record_input(input, mode_.get_type(), read_time);
+    }
+    macro_recorder_.record(input);
+    typed_input_ = true;
+    return input;
+}
+
+int Editor::read_input(LatencyRecorder::Clock::time_point &read_time) {
+    // Block on the interface until a key is read
+    int input = interface_.get_input();
+    read_time = LatencyRecorder::Clock::now();
+    while (true) {
+        if (interface_.has_resized()) {
+            resize();
+            if (input == Interface::NO_INPUT) {
+                // Nothing else will redraw the screen until the next key
+                update();
+                render();
+            }
+        }
+        if (input != Interface::NO_INPUT) {
+            return input;
+        }
+        input = interface_.get_input();
+        read_time = LatencyRecorder::Clock::now();
+    }
+}
+
+int Editor::wait_for_input(LatencyRecorder::Clock::time_point &read_time) {
+    // Handle events until a key is available, the screen is only redrawn
+    // when an event changed it
+    while (pending_input_.empty()) {
+        needs_render_ = false;
+        // Edits that changed unknown lines leave lines to index again
+        build_trigram_index();
+        if (background_jobs_.empty()) {
+            event_loop_.run_once(-1);
+        } else {
+            // Background work only runs while there is nothing to handle
+            event_loop_.run_once(0);
+            if (pending_input_.empty()) {
+                run_background_slice();
+            }
+        }
+        if (pending_input_.empty() && needs_render_) {
+            update();
+            render();
+        }
+    }
+    PendingKey pending_key = pending_input_.front();
+    pending_input_.pop_front();
+    read_time = pending_key.time;
+    return pending_key.key;
+}
+
+void Editor::add_event_sources() {
+    event_driven_ = true;
+    interface_.set_input_blocking(false);
+    event_loop_.add_reader(interface_.get_input_fd(), [this] {
+        // Keys are timestamped as they are read so that the latency of a
+        // key includes the time it waits behind other keys and jobs
+        int input = interface_.get_input();
+        while (input != Interface::NO_INPUT) {
+            pending_input_.push_back({input, LatencyRecorder::Clock::now()});
+            input = interface_.get_input();
+        }
+    });
+    int resize_fd = Interface::get_resize_fd();
+    if (resize_fd != -1) {
+        event_loop_.add_reader(resize_fd, [this] {
+            if (interface_.has_resized()) {
+                resize();
+                needs_render_ = true;
+            }
+        });
+    }
+    if (!file_.get_path().empty()) {
+        event_loop_.watch_file(file_.get_path(), [this] {
+            if (file_.has_changed_on_disk()) {
+                print_message("WARNING: \"" + file_.get_path() +
+                              "\" changed on disk since reading it");
+                needs_render_ = true;
+            }
+        });
+    }
+    set_autosave_timer();
+}
+
+void Editor::write_latency_log() {
+    std::string path = options_.get_string_option("latencylog");
+    if (path.empty()) {
+        path = get_home_directory() + "/.config/claditor/latency.json";
+    }
+    std::ofstream log(path, std::ios::out | std::ios::trunc);
+    log << latency_.to_json();
+}
+
+bool Editor::run_job(Job &job) {
+    // Run job in slices and handle input between them, returns false if the
+    // job was cancelled with Ctrl-C or Escape
+    while (!job.run_slice(Job::Clock::now() + JOB_SLICE)) {
+        if (!event_driven_) {
+            continue;
+        }
+        event_loop_.run_once(0);
+        std::deque<PendingKey>::iterator cancel_key = std::find_if(
+            pending_input_.begin(), pending_input_.end(),
+            [](const PendingKey &pending_key) {
+                return pending_key.key == CTRL_C ||
+                       pending_key.key == static_cast<int>(InputKey::ESCAPE);
+            });
+        if (cancel_key != pending_input_.end()) {
+            pending_input_.erase(cancel_key);
+            job.cancel();
+            print_error("Interrupted");
+            return false;
+        }
+        print_message(
+            job.get_description() + " " +
+            std::to_string(static_cast<int>(job.get_progress() * 100)) + "%");
+        interface_.refresh();
+    }
+    return true;
+}
+
+void Editor::run_in_background(std::unique_ptr<Job> job,
+                               const std::function<void()> &on_finish,
+                               bool follows_edits) {
+    background_jobs_.push_back(
+        {std::move(job), buffer_.get_version(), follows_edits, on_finish});
+}
+
+void Editor::remove_background_job(const Job *job) {
+    std::deque<BackgroundJob>::iterator it = std::find_if(
+        background_jobs_.begin(), background_jobs_.end(),
+        [job](const BackgroundJob &background_job) {
+            return background_job.job.get() == job;
+        });
+    if (it != background_jobs_.end()) {
+        background_jobs_.erase(it);
+    }
+    if (job == match_counter_) {
+        match_counter_ = nullptr;
+    }
+    if (job == trigram_index_builder_) {
+        trigram_index_builder_ = nullptr;
+    }
+}
+
+void Editor::run_background_slice() {
+    BackgroundJob &background_job = background_jobs_.front();
+    if (!background_job.follows_edits &&
+        background_job.version != buffer_.get_version()) {
+        // Lines that the job reads have changed
+        remove_background_job(background_job.job.get());
+        return;
+    }
+    if (!background_job.job->run_slice(Job::Clock::now() + BACKGROUND_SLICE)) {
+        return;
+    }
+    // The callback runs after the job is removed so that it can add jobs,
+    // and before the job is destroyed so that it can read its results
+    std::unique_ptr<Job> job = std::move(background_job.job);
+    std::function<void()> on_finish = std::move(background_job.on_finish);
+    background_jobs_.pop_front();
+    remove_background_job(job.get());
+    on_finish();
+}
+
+void Editor::write_file() {
+#ifndef UNIT_TEST
+    FileWriter file_writer(file_.get_path(), buffer_.get_lines());
+    if (!run_job(file_writer)) {
+        return;
+    }
+    if (file_writer.has_failed()) {
+        print_error("Cannot write \"" + file_.get_path() + "\"");
+        return;
+    }
+    file_.mark_written();
+#endif
+    history_.set_content(buffer_.get_lines());
+    save_trigram_index();
+    print_message("\"" + file_.get_path() + "\" written");
+}
+
+void Editor::set_autosave_timer() {
+    // Restart the autosave timer if the interval in seconds has changed
+    int interval = options_.get_int_option("autosave");
+    if (!event_driven_ || interval == autosave_interval_) {
+        return;
+    }
+    if (autosave_timer_ != -1) {
+        event_loop_.remove_timer(autosave_timer_);
+        autosave_timer_ = -1;
+    }
+    autosave_interval_ = interval;
+    if (interval > 0) {
+        autosave_timer_ = event_loop_.add_timer(
+            std::min(interval, INT_MAX / 1000) * 1000, [this] {
+                if (!file_.get_path().empty() &&
+                    history_.has_unsaved_changes(buffer_.get_lines())) {
+                    run_command("w");
+                    needs_render_ = true;
+                }
+            });
+    }
 }
 
 Position Editor::get_visual_start_position() {
@@ -333,34 +782,172 @@ bool Editor::needs_visual_highlight(int y, int x) {
     return false;
 }
 
-void Editor::normal_and_visual(int input) {
+Editor::State Editor::normal_state(int input) {
+    return keymap_state(KeymapMode::NORMAL, input);
+}
+
+Editor::State Editor::insert_state(int input) {
+    // Text typed in insert mode is compiled into the pending change
     switch (input) {
-        case 'h':
-            can_repeat(&Editor::move_left);
+        case static_cast<int>(InputKey::ESCAPE):
+            if (pending_change_.is_repeatable()) {
+                last_change_ = pending_change_;
+            }
+            set_mode(ModeType::NORMAL);
+            break;
+        IS_BACKSPACE:
+            if (pending_change_.text.empty()) {
+                // Text from before the insert was removed
+                pending_change_ = Change();
+            } else {
+                pending_change_.text.pop_back();
+            }
+            insert_backspace();
             break;
-        case 'j':
-            can_repeat(&Editor::move_down);
+        case static_cast<int>(InputKey::ENTER):
+            pending_change_.text += '\n';
+            insert_enter();
             break;
-        case 'k':
-            can_repeat(&Editor::move_up);
+        case static_cast<int>(InputKey::TAB):
+            pending_change_.text +=
+                options_.get_bool_option("tabs")
+                    ? std::string(1, '\t')
+                    : std::string(options_.get_int_option("tabsize"), ' ');
+            insert_tab();
             break;
-        case 'l':
-            can_repeat(&Editor::move_right);
+        default:
+            pending_change_.text += static_cast<char>(input);
+            insert_char(input);
             break;
-        case '0':
+    }
+    return get_mode_state();
+}
+
+Editor::State Editor::visual_state(int input) {
+    // Visual binds for all visual mode variations
+    return keymap_state(KeymapMode::VISUAL, input);
+}
+
+Editor::State Editor::command_state(int input) {
+    switch (input) {
+        case static_cast<int>(InputKey::ESCAPE):
+            set_mode(ModeType::NORMAL);
+            break;
+        IS_BACKSPACE:
+            command_backspace();
+            break;
+        case static_cast<int>(InputKey::ENTER):
+            command_enter();
+            break;
+        default:
+            command_char(input);
+            break;
+    }
+    return get_mode_state();
+}
+
+Editor::State Editor::keymap_state(KeymapMode mode, int input) {
+    // Advance the pending key sequence by one step in the keymap of the mode
+    bool is_count_digit = pending_node_ == KeyTrie::ROOT &&
+                          ((input >= '1' && input <= '9') ||
+                           (input == '0' && !bind_count_.empty()));
+    if (is_count_digit) {
+        normal_add_count(input);
+        return get_mode_state();
+    }
+    if (pending_node_ == KeyTrie::ROOT) {
+        pending_noremap_ = noremap_input_;
+    }
+    const KeyTrie &trie = keymap_.get_trie(mode, pending_noremap_);
+    int previous_node = pending_node_;
+    int node = trie.get_child(previous_node, input);
+    if (node != -1 && trie.has_children(node)) {
+        // Wait for the rest of a longer sequence
+        pending_node_ = node;
+        return get_mode_state();
+    }
+    pending_node_ = KeyTrie::ROOT;
+    if (node != -1) {
+        return run_binding(trie.get_binding(node));
+    }
+    if (trie.get_binding(previous_node).action != Action::NONE) {
+        // Keys so far form a complete binding that could not be extended, the
+        // input starts the next sequence
+        typeahead_.push_front({input, noremap_input_});
+        return run_binding(trie.get_binding(previous_node));
+    }
+    // Input is not bound
+    bind_count_.reset();
+    return get_mode_state();
+}
+
+Editor::State Editor::run_binding(const Binding &binding) {
+    if (binding.action != Action::MAPPING) {
+        return run_action(binding.action);
+    }
+    // Replay the keys of a user mapping before any other input
+    if (++mapping_depth_ > MAX_MAPPING_DEPTH) {
+        typeahead_.clear();
+        bind_count_.reset();
+        print_error("Recursive mapping");
+        return get_mode_state();
+    }
+    push_typeahead(binding.keys, 1, binding.noremap);
+    return get_mode_state();
+}
+
+void Editor::push_typeahead(const std::vector<int> &keys, int count,
+                            bool noremap) {
+    // Insert keys count times in front of the pending typeahead
+    std::deque<TypeaheadKey> repeated;
+    for (int i = 0; i < count; ++i) {
+        for (int key : keys) {
+            repeated.push_back({key, noremap});
+        }
+    }
+    typeahead_.insert(typeahead_.begin(), repeated.begin(), repeated.end());
+}
+
+Editor::State Editor::run_action(Action action) {
+    Change change(action, 1);
+    if (change.is_insert()) {
+        pending_change_ = change;
+    }
+    switch (action) {
+        case Action::MOVE_LEFT:
+            move_left(bind_count_.get_value());
+            break;
+        case Action::MOVE_DOWN:
+            move_down(bind_count_.get_value());
+            break;
+        case Action::MOVE_UP:
+            move_up(bind_count_.get_value());
+            break;
+        case Action::MOVE_RIGHT:
+            move_right(bind_count_.get_value());
+            break;
+        case Action::FIRST_CHAR:
             normal_first_char();
             last_column_ = buffer_.position.x;
             break;
-        case '^':
+        case Action::FIRST_NON_BLANK_CHAR:
             normal_first_non_blank_char(current_line_);
             break;
-        case 'x':
-            can_repeat(&Editor::normal_delete);
+        case Action::DELETE:
+            change.count = bind_count_.get_value();
+            normal_delete(change.count);
+            last_change_ = change;
             break;
-        case 'g':
-            state_enter(&Editor::normal_command_g_state);
+        case Action::FIRST_LINE:
+            if (bind_count_.empty()) {
+                normal_first_line();
+                last_column_ = buffer_.position.x;
+            } else {
+                normal_jump_line(bind_count_.get_value() - 1);
+                normal_first_non_blank_char(first_line_ + buffer_.position.y);
+            }
             break;
-        case 'G':
+        case Action::END_OF_FILE:
             if (bind_count_.empty()) {
                 normal_end_of_file();
             } else {
@@ -368,187 +955,219 @@ void Editor::normal_and_visual(int input) {
                 normal_first_non_blank_char(first_line_ + buffer_.position.y);
             }
             break;
-        case ':':
-            saved_position_.x = cursor_position_.x;
-            saved_position_.y = cursor_position_.y;
-            clear_command_line();
-            set_mode(ModeType::COMMAND);
-            state_enter(&Editor::command_state);
-            break;
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            normal_add_count(input);
-            state_enter(&Editor::normal_add_count_state);
-            break;
-        case ctrl('f'):
-            can_repeat(&Editor::normal_page_down);
-            break;
-        case ctrl('b'):
-            can_repeat(&Editor::normal_page_up);
+        case Action::PAGE_DOWN:
+            normal_page_down(bind_count_.get_value());
             break;
-        default:
-            bind_count_.reset();
+        case Action::PAGE_UP:
+            normal_page_up(bind_count_.get_value());
             break;
-    }
-}
-
-bool Editor::normal_state(int input) {
-    switch (input) {
-        case 'a':
-            normal_append_after_cursor();
+        case Action::CENTER_LINE:
+            if (bind_count_.empty()) {
+                normal_center_line(current_line_);
+            } else {
+                normal_center_line(bind_count_.get_value() - 1);
+            }
             break;
-        case 'A':
-            normal_append_end_of_line();
+        case Action::DELETE_LINE:
+            change.count = bind_count_.get_value();
+            normal_delete_line(change.count);
+            last_change_ = change;
             break;
-        case 'i':
-            set_mode(ModeType::INSERT);
-            state_enter(&Editor::insert_state);
+        case Action::PUT_AFTER:
+        case Action::PUT_BEFORE:
+            normal_put(bind_count_.get_value(), action == Action::PUT_AFTER);
+            break;
+        case Action::REPEAT_CHANGE:
+            if (last_change_.is_repeatable()) {
+                // A count replaces the count of the last change
+                repeat_change(bind_count_.empty() ? last_change_.count
+                                                  : bind_count_.get_value());
+            }
             break;
-        case 'v':
-            set_mode(ModeType::VISUAL);
-            state_enter(&Editor::visual_regular_state);
+        case Action::APPEND_AFTER_CURSOR:
+            normal_append_after_cursor();
             break;
-        case 'V':
-            set_mode(ModeType::VISUAL_LINE);
-            state_enter(&Editor::visual_line_state);
+        case Action::APPEND_END_OF_LINE:
+            normal_append_end_of_line();
             break;
-        case 'o':
+        case Action::BEGIN_NEW_LINE_BELOW:
             normal_begin_new_line_below();
             break;
-        case 'O':
+        case Action::BEGIN_NEW_LINE_ABOVE:
             normal_begin_new_line_above();
             break;
-        case 'z':
-            state_enter(&Editor::normal_command_z_state);
+        case Action::DELETE_SELECTION:
+            visual_delete_selection();
+            set_mode(ModeType::NORMAL);
             break;
-        case 'd':
-            state_enter(&Editor::normal_command_d_state);
+        case Action::NORMAL_MODE:
+            set_mode(ModeType::NORMAL);
             break;
-        default:
-            normal_and_visual(input);
+        case Action::INSERT_MODE:
+            set_mode(ModeType::INSERT);
             break;
-    }
-    return true;
-}
-
-bool Editor::insert_state(int input) {
-    switch (input) {
-        case static_cast<int>(InputKey::ESCAPE):
-            set_mode(ModeType::NORMAL);
-            state_enter(&Editor::normal_state);
+        case Action::VISUAL_MODE:
+            set_mode(mode_.get_type() == ModeType::VISUAL ? ModeType::NORMAL
+                                                          : ModeType::VISUAL);
             break;
-        IS_BACKSPACE:
-            insert_backspace();
+        case Action::VISUAL_LINE_MODE:
+            set_mode(mode_.get_type() == ModeType::VISUAL_LINE
+                         ? ModeType::NORMAL
+                         : ModeType::VISUAL_LINE);
             break;
-        case static_cast<int>(InputKey::ENTER):
-            insert_enter();
+        case Action::RECORD_MACRO:
+            if (macro_recorder_.is_recording()) {
+                if (typed_input_) {
+                    // The key that stops recording is not part of the macro
+                    macro_recorder_.drop_last_key();
+                }
+                macro_recorder_.stop_recording();
+                clear_command_line();
+                break;
+            }
+            // A count before q does not carry over to the first recorded key
+            bind_count_.reset();
+            return {&Editor::macro_record_state};
+        case Action::EXECUTE_MACRO:
+            macro_count_ = bind_count_.get_value();
+            return {&Editor::macro_execute_state};
+        case Action::SEARCH_NEXT:
+            search_next(last_search_forward_, bind_count_.get_value());
             break;
-        case static_cast<int>(InputKey::TAB):
-            insert_tab();
+        case Action::SEARCH_PREVIOUS:
+            search_next(!last_search_forward_, bind_count_.get_value());
             break;
-        default:
-            insert_char(input);
+        case Action::COMMAND_MODE:
+        case Action::SEARCH_FORWARD:
+        case Action::SEARCH_BACKWARD:
+            command_prefix_ = action == Action::SEARCH_FORWARD    ? '/'
+                              : action == Action::SEARCH_BACKWARD ? '?'
+                                                                  : ':';
+            // Leaving normal mode resets the count
+            search_count_ = bind_count_.get_value();
+            search_origin_ = get_view();
+            saved_position_.x = cursor_position_.x;
+            saved_position_.y = cursor_position_.y;
+            clear_command_line();
+            if (action == Action::COMMAND_MODE &&
+                (mode_.get_type() == ModeType::VISUAL ||
+                 mode_.get_type() == ModeType::VISUAL_LINE)) {
+                // Commands typed in visual mode apply to the selected lines
+                set_mode(ModeType::COMMAND);
+                command_line_ = "'<,'>";
+                break;
+            }
+            set_mode(ModeType::COMMAND);
+            break;
+        case Action::NONE:
+        case Action::MAPPING:
             break;
     }
-    return true;
+    // Count is only used by the action it was given to
+    bind_count_.reset();
+    return get_mode_state();
 }
 
-void Editor::visual_state(int input) {
-    // Visual binds for all visual mode variations
-    switch (input) {
-        case static_cast<int>(InputKey::ESCAPE):
-            set_mode(ModeType::NORMAL);
-            state_enter(&Editor::normal_state);
+void Editor::repeat_change(int count) {
+    // Apply the last change directly to the buffer without dispatching the
+    // keys that made it
+    if (last_change_.action == Action::DELETE) {
+        normal_delete(count);
+        return;
+    }
+    if (last_change_.action == Action::DELETE_LINE) {
+        normal_delete_line(count);
+        return;
+    }
+    int x = buffer_.position.x;
+    int line_length = buffer_.get_line_length(current_line_);
+    switch (last_change_.action) {
+        case Action::APPEND_AFTER_CURSOR:
+            x = std::min(x + 1, line_length);
             break;
-        case 'd':
-            visual_delete_selection();
-            set_mode(ModeType::NORMAL);
-            state_enter(&Editor::normal_state);
+        case Action::APPEND_END_OF_LINE:
+        case Action::BEGIN_NEW_LINE_BELOW:
+            x = line_length;
+            break;
+        case Action::BEGIN_NEW_LINE_ABOVE:
+            x = 0;
             break;
         default:
-            normal_and_visual(input);
             break;
     }
+    // Cursor ends on the last inserted character
+    Position end = buffer_.insert_string(
+        x, last_change_.get_insert_text(count), current_line_);
+    normal_jump_line(end.y);
+    buffer_.position.x = std::max(0, end.x - 1);
+    last_column_ = buffer_.position.x;
 }
 
-bool Editor::visual_regular_state(int input) {
-    switch (input) {
-        case 'v':
-            set_mode(ModeType::NORMAL);
-            state_enter(&Editor::normal_state);
-            break;
-        case 'V':
-            set_mode(ModeType::VISUAL_LINE);
-            state_enter(&Editor::visual_line_state);
-            break;
-        default:
-            visual_state(input);
-            break;
+Editor::State Editor::macro_record_state(int input) {
+    // Bind: q{register}
+    if (macro_recorder_.start_recording(input)) {
+        print_message("recording @" + std::string(1, static_cast<char>(
+                                                         std::tolower(input))));
     }
-    return true;
+    return get_mode_state();
 }
 
-bool Editor::visual_line_state(int input) {
-    switch (input) {
-        case 'v':
-            set_mode(ModeType::VISUAL);
-            state_enter(&Editor::visual_regular_state);
-            break;
-        case 'V':
-            set_mode(ModeType::NORMAL);
-            state_enter(&Editor::normal_state);
-            break;
-        default:
-            visual_state(input);
-            break;
+Editor::State Editor::macro_execute_state(int input) {
+    // Bind: @{register} and @@
+    int reg = input == '@' ? macro_recorder_.get_last_register() : input;
+    if (!macro_recorder_.set_last_register(reg)) {
+        return get_mode_state();
     }
-    return true;
+    if (++mapping_depth_ > MAX_MAPPING_DEPTH) {
+        typeahead_.clear();
+        print_error("Recursive macro");
+        return get_mode_state();
+    }
+    push_typeahead(macro_recorder_.get_keys(reg), macro_count_, false);
+    return get_mode_state();
 }
 
-bool Editor::command_state(int input) {
-    switch (input) {
-        case static_cast<int>(InputKey::ESCAPE):
-            set_mode(ModeType::NORMAL);
-            state_enter(&Editor::normal_state);
-            break;
-        IS_BACKSPACE:
-            command_backspace();
-            break;
-        case static_cast<int>(InputKey::ENTER):
-            command_enter();
-            break;
+Editor::State Editor::get_mode_state() const {
+    // Return the state that handles input for the current mode
+    if (confirmation_ != nullptr) {
+        return {&Editor::confirm_state};
+    }
+    switch (mode_.get_type()) {
+        case ModeType::INSERT:
+            return {&Editor::insert_state};
+        case ModeType::VISUAL:
+        case ModeType::VISUAL_LINE:
+            return {&Editor::visual_state};
+        case ModeType::COMMAND:
+            return {&Editor::command_state};
         default:
-            command_char(input);
-            break;
+            return {&Editor::normal_state};
     }
-    return true;
 }
 
-void Editor::state_enter(bool (Editor::*state_callback)(int)) {
-    int input = 0;
-    do {
-        update();
-        print_buffer();
-        print_command_line();
-        input = interface_.get_input();
-    } while ((this->*state_callback)(input) &&
-             mode_.get_type() != ModeType::EXIT);
-}
-
-void Editor::can_repeat(void (Editor::*func)()) {
-    // If a function should repeat by the number stored by bind count, the
-    // function should be passed here when called
-    int count = bind_count_.get_value();
-    for (int i = 0; i < count; ++i) {
-        update();
-        (this->*func)();
+void Editor::state_loop(State state) {
+    // Each state handles a single input and returns the state that handles the
+    // next one, so mode changes never nest
+    while (mode_.get_type() != ModeType::EXIT) {
+        if (latency_enabled_) {
+            LatencyRecorder::Clock::time_point start =
+                LatencyRecorder::Clock::now();
+            update();
+            latency_.record_update(LatencyRecorder::Clock::now() - start);
+        } else {
+            update();
+        }
+        if (typeahead_.empty()) {
+            if (!interface_.has_input()) {
+                // Scripted input is exhausted
+                break;
+            }
+            // Keys from mappings and macros are handled without drawing the
+            // intermediate frames
+            render();
+        }
+        int input = get_input();
+        state = (this->*state.callback)(input);
     }
 }
 
@@ -559,9 +1178,14 @@ void Editor::normal_first_non_blank_char(int line) {
     last_column_ = buffer_.position.x;
 }
 
-void Editor::normal_delete() {
-    if (buffer_.get_line_length(current_line_) > 0) {
-        buffer_.erase(buffer_.position.x, 1, current_line_);
+void Editor::normal_delete(int count) {
+    // Delete count characters from the cursor without going past the end of
+    // the line
+    int line_length = buffer_.get_line_length(current_line_);
+    if (line_length > 0) {
+        buffer_.erase(buffer_.position.x,
+                      std::min(count, line_length - buffer_.position.x),
+                      current_line_);
         int current_line_length = buffer_.get_line_length(current_line_);
         if (buffer_.position.x >= current_line_length &&
             current_line_length > 0) {
@@ -586,13 +1210,11 @@ void Editor::normal_end_of_file() {
 void Editor::normal_append_after_cursor() {
     ++buffer_.position.x;
     set_mode(ModeType::INSERT);
-    state_enter(&Editor::insert_state);
 }
 
 void Editor::normal_append_end_of_line() {
     buffer_.position.x = buffer_.get_line_length(current_line_);
     set_mode(ModeType::INSERT);
-    state_enter(&Editor::insert_state);
 }
 
 void Editor::normal_begin_new_line_below() {
@@ -604,14 +1226,12 @@ void Editor::normal_begin_new_line_below() {
         ++buffer_.position.y;
     }
     set_mode(ModeType::INSERT);
-    state_enter(&Editor::insert_state);
 }
 
 void Editor::normal_begin_new_line_above() {
     buffer_.insert_line("", current_line_);
     buffer_.position.x = 0;
     set_mode(ModeType::INSERT);
-    state_enter(&Editor::insert_state);
 }
 
 void Editor::normal_first_line() {
@@ -661,15 +1281,42 @@ void Editor::normal_delete_line(int number_of_lines) {
         zero_lines_ = true;
         buffer_.set_line("", 0);
         buffer_.position.x = 0;
+        return;
     }
-    for (int i = 0; i < number_of_lines; ++i) {
-        if (buffer_.get_size() > 1 && current_line_ < buffer_.get_size()) {
-            buffer_.remove_line(current_line_);
-            buffer_.position.x = buffer_.get_first_non_blank(current_line_);
-            buffer_.position.y =
-                std::min(buffer_.get_size() - 1, buffer_.position.y);
-        }
+    // The last line of the buffer is kept
+    int count = std::min(number_of_lines, buffer_.get_size() - current_line_);
+    count = std::min(count, buffer_.get_size() - 1);
+    if (count <= 0) {
+        return;
     }
+    buffer_.remove_lines(current_line_, current_line_ + count - 1);
+    normal_jump_line(current_line_);
+    buffer_.position.x =
+        buffer_.get_first_non_blank(first_line_ + buffer_.position.y);
+}
+
+void Editor::normal_put(int count, bool after) {
+    // Put the yanked lines count times below or above the current line
+    if (yanked_lines_.empty()) {
+        print_error("Nothing to put");
+        return;
+    }
+    std::vector<std::string> put_lines;
+    put_lines.reserve(yanked_lines_.size() * count);
+    for (int i = 0; i < count; ++i) {
+        put_lines.insert(put_lines.end(), yanked_lines_.begin(),
+                         yanked_lines_.end());
+    }
+    int row = after ? current_line_ + 1 : current_line_;
+    if (zero_lines_) {
+        // The empty line of an empty buffer is replaced
+        buffer_.remove_lines(0, 0);
+        zero_lines_ = false;
+        row = 0;
+    }
+    buffer_.insert_lines(std::move(put_lines), row);
+    normal_jump_line(row);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
 }
 
 void Editor::normal_add_count(int input) {
@@ -677,77 +1324,22 @@ void Editor::normal_add_count(int input) {
     bind_count_.add_digit(input - '0');
 }
 
-void Editor::normal_page_down() {
-    // Bottom line on screen becomes the first line
-    first_line_ =
-        std::min(first_line_ + buffer_lines_ - 1, buffer_.get_size() - 1);
+void Editor::normal_page_down(int count) {
+    // Bottom line on screen becomes the first line, count times
+    long long target = first_line_ + static_cast<long long>(count) *
+                                         (buffer_lines_ - 1);
+    first_line_ = static_cast<int>(
+        std::min(target, static_cast<long long>(buffer_.get_size() - 1)));
     if (first_line_ + buffer_.position.y >= buffer_.get_size()) {
         normal_end_of_file();
     }
 }
 
-void Editor::normal_page_up() {
-    // First line on screen becomes the bottom line
-    first_line_ = std::max(first_line_ - buffer_lines_ + 1, 0);
-}
-
-bool Editor::normal_command_g_state(int input) {
-    switch (input) {
-        case 'g':  // Bind: gg
-            if (bind_count_.empty()) {
-                normal_first_line();
-                last_column_ = buffer_.position.x;
-            } else {
-                normal_jump_line(bind_count_.get_value() - 1);
-                normal_first_non_blank_char(first_line_ + buffer_.position.y);
-            }
-            break;
-    }
-    return false;
-}
-
-bool Editor::normal_command_z_state(int input) {
-    switch (input) {
-        case 'z':  // Bind: zz
-            if (bind_count_.empty()) {
-                normal_center_line(current_line_);
-            } else {
-                normal_center_line(bind_count_.get_value() - 1);
-            }
-            break;
-    }
-    return false;
-}
-
-bool Editor::normal_command_d_state(int input) {
-    switch (input) {
-        case 'd':  // Bind: dd
-            normal_delete_line(bind_count_.get_value());
-            break;
-    }
-    return false;
-}
-
-bool Editor::normal_add_count_state(int input) {
-    switch (input) {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            normal_add_count(input);
-            state_enter(&Editor::normal_add_count_state);
-            break;
-        default:
-            normal_state(input);
-            break;
-    }
-    return false;
+void Editor::normal_page_up(int count) {
+    // First line on screen becomes the bottom line, count times
+    long long target = first_line_ - static_cast<long long>(count) *
+                                         (buffer_lines_ - 1);
+    first_line_ = static_cast<int>(std::max(target, 0LL));
 }
 
 int Editor::get_adjusted_x() {
@@ -760,53 +1352,65 @@ int Editor::get_adjusted_x() {
 
 void Editor::adjusted_move(int y, int x) const {
     // Move cursor with line number width offset
-    Interface::move_cursor(y, line_number_width_ + x + 1);
+    interface_.move_cursor(y, line_number_width_ + x + 1);
 }
 
-void Editor::move_up() {
-    if (current_line_ - 1 >= 0 && buffer_.position.y - 1 >= 0) {
-        --buffer_.position.y;
-    } else if (current_line_ - 1 >= 0) {
-        --first_line_;
+void Editor::move_up(int count) {
+    int line = first_line_ + buffer_.position.y;
+    int target = std::max(0, line - count);
+    if (target >= first_line_) {
+        buffer_.position.y = target - first_line_;
+    } else {
+        // Scroll up
+        first_line_ = target;
+        buffer_.position.y = 0;
     }
+    current_line_ = target;
     buffer_.position.x = get_adjusted_x();
 }
 
-void Editor::move_right() {
+void Editor::move_right(int count) {
     // In normal mode, the cursor should not be ahead of the end of the line
-    // if (buffer_.position.x + line_number_width_ + 1 <= interface_.columns &&
-    if (buffer_.position.x < buffer_.get_line_length(current_line_) &&
-        !(mode_.get_type() == ModeType::NORMAL &&
-          buffer_.position.x + 1 >= buffer_.get_line_length(current_line_))) {
-        ++buffer_.position.x;
+    int line_length = buffer_.get_line_length(current_line_);
+    int last_x = mode_.get_type() == ModeType::NORMAL ? line_length - 1
+                                                      : line_length;
+    if (buffer_.position.x < last_x) {
+        buffer_.position.x = static_cast<int>(std::min(
+            static_cast<long long>(buffer_.position.x) + count,
+            static_cast<long long>(last_x)));
         last_column_ = buffer_.position.x;
     }
 }
 
-void Editor::move_down() {
-    if (buffer_.position.y + 1 < buffer_lines_ &&
-        current_line_ + 1 < buffer_.get_size()) {
-        ++buffer_.position.y;
-    } else if (current_line_ + 1 < buffer_.get_size()) {
+void Editor::move_down(int count) {
+    int line = first_line_ + buffer_.position.y;
+    int target = static_cast<int>(
+        std::min(static_cast<long long>(line) + count,
+                 static_cast<long long>(buffer_.get_size() - 1)));
+    if (target - first_line_ < buffer_lines_) {
+        buffer_.position.y = target - first_line_;
+    } else {
         // Scroll down
-        ++first_line_;
+        first_line_ = target - buffer_lines_ + 1;
+        buffer_.position.y = buffer_lines_ - 1;
     }
+    current_line_ = target;
     buffer_.position.x = get_adjusted_x();
 }
 
-void Editor::move_left() {
-    if (buffer_.position.x - 1 >= 0) {
-        --buffer_.position.x;
+void Editor::move_left(int count) {
+    if (buffer_.position.x > 0) {
+        buffer_.position.x = std::max(0, buffer_.position.x - count);
         last_column_ = buffer_.position.x;
     }
 }
 
 void Editor::insert_backspace() {
     if (buffer_.position.x == 0 && current_line_ > 0) {
+        // Join the line to the previous line
         buffer_.position.x = buffer_.get_line_length(current_line_ - 1);
-        buffer_.add_string_to_line(buffer_.lines[current_line_],
-                                   current_line_ - 1);
-        buffer_.remove_line(current_line_);
+        buffer_.replace_range({current_line_ - 1, buffer_.position.x},
+                              {current_line_, 0}, "");
         --buffer_.position.y;
     } else if (!(buffer_.position.x == 0 && current_line_ == 0)) {
         // Erase character
@@ -815,17 +1419,8 @@ void Editor::insert_backspace() {
 }
 
 void Editor::insert_enter() {
-    if (buffer_.position.x < buffer_.get_line_length(current_line_)) {
-        // Move substring down
-        int substring_length =
-            buffer_.get_line_length(current_line_) - buffer_.position.x;
-        buffer_.insert_line(buffer_.lines[current_line_].substr(
-                                buffer_.position.x, substring_length),
-                            current_line_ + 1);
-        buffer_.erase(buffer_.position.x, substring_length, current_line_);
-    } else {
-        buffer_.insert_line("", current_line_ + 1);
-    }
+    // Split the line, moving the rest of it down
+    buffer_.insert_string(buffer_.position.x, "\n", current_line_);
     buffer_.position.x = 0;
     if (buffer_.position.y >= buffer_lines_ - 1) {
         // If cursor is at the bottom of the screen, only increase first line
@@ -855,22 +1450,898 @@ void Editor::insert_char(int input) {
 void Editor::command_backspace() {
     if (command_line_.empty()) {
         set_mode(ModeType::NORMAL);
-        state_enter(&Editor::normal_state);
-    } else {
-        command_line_.pop_back();
+        return;
+    }
+    command_line_.pop_back();
+    if (command_prefix_ != ':') {
+        preview_search();
     }
 }
 
 void Editor::command_enter() {
     set_mode(ModeType::NORMAL);
-    run_command(command_line_);
-    if (mode_.get_type() != ModeType::EXIT) {
-        state_enter(&Editor::normal_state);
+    if (command_prefix_ == ':') {
+        run_command(command_line_);
+    } else {
+        // Typed patterns are searched for as they are, even if they look like
+        // the address of a command
+        search(command_line_, command_prefix_ == '/', search_count_);
+        search_count_ = 1;
     }
 }
 
 void Editor::command_char(int input) {
     command_line_ += static_cast<char>(input);
+    if (command_prefix_ != ':') {
+        preview_search();
+    }
+}
+
+bool Editor::get_address_line(std::int64_t address, std::int64_t offset,
+                              const std::string &pattern, int from,
+                              int &line) {
+    // Convert one end of a range to a buffer index, line zero is -1
+    std::int64_t target = 0;
+    switch (address) {
+        case LineRange::CURRENT_LINE:
+            target = from;
+            break;
+        case LineRange::LAST_LINE:
+            target = buffer_.get_size() - 1;
+            break;
+        case LineRange::VISUAL_START:
+        case LineRange::VISUAL_END:
+            if (visual_start_line_ == -1) {
+                print_error("Mark not set");
+                return false;
+            }
+            target = address == LineRange::VISUAL_START ? visual_start_line_
+                                                        : visual_end_line_;
+            break;
+        case LineRange::NEXT_MATCH:
+        case LineRange::PREVIOUS_MATCH: {
+            // An empty pattern is the last search pattern
+            SearchPattern address_pattern = search_pattern_;
+            if (!pattern.empty() && !address_pattern.set(pattern)) {
+                print_error("Invalid pattern: " + address_pattern.get_error());
+                return false;
+            }
+            if (address_pattern.empty()) {
+                print_error("No previous search pattern");
+                return false;
+            }
+            // Matches are searched for from the line after or before the
+            // line, wrapping around the end of the buffer
+            bool forward = address == LineRange::NEXT_MATCH;
+            Position origin(from, forward ? buffer_.get_line_length(from) : 0);
+            Position match;
+            bool wrapped = false;
+            if (!search_lines(buffer_.get_lines(), address_pattern, origin,
+                              forward ? SearchDirection::FORWARD
+                                      : SearchDirection::BACKWARD,
+                              match, wrapped, -1,
+                              get_search_filter(address_pattern))) {
+                print_error("Pattern not found: " +
+                            address_pattern.get_source());
+                return false;
+            }
+            target = match.y;
+        } break;
+        default:
+            target = address - 1;
+            break;
+    }
+    // Lines past the ends of the buffer are out of range either way
+    target += offset;
+    line = static_cast<int>(
+        std::max(std::min(target, static_cast<std::int64_t>(INT_MAX)),
+                 static_cast<std::int64_t>(-INT_MAX)));
+    return true;
+}
+
+bool Editor::get_range_lines(const LineRange &range, int &start, int &end) {
+    // Convert a range to buffer indices, returns false if it is out of bounds
+    int current_line = first_line_ + buffer_.position.y;
+    if (!get_address_line(range.start, range.start_offset, range.start_pattern,
+                          current_line, start) ||
+        !get_address_line(range.end, range.end_offset, range.end_pattern,
+                          range.end_from_start ? start : current_line, end)) {
+        return false;
+    }
+    if (start > end) {
+        std::swap(start, end);
+    }
+    if (start < 0 || end >= buffer_.get_size()) {
+        print_error("Invalid range");
+        return false;
+    }
+    return true;
+}
+
+bool Editor::get_destination_line(const std::string &arg, int &line) {
+    // Convert the address that move and copy put lines after to a buffer
+    // index, line zero is -1
+    LineRange destination;
+    if (parse_range(arg, destination) != arg.length()) {
+        print_error("Invalid address: " + arg);
+        return false;
+    }
+    if (!get_address_line(destination.end, destination.end_offset,
+                          destination.end_pattern,
+                          first_line_ + buffer_.position.y, line)) {
+        return false;
+    }
+    if (line < -1 || line >= buffer_.get_size()) {
+        print_error("Invalid range");
+        return false;
+    }
+    return true;
+}
+
+void Editor::command_jump(const LineRange &range) {
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    normal_jump_line(end);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+}
+
+void Editor::command_write(const LineRange &range, bool force,
+                           const std::string &arg) {
+    // The file is given after ">>" to append to it
+    bool append = arg.compare(0, 2, ">>") == 0;
+    std::string path = arg;
+    if (append) {
+        path.erase(0, 2);
+        path.erase(0, path.find_first_not_of(' '));
+    }
+    if (path.empty()) {
+        path = file_.get_path();
+    }
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    bool whole_buffer = start == 0 && end == buffer_.get_size() - 1;
+    bool own_file = path == file_.get_path();
+    if (own_file && !append && whole_buffer) {
+        write_file();
+        return;
+    }
+    if (own_file && !append && !force) {
+        print_error("Use ! to write partial buffer");
+        return;
+    }
+    struct stat file_stat;
+    if (!own_file && !append && !force && stat(path.c_str(), &file_stat) == 0) {
+        print_error("File exists (add ! to override)");
+        return;
+    }
+    // Lines are written straight from the buffer without copying the range
+    FileWriter file_writer(path, buffer_.get_lines(),
+                           static_cast<std::size_t>(start),
+                           static_cast<std::size_t>(end) + 1, append);
+    if (!run_job(file_writer)) {
+        return;
+    }
+    if (file_writer.has_failed()) {
+        print_error("Cannot write \"" + path + "\"");
+        return;
+    }
+    print_message("\"" + path + "\" " + std::to_string(end - start + 1) +
+                  (append ? " lines appended" : " lines written"));
+}
+
+void Editor::command_read(const LineRange &range, const std::string &arg) {
+    // Index of the first read line, line zero reads above the first line
+    int line = 0;
+    if (range.end != 0) {
+        int start = 0;
+        if (!get_range_lines(range, start, line)) {
+            return;
+        }
+        ++line;
+    }
+    std::vector<std::string> lines;
+    if (!read_lines(arg, lines)) {
+        print_error("Cannot read \"" + arg + "\"");
+        return;
+    }
+    if (lines.empty()) {
+        return;
+    }
+    int count = static_cast<int>(lines.size());
+    if (zero_lines_) {
+        // The empty line of an empty buffer is replaced
+        buffer_.replace_lines(0, 0, std::move(lines));
+        zero_lines_ = false;
+        line = 0;
+    } else {
+        buffer_.insert_lines(std::move(lines), line);
+    }
+    normal_jump_line(line);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+    print_message("\"" + arg + "\" " + std::to_string(count) + " lines");
+}
+
+void Editor::command_delete(const LineRange &range) {
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    // Deleted lines are moved to the register
+    yanked_lines_ = buffer_.extract_lines(start, end);
+    if (buffer_.get_size() == 0) {
+        zero_lines_ = true;
+        buffer_.push_back_line("");
+    }
+    normal_jump_line(start);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+}
+
+void Editor::command_yank(const LineRange &range) {
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    yanked_lines_.assign(buffer_.get_lines().begin() + start,
+                         buffer_.get_lines().begin() + end + 1);
+    if (end - start + 1 > 2) {
+        print_message(std::to_string(end - start + 1) + " lines yanked");
+    }
+}
+
+void Editor::command_move(const LineRange &range, const std::string &arg) {
+    int start = 0;
+    int end = 0;
+    int destination = 0;
+    if (!get_range_lines(range, start, end) ||
+        !get_destination_line(arg, destination)) {
+        return;
+    }
+    if (destination >= start && destination < end) {
+        print_error("Cannot move a range of lines into itself");
+        return;
+    }
+    int count = end - start + 1;
+    // Lines moved to where they are stay
+    if (destination > end) {
+        buffer_.move_lines(start, end, destination + 1);
+        normal_jump_line(destination);
+    } else if (destination < start - 1) {
+        buffer_.move_lines(start, end, destination + 1);
+        normal_jump_line(destination + count);
+    } else {
+        normal_jump_line(end);
+    }
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+    if (count > 2) {
+        print_message(std::to_string(count) + " lines moved");
+    }
+}
+
+void Editor::command_copy(const LineRange &range, const std::string &arg) {
+    int start = 0;
+    int end = 0;
+    int destination = 0;
+    if (!get_range_lines(range, start, end) ||
+        !get_destination_line(arg, destination)) {
+        return;
+    }
+    std::vector<std::string> copied(buffer_.get_lines().begin() + start,
+                                    buffer_.get_lines().begin() + end + 1);
+    int count = static_cast<int>(copied.size());
+    buffer_.insert_lines(std::move(copied), destination + 1);
+    normal_jump_line(destination + count);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+}
+
+void Editor::command_shift(const LineRange &range, int count, bool right) {
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    // Lines are shifted by a tab or by tabsize spaces
+    int tabsize = options_.get_int_option("tabsize");
+    std::string indent = options_.get_bool_option("tabs")
+                             ? std::string(count, '\t')
+                             : std::string(count * tabsize, ' ');
+    buffer_.change_lines([&](std::vector<std::string> &lines) {
+        std::vector<int> changed;
+        for (int i = start; i <= end; ++i) {
+            std::string &line = lines[i];
+            if (right && !line.empty()) {
+                line.insert(0, indent);
+                changed.push_back(i);
+                continue;
+            }
+            std::string::size_type removed = 0;
+            for (int shift = 0; shift < count && removed < line.length();
+                 ++shift) {
+                if (line[removed] == '\t') {
+                    ++removed;
+                    continue;
+                }
+                std::string::size_type spaces =
+                    line.find_first_not_of(' ', removed);
+                spaces =
+                    (spaces == std::string::npos ? line.length() : spaces) -
+                    removed;
+                removed += std::min(
+                    spaces, static_cast<std::string::size_type>(tabsize));
+            }
+            if (removed > 0) {
+                line.erase(0, removed);
+                changed.push_back(i);
+            }
+        }
+        return changed;
+    });
+    normal_jump_line(end);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+    if (end - start + 1 > 2) {
+        print_message(std::to_string(end - start + 1) + " lines " +
+                      (right ? ">" : "<") + "ed " + std::to_string(count) +
+                      (count == 1 ? " time" : " times"));
+    }
+}
+
+void Editor::command_sort(const LineRange &range, bool reverse,
+                          const std::string &arg) {
+    Sort sort;
+    if (!parse_sort(arg, sort)) {
+        print_error("Invalid argument: " + arg);
+        return;
+    }
+    sort.reverse = sort.reverse || reverse;
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    // Rows are sorted and the lines are then moved to their place once
+    SortJob sort_job(buffer_.get_lines(), start, end, sort, get_search_pool());
+    if (!run_job(sort_job)) {
+        return;
+    }
+    std::vector<int> rows = std::move(sort_job.get_rows());
+    int removed = end - start + 1 - static_cast<int>(rows.size());
+    buffer_.reorder_lines(start, end, std::move(rows));
+    normal_jump_line(start);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+    if (removed > 2) {
+        print_message(std::to_string(removed) + " fewer lines");
+    }
+}
+
+void Editor::command_filter(const LineRange &range, const std::string &arg) {
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    // The empty line of an empty buffer is not given to the command
+    ShellFilter filter(arg, buffer_.get_lines(), start,
+                       zero_lines_ ? start - 1 : end);
+    if (!run_job(filter)) {
+        return;
+    }
+    std::vector<std::string> &output = filter.get_output();
+    if (filter.has_failed()) {
+        // Lines are kept since the output is likely an error
+        print_error(filter.get_error() +
+                    (output.empty() ? "" : ": " + output.front()));
+        return;
+    }
+    buffer_.replace_lines(start, end, std::move(output));
+    zero_lines_ = buffer_.get_size() == 0;
+    if (zero_lines_) {
+        buffer_.push_back_line("");
+    }
+    normal_jump_line(std::min(start, buffer_.get_size() - 1));
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+    if (end - start + 1 > 2) {
+        print_message(std::to_string(end - start + 1) + " lines filtered");
+    }
+}
+
+void Editor::command_shell(const std::string &arg) {
+    // Run the command without input and show the last line of its output
+    ShellFilter shell(arg, buffer_.get_lines(), 0, -1);
+    if (!run_job(shell)) {
+        return;
+    }
+    const std::vector<std::string> &output = shell.get_output();
+    if (shell.has_failed()) {
+        print_error(shell.get_error() +
+                    (output.empty() ? "" : ": " + output.back()));
+    } else if (!output.empty()) {
+        print_message(output.back());
+    }
+}
+
+void Editor::command_substitute(const LineRange &range,
+                                const std::string &arg) {
+    Substitution substitution;
+    if (!parse_substitution(arg, substitution)) {
+        print_error(substitution.search_pattern.is_valid()
+                        ? "Invalid substitute pattern: " + arg
+                        : "Invalid pattern: " +
+                              substitution.search_pattern.get_error());
+        return;
+    }
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    if (substitution.confirm) {
+        confirmation_.reset(new Confirmation{std::move(substitution), start, 0,
+                                             end, 0, 0, 0, 0, -1});
+        confirm_next();
+        return;
+    }
+    // Lines are substituted in place and the buffer is notified once
+    int match_count = 0;
+    std::vector<int> changed =
+        buffer_.change_lines([&](std::vector<std::string> &lines) {
+            return substitute_lines(lines, start, end, substitution,
+                                    get_search_pool(), match_count);
+        });
+    if (changed.empty()) {
+        print_error("Pattern not found: " + substitution.pattern);
+        return;
+    }
+    int line_count = static_cast<int>(changed.size());
+    normal_jump_line(changed.back());
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+    report_substitutions(match_count, line_count);
+}
+
+Editor::State Editor::confirm_state(int input) {
+    // Answer whether to replace the match at the cursor
+    switch (input) {
+        case 'y':
+            confirm_replace();
+            confirm_next();
+            break;
+        case 'l':
+            confirm_replace();
+            confirmation_->last_line = -1;
+            confirm_next();
+            break;
+        case 'a':
+            while (confirmation_ != nullptr) {
+                confirm_replace();
+                confirm_next();
+            }
+            break;
+        case 'n': {
+            Confirmation &confirmation = *confirmation_;
+            confirmation.from =
+                confirmation.match_start == confirmation.match_end
+                    ? confirmation.match_start + 1
+                    : confirmation.match_end;
+            if (!confirmation.substitution.global) {
+                ++confirmation.line;
+                confirmation.from = 0;
+            }
+            confirm_next();
+        } break;
+        case 'q':
+        case CTRL_C:
+        case static_cast<int>(InputKey::ESCAPE):
+            confirmation_->last_line = -1;
+            confirm_next();
+            break;
+        default:
+            break;
+    }
+    return get_mode_state();
+}
+
+void Editor::confirm_replace() {
+    Confirmation &confirmation = *confirmation_;
+    const std::string &line = buffer_.get_lines()[confirmation.line];
+    std::string result = line.substr(0, confirmation.match_start);
+    append_replacement(result, confirmation.substitution, line,
+                       confirmation.match_start, confirmation.match_end);
+    std::size_t replacement_end = result.length();
+    result.append(line, confirmation.match_end, std::string::npos);
+    buffer_.set_line(result, confirmation.line);
+    ++confirmation.match_count;
+    if (confirmation.changed_line != confirmation.line) {
+        confirmation.changed_line = confirmation.line;
+        ++confirmation.line_count;
+    }
+    // Replacements are not searched again
+    confirmation.from =
+        confirmation.match_start == confirmation.match_end
+            ? replacement_end + 1
+            : replacement_end;
+    if (!confirmation.substitution.global) {
+        ++confirmation.line;
+        confirmation.from = 0;
+    }
+}
+
+void Editor::confirm_next() {
+    // Move to the next match and ask about it, or finish the substitution
+    Confirmation &confirmation = *confirmation_;
+    for (; confirmation.line <= confirmation.last_line;
+         ++confirmation.line, confirmation.from = 0) {
+        const std::string &line = buffer_.get_lines()[confirmation.line];
+        if (confirmation.from <= line.length() &&
+            confirmation.substitution.search_pattern.find(
+                line, confirmation.from, confirmation.match_start,
+                confirmation.match_end)) {
+            normal_jump_line(confirmation.line);
+            buffer_.position.x = static_cast<int>(confirmation.match_start);
+            last_column_ = buffer_.position.x;
+            update();
+            print_message("replace with " +
+                          confirmation.substitution.replacement +
+                          " (y/n/a/q/l)?");
+            return;
+        }
+    }
+    int match_count = confirmation.match_count;
+    int line_count = confirmation.line_count;
+    std::string pattern = confirmation.substitution.pattern;
+    confirmation_.reset();
+    if (match_count == 0) {
+        print_error("Pattern not found: " + pattern);
+        return;
+    }
+    report_substitutions(match_count, line_count);
+}
+
+void Editor::report_substitutions(int match_count, int line_count) {
+    // Substitutions of a few lines are visible without a message
+    if (line_count > 2) {
+        print_message(std::to_string(match_count) + " substitutions on " +
+                      std::to_string(line_count) + " lines");
+    }
+}
+
+void Editor::command_append(const LineRange &range, const std::string &arg) {
+    // Index of the new line, line zero appends above the first line
+    int line = 0;
+    if (range.end != 0) {
+        int start = 0;
+        if (!get_range_lines(range, start, line)) {
+            return;
+        }
+        ++line;
+    }
+    if (zero_lines_) {
+        buffer_.set_line(arg, 0);
+        zero_lines_ = false;
+        line = 0;
+    } else {
+        buffer_.insert_line(arg, line);
+    }
+    normal_jump_line(line);
+    normal_first_non_blank_char(first_line_ + buffer_.position.y);
+}
+
+void Editor::command_global(const LineRange &range, bool inverse,
+                            const std::string &arg) {
+    Global global;
+    if (!parse_global(arg, inverse, global)) {
+        print_error(global.search_pattern.is_valid()
+                        ? "Invalid global pattern: " + arg
+                        : "Invalid pattern: " +
+                              global.search_pattern.get_error());
+        return;
+    }
+    std::vector<Command> commands = get_command(global.command);
+    if (commands.empty()) {
+        print_error("Missing global command: " + arg);
+        return;
+    }
+    Substitution substitution;
+    for (const Command &c : commands) {
+        if (c.type == CommandType::GLOBAL) {
+            print_error("Cannot run a global command recursively");
+            return;
+        }
+        if (c.type == CommandType::SUBSTITUTE &&
+            parse_substitution(c.arg, substitution) && substitution.confirm) {
+            print_error("Cannot confirm substitutions in a global command");
+            return;
+        }
+    }
+    int start = 0;
+    int end = 0;
+    if (!get_range_lines(range, start, end)) {
+        return;
+    }
+    // Lines are marked before any of them changes
+    std::vector<int> marked =
+        mark_lines(buffer_.get_lines(), start, end, global, get_search_pool(),
+                   get_search_filter(global.search_pattern));
+    if (marked.empty()) {
+        print_error((inverse ? "Pattern found in every line: "
+                             : "Pattern not found: ") +
+                    global.pattern);
+        return;
+    }
+    const Command &first = commands.front();
+    bool single = commands.size() == 1 && !first.has_range;
+    if (single && first.type == CommandType::DELETE) {
+        // Marked lines are removed in one pass instead of one at a time
+        int removed = static_cast<int>(marked.size());
+        buffer_.remove_lines(marked);
+        if (buffer_.get_size() == 0) {
+            zero_lines_ = true;
+            buffer_.push_back_line("");
+        }
+        normal_jump_line(
+            std::min(marked.back() - removed + 1, buffer_.get_size() - 1));
+        normal_first_non_blank_char(first_line_ + buffer_.position.y);
+        if (removed > 2) {
+            print_message(std::to_string(removed) + " fewer lines");
+        }
+        return;
+    }
+    if (single && first.type == CommandType::SUBSTITUTE) {
+        // The pattern is compiled once for every marked line
+        if (!parse_substitution(first.arg, substitution)) {
+            command_substitute(first.range, first.arg);
+            return;
+        }
+        int match_count = 0;
+        std::vector<int> changed =
+            buffer_.change_lines([&](std::vector<std::string> &lines) {
+                std::vector<int> substituted;
+                std::string result;
+                for (int line : marked) {
+                    int count = substitute(lines[line], substitution, result);
+                    if (count > 0) {
+                        match_count += count;
+                        lines[line].assign(result);
+                        substituted.push_back(line);
+                    }
+                }
+                return substituted;
+            });
+        if (changed.empty()) {
+            print_error("Pattern not found: " + substitution.pattern);
+            return;
+        }
+        normal_jump_line(changed.back());
+        normal_first_non_blank_char(first_line_ + buffer_.position.y);
+        report_substitutions(match_count, static_cast<int>(changed.size()));
+        return;
+    }
+    // Marks follow the changes of the commands, so that lines a command
+    // removed are not run on
+    GlobalMarks marks(std::move(marked));
+    buffer_.add_observer(&marks);
+    int line = 0;
+    while (mode_.get_type() != ModeType::EXIT && marks.next(line)) {
+        normal_jump_line(line);
+        run_commands(commands, global.command);
+    }
+    buffer_.remove_observer(&marks);
+}
+
+void Editor::search(const std::string &pattern, bool forward, int count) {
+    // An empty pattern repeats the last search in the new direction
+    if (!pattern.empty() && pattern != search_pattern_.get_source()) {
+        search_pattern_.set(pattern);
+    }
+    last_search_forward_ = forward;
+    search_next(forward, count);
+}
+
+void Editor::search_next(bool forward, int count) {
+    if (search_pattern_.empty()) {
+        print_error("No previous search pattern");
+        return;
+    }
+    if (!search_pattern_.is_valid()) {
+        print_error("Invalid pattern: " + search_pattern_.get_error());
+        return;
+    }
+    SearchDirection direction =
+        forward ? SearchDirection::FORWARD : SearchDirection::BACKWARD;
+    Position position(first_line_ + buffer_.position.y, buffer_.position.x);
+    LineFilter filter = get_search_filter(search_pattern_);
+    bool has_wrapped = false;
+    for (int i = 0; i < count; ++i) {
+        bool wrapped = false;
+        ThreadPool *pool = get_search_pool();
+        const std::vector<std::string> &lines = buffer_.get_lines();
+        bool found = pool == nullptr
+                         ? search_lines(lines, search_pattern_, position,
+                                        direction, position, wrapped, -1,
+                                        filter)
+                         : search_lines(*pool, lines, search_pattern_,
+                                        position, direction, position, wrapped,
+                                        filter);
+        if (!found) {
+            print_error("Pattern not found: " + search_pattern_.get_source());
+            return;
+        }
+        has_wrapped = has_wrapped || wrapped;
+    }
+    normal_jump_line(position.y);
+    buffer_.position.x = position.x;
+    last_column_ = buffer_.position.x;
+    std::string message =
+        has_wrapped ? (forward ? "search hit BOTTOM, continuing at TOP"
+                               : "search hit TOP, continuing at BOTTOM")
+                    : (forward ? '/' : '?') + search_pattern_.get_source();
+    print_message(message);
+    count_matches(message);
+}
+
+void Editor::count_matches(const std::string &message) {
+    // Count matches while waiting for input and add the count to the message
+    // of the search, only the last search is counted
+    if (match_counter_ != nullptr) {
+        remove_background_job(match_counter_);
+    }
+    if (!event_driven_) {
+        return;
+    }
+    Position position(first_line_ + buffer_.position.y, buffer_.position.x);
+    std::unique_ptr<MatchCounter> counter(new MatchCounter(
+        buffer_.get_lines(), search_pattern_, position, get_search_pool()));
+    MatchCounter *result = counter.get();
+    match_counter_ = result;
+    run_in_background(std::move(counter), [this, result, message] {
+        Position current(first_line_ + buffer_.position.y, buffer_.position.x);
+        if (mode_.get_type() != ModeType::NORMAL ||
+            !(current == result->get_position())) {
+            return;
+        }
+        print_message(message + " match " + format_count(result->get_index()) +
+                      " of " + format_count(result->get_count()));
+        needs_render_ = true;
+    });
+}
+
+ThreadPool *Editor::get_search_pool() {
+    // Small buffers are searched on the thread of the editor, and so is every
+    // buffer in batch mode where files are already edited in parallel
+    if (headless_ || buffer_.get_size() < PARALLEL_SEARCH_LINES) {
+        return nullptr;
+    }
+    if (search_pool_ == nullptr) {
+        search_pool_.reset(
+            new ThreadPool(ThreadPool::get_default_thread_count()));
+    }
+    return search_pool_.get();
+}
+
+void Editor::update_trigram_index() {
+    // Index the buffer while the trigramindex option is set, the saved index
+    // of the file is used if it is still valid
+    bool enabled = options_.get_bool_option("trigramindex");
+    if (enabled == (trigram_index_ != nullptr)) {
+        return;
+    }
+    if (!enabled) {
+        remove_background_job(trigram_index_builder_);
+        buffer_.remove_observer(trigram_index_.get());
+        trigram_index_.reset();
+        return;
+    }
+    trigram_index_.reset(new TrigramIndex());
+    buffer_.add_observer(trigram_index_.get());
+    std::string path = file_.get_path();
+    if (path.empty() || history_.has_unsaved_changes(buffer_.get_lines()) ||
+        !trigram_index_->load(TrigramIndex::get_index_path(path), path,
+                              buffer_.get_lines())) {
+        trigram_index_->reset(buffer_.get_lines());
+    }
+    build_trigram_index();
+}
+
+void Editor::build_trigram_index() {
+    // Lines waiting to be indexed are indexed while there is no input, or at
+    // once if input is not read by the event loop
+    if (trigram_index_ == nullptr || trigram_index_->is_complete() ||
+        trigram_index_builder_ != nullptr) {
+        return;
+    }
+    if (!event_driven_) {
+        trigram_index_->build(buffer_.get_lines(),
+                              Job::Clock::time_point::max());
+        return;
+    }
+    std::unique_ptr<Job> builder(
+        new TrigramIndexBuilder(*trigram_index_, buffer_.get_lines()));
+    trigram_index_builder_ = builder.get();
+    run_in_background(
+        std::move(builder), [this] { save_trigram_index(); }, true);
+}
+
+void Editor::save_trigram_index() {
+    // A saved index is only loaded with the file as it is on disk
+    std::string path = file_.get_path();
+    if (trigram_index_ != nullptr && !path.empty() &&
+        !history_.has_unsaved_changes(buffer_.get_lines())) {
+        trigram_index_->save(TrigramIndex::get_index_path(path), path);
+    }
+}
+
+LineFilter Editor::get_search_filter(const SearchPattern &pattern) {
+    // Skip blocks of lines that cannot contain the literals of the pattern
+    build_trigram_index();
+    if (trigram_index_ == nullptr) {
+        return LineFilter();
+    }
+    TrigramQuery query =
+        TrigramIndex::get_query(pattern.get_required_literals());
+    if (query.empty()) {
+        return LineFilter();
+    }
+    const TrigramIndex *index = trigram_index_.get();
+    return [index, query](int line, SearchDirection direction, int &run) {
+        return index->may_match(query, line,
+                                direction == SearchDirection::FORWARD, run);
+    };
+}
+
+void Editor::preview_search() {
+    // Move to the first match of the pattern being typed if it is on screen
+    // or shortly after, so that typing does not scan the whole buffer
+    set_view(search_origin_);
+    if (command_line_.empty() || !preview_pattern_.set(command_line_)) {
+        return;
+    }
+    Position from(search_origin_.first_line + search_origin_.position.y,
+                  search_origin_.position.x);
+    Position match;
+    bool wrapped = false;
+    if (search_lines(buffer_.get_lines(), preview_pattern_, from,
+                     command_prefix_ == '/' ? SearchDirection::FORWARD
+                                            : SearchDirection::BACKWARD,
+                     match, wrapped, buffer_lines_ + SEARCH_LOOKAHEAD)) {
+        normal_jump_line(match.y);
+        buffer_.position.x = match.x;
+        last_column_ = buffer_.position.x;
+    }
+}
+
+SearchPattern *Editor::get_highlight_pattern() {
+    // Matches of the pattern being typed are shown, matches of a substitution
+    // that asks before replacing, and matches of the last search if hlsearch
+    // is set
+    if (confirmation_ != nullptr) {
+        return &confirmation_->substitution.search_pattern;
+    }
+    if (mode_.get_type() == ModeType::COMMAND && command_prefix_ != ':') {
+        bool has_preview = !command_line_.empty() &&
+                           preview_pattern_.get_source() == command_line_ &&
+                           preview_pattern_.is_valid();
+        return has_preview ? &preview_pattern_ : nullptr;
+    }
+    if (options_.get_bool_option("hlsearch") && !search_pattern_.empty() &&
+        search_pattern_.is_valid()) {
+        return &search_pattern_;
+    }
+    return nullptr;
+}
+
+Editor::View Editor::get_view() const {
+    return {first_line_, buffer_.position, last_column_};
+}
+
+void Editor::set_view(const View &view) {
+    first_line_ = view.first_line;
+    buffer_.position = view.position;
+    last_column_ = view.last_column;
 }
 
 void Editor::visual_delete_selection() {
@@ -887,19 +2358,18 @@ void Editor::visual_delete_selection() {
     if (start.y == end.y) {
         buffer_.erase(start.x, end.x - start.x + 1, start.y);
     } else {
-        buffer_.erase(start.x, buffer_.get_line_length(start.y), start.y);
-        buffer_.erase(0, end.x + 1, end.y);
-        for (int i = start.y + 1; i < end.y; ++i) {
-            buffer_.set_line("", i);
-        }
-        buffer_.set_line(buffer_.lines[start.y] + buffer_.lines[end.y],
-                         start.y);
-        buffer_.set_line("", end.y);
-        for (int i = end.y; i >= start.y; --i) {
-            if (buffer_.get_line_length(i) == 0) {
-                buffer_.remove_line(i);
-            }
+        // The selected lines are replaced by what is left of the first and
+        // last line with a single splice, or removed if nothing is left
+        std::vector<std::string> joined;
+        const std::vector<std::string> &lines = buffer_.get_lines();
+        std::string line = lines[start.y].substr(0, start.x);
+        if (end.x + 1 < buffer_.get_line_length(end.y)) {
+            line.append(lines[end.y], end.x + 1, std::string::npos);
+        }
+        if (!line.empty()) {
+            joined.push_back(std::move(line));
         }
+        buffer_.replace_lines(start.y, end.y, std::move(joined));
         // Check if entire buffer was deleted
         if (buffer_.get_size() == 0) {
             zero_lines_ = true;
@@ -913,51 +2383,59 @@ void Editor::visual_delete_selection() {
 }
 
 void Editor::set_color(ColorForeground foreground, ColorBackground background) {
-    if (Interface::has_color_capability() &&
+    if (interface_.has_color_capability() &&
         colorscheme_manager_.has_colorscheme()) {
         short color_pair = get_color_pair_index(foreground, background);
-        Interface::attribute_on(color_pair);
+        interface_.attribute_on(color_pair);
         current_color_pair_ = {foreground, background};
     }
 }
 
 void Editor::unset_color() {
-    if (Interface::has_color_capability() &&
+    if (interface_.has_color_capability() &&
         colorscheme_manager_.has_colorscheme()) {
         short color_pair = get_color_pair_index(current_color_pair_.foreground,
                                                 current_color_pair_.background);
-        Interface::attribute_off(color_pair);
+        interface_.attribute_off(color_pair);
     }
 }
 
 void Editor::print_message(const std::string &message) {
     set_color(ColorForeground::DEFAULT, ColorBackground::DEFAULT);
-    Interface::mv_print(buffer_lines_, 0, message);
-    Interface::clear_to_eol();
-    Interface::move_cursor(cursor_position_.y, cursor_position_.x);
+    interface_.mv_print(buffer_lines_, 0, message);
+    interface_.clear_to_eol();
+    interface_.move_cursor(cursor_position_.y, cursor_position_.x);
     unset_color();
 }
 
 void Editor::print_error(const std::string &error) {
+    if (headless_) {
+        errors_.push_back(error);
+        return;
+    }
     set_color(ColorForeground::COLOR1, ColorBackground::DEFAULT);
-    Interface::mv_print(buffer_lines_, 0, "ERROR: " + error);
-    Interface::clear_to_eol();
-    Interface::move_cursor(cursor_position_.y, cursor_position_.x);
+    interface_.mv_print(buffer_lines_, 0, "ERROR: " + error);
+    interface_.clear_to_eol();
+    interface_.move_cursor(cursor_position_.y, cursor_position_.x);
     unset_color();
 }
 
 void Editor::exit_command_mode() {
+    if (command_prefix_ != ':') {
+        // Searches start from where the cursor was before the preview
+        set_view(search_origin_);
+    }
     cursor_position_.x = saved_position_.x;
     cursor_position_.y = saved_position_.y;
-    Interface::move_cursor(buffer_lines_, 0);
-    Interface::clear_to_eol();
-    Interface::move_cursor(cursor_position_.y, cursor_position_.x);
+    interface_.move_cursor(buffer_lines_, 0);
+    interface_.clear_to_eol();
+    interface_.move_cursor(cursor_position_.y, cursor_position_.x);
 }
 
 void Editor::exit_insert_mode() {
     clear_command_line();
-    int new_x = Interface::get_current_x();
-    if (new_x - 1 >= line_number_width_ + 1) {
+    // Step back onto the last inserted character
+    if (buffer_.position.x > 0) {
         --buffer_.position.x;
     }
     last_column_ = buffer_.position.x;
@@ -967,6 +2445,9 @@ void Editor::exit_insert_mode() {
 void Editor::exit_normal_mode() { bind_count_.reset(); }
 
 void Editor::exit_visual_mode() {
+    // Lines of the selection are kept for the '< and '> addresses
+    visual_start_line_ = std::min(visual_line_, current_line_);
+    visual_end_line_ = std::max(visual_line_, current_line_);
     clear_command_line();
     bind_count_.reset();
 }
@@ -1,35 +1,109 @@
 #ifndef CLADITOR_EDITOR_HPP
 #define CLADITOR_EDITOR_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "bind_count.hpp"
 #include "buffer.hpp"
+#include "change.hpp"
 #include "color.hpp"
 #include "colorscheme_manager.hpp"
+#include "command.hpp"
+#include "event_loop.hpp"
 #include "file.hpp"
+#include "global.hpp"
 #include "history.hpp"
 #include "interface.hpp"
+#include "job.hpp"
+#include "keymap.hpp"
+#include "latency.hpp"
+#include "macro.hpp"
 #include "mode.hpp"
 #include "options.hpp"
 #include "position.hpp"
+#include "search.hpp"
+#include "sort.hpp"
+#include "substitution.hpp"
+#include "thread_pool.hpp"
+#include "trigram_index.hpp"
 
 class Editor {
    public:
     explicit Editor(const std::string &, const std::stringstream &);
     void start(const std::string &);
+    // Run commands and then keys without drawing, write the file if it was
+    // modified and return the errors that occurred. Configuration is loaded
+    // once by the caller so that it can be shared between editors
+    std::vector<std::string> run_batch(const std::string &,
+                                       const std::vector<int> &,
+                                       const Options &, const Keymap &);
 
     void run_command(const std::string &);
 
 #ifdef UNIT_TEST
     void set_interface(const std::vector<int> &, int, int);
     std::stringstream get_buffer_stream();
+    std::uintptr_t get_input_stack_range() const;
+    int get_frame_count() const;
 #endif
 
    private:
+    // States are member functions that handle one input and return the state
+    // that handles the next input
+    struct State;
+    using StateCallback = State (Editor::*)(int);
+    struct State {
+        StateCallback callback;
+    };
+    struct TypeaheadKey {
+        int key;
+        bool noremap;
+    };
+    // Key read by the event loop and when the interface returned it
+    struct PendingKey {
+        int key;
+        LatencyRecorder::Clock::time_point time;
+    };
+    // Job run while waiting for input
+    struct BackgroundJob {
+        std::unique_ptr<Job> job;
+        // Version of the buffer that the job reads, it is dropped once the
+        // buffer changes unless it follows the edits
+        std::uint64_t version;
+        bool follows_edits;
+        std::function<void()> on_finish;
+    };
+    // Substitution that asks before replacing each match
+    struct Confirmation {
+        Substitution substitution;
+        int line;
+        // Matches are looked for from this index of the line
+        std::size_t from;
+        int last_line;
+        // Match that is being asked about
+        std::size_t match_start;
+        std::size_t match_end;
+        int match_count;
+        int line_count;
+        // Last line that a match was replaced in
+        int changed_line;
+    };
+    // Part of the buffer that is shown and where the cursor is
+    struct View {
+        int first_line;
+        Position position;
+        int last_column;
+    };
+
     Mode mode_;
     Position cursor_position_;
     Position saved_position_;
@@ -39,43 +113,122 @@ class Editor {
     int previous_first_line_;
     int current_line_;
     int visual_line_;
+    // First and last line of the last visual selection, -1 if there was none
+    int visual_start_line_;
+    int visual_end_line_;
     int line_number_width_;
     int buffer_lines_;
     int horizontal_offset_;
     ColorPair current_color_pair_;
     bool zero_lines_;
+    // Lines yanked or deleted by commands, put by p and P
+    std::vector<std::string> yanked_lines_;
+    // Position of the pending key sequence in the keymap
+    int pending_node_;
+    bool pending_noremap_;
+    // Whether the last input should only be dispatched against default binds
+    bool noremap_input_;
+    int mapping_depth_;
+    // Whether the last input was read from the interface
+    bool typed_input_;
+    int macro_count_;
+    // Whether the editor runs without a terminal
+    bool headless_;
+    // Whether input is read by the event loop
+    bool event_driven_;
+    // Whether an event changed what is on screen
+    bool needs_render_;
+    int autosave_timer_;
+    int autosave_interval_;
+    bool latency_enabled_;
+    // Character shown before the command line, either ':', '/' or '?'
+    char command_prefix_;
+    // Count given to the search that is being typed
+    int search_count_;
+    bool last_search_forward_;
+    SearchPattern search_pattern_;
+    // Pattern that is being typed
+    SearchPattern preview_pattern_;
+    // View before the search that is being typed
+    View search_origin_;
+    MatchCache match_cache_;
+    // Created for the first search of a large buffer
+    std::unique_ptr<ThreadPool> search_pool_;
+    // Substitution waiting for an answer if it asks before replacing
+    std::unique_ptr<Confirmation> confirmation_;
+    std::deque<BackgroundJob> background_jobs_;
+    // Counter of the last search if it has not finished
+    Job *match_counter_;
+    // Kept up to date by the buffer while the trigramindex option is set
+    std::unique_ptr<TrigramIndex> trigram_index_;
+    Job *trigram_index_builder_;
     File file_;
     Options options_;
+    Keymap keymap_;
+    // Keys that are handled before reading from the interface
+    std::deque<TypeaheadKey> typeahead_;
+    MacroRecorder macro_recorder_;
+    LatencyRecorder latency_;
+    Change last_change_;
+    // Change that is being recorded while in insert mode
+    Change pending_change_;
+    // Errors collected while headless
+    std::vector<std::string> errors_;
+#ifdef UNIT_TEST
+    int frame_count_ = 0;
+#endif
     ColorschemeManager colorscheme_manager_;
     std::string command_line_;
     BindCount bind_count_;
     Buffer buffer_;
     History history_;
     Interface interface_;
+    EventLoop event_loop_;
+    // Keys read by the event loop that have not been handled
+    std::deque<PendingKey> pending_input_;
 
     void print_buffer();
     void print_command_line();
     void clear_command_line();
     void update();
+    void render();
+    void resize();
+    int get_input();
+    // Keys are returned with the time that they were read at
+    int read_input(LatencyRecorder::Clock::time_point &);
+    int wait_for_input(LatencyRecorder::Clock::time_point &);
+    void add_event_sources();
+    void set_autosave_timer();
+    bool run_job(Job &);
+    void run_in_background(std::unique_ptr<Job>, const std::function<void()> &,
+                           bool = false);
+    void remove_background_job(const Job *);
+    void run_background_slice();
+    void write_file();
+    void write_latency_log();
     Position get_visual_start_position();
     Position get_visual_end_position();
     bool needs_visual_highlight(int, int);
 
-    void normal_and_visual(int);
-    bool normal_state(int);
-    bool insert_state(int);
-    void visual_state(int);
-    bool visual_regular_state(int);
-    bool visual_line_state(int);
-    bool command_state(int);
-    void state_enter(bool (Editor::*)(int));
-
-    void can_repeat(void (Editor::*)());
+    State normal_state(int);
+    State insert_state(int);
+    State visual_state(int);
+    State command_state(int);
+    State keymap_state(KeymapMode, int);
+    State run_binding(const Binding &);
+    State run_action(Action);
+    void repeat_change(int);
+    State macro_record_state(int);
+    State confirm_state(int);
+    State macro_execute_state(int);
+    void push_typeahead(const std::vector<int> &, int, bool);
+    State get_mode_state() const;
+    void state_loop(State);
 
     // Normal mode binds
     void normal_first_char();
     void normal_first_non_blank_char(int);
-    void normal_delete();
+    void normal_delete(int);
     void normal_end_of_file();
     void normal_append_after_cursor();
     void normal_append_end_of_line();
@@ -85,22 +238,18 @@ class Editor {
     void normal_jump_line(int);
     void normal_center_line(int);
     void normal_delete_line(int);
+    void normal_put(int, bool);
     void normal_add_count(int);
-    void normal_page_down();
-    void normal_page_up();
-    // Normal mode command states
-    bool normal_command_g_state(int);
-    bool normal_command_z_state(int);
-    bool normal_command_d_state(int);
-    bool normal_add_count_state(int);
+    void normal_page_down(int);
+    void normal_page_up(int);
 
     // Standard movement
     int get_adjusted_x();
     void adjusted_move(int, int) const;
-    void move_up();
-    void move_right();
-    void move_down();
-    void move_left();
+    void move_up(int);
+    void move_right(int);
+    void move_down(int);
+    void move_left(int);
 
     // Insert mode binds
     void insert_backspace();
@@ -112,6 +261,40 @@ class Editor {
     void command_backspace();
     void command_enter();
     void command_char(int);
+    void run_commands(const std::vector<Command> &, const std::string &);
+    bool get_address_line(std::int64_t, std::int64_t, const std::string &, int,
+                          int &);
+    bool get_range_lines(const LineRange &, int &, int &);
+    bool get_destination_line(const std::string &, int &);
+    void command_jump(const LineRange &);
+    void command_write(const LineRange &, bool, const std::string &);
+    void command_read(const LineRange &, const std::string &);
+    void command_delete(const LineRange &);
+    void command_yank(const LineRange &);
+    void command_move(const LineRange &, const std::string &);
+    void command_copy(const LineRange &, const std::string &);
+    void command_shift(const LineRange &, int, bool);
+    void command_sort(const LineRange &, bool, const std::string &);
+    void command_filter(const LineRange &, const std::string &);
+    void command_shell(const std::string &);
+    void command_substitute(const LineRange &, const std::string &);
+    void confirm_replace();
+    void confirm_next();
+    void report_substitutions(int, int);
+    void command_append(const LineRange &, const std::string &);
+    void command_global(const LineRange &, bool, const std::string &);
+    void search(const std::string &, bool, int);
+    void search_next(bool, int);
+    void preview_search();
+    void count_matches(const std::string &);
+    ThreadPool *get_search_pool();
+    void update_trigram_index();
+    void build_trigram_index();
+    void save_trigram_index();
+    LineFilter get_search_filter(const SearchPattern &);
+    SearchPattern *get_highlight_pattern();
+    View get_view() const;
+    void set_view(const View &);
 
     // Visual mode binds
     void visual_delete_selection();
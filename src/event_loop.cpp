@@ -0,0 +1,190 @@
+#include "event_loop.hpp"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+// Events of a directory that can change the contents of a file inside of it,
+// the directory is watched so that files replaced by a rename are followed
+const uint32_t FILE_EVENTS = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE |
+                             IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                             IN_ATTRIB;
+
+void split_path(const std::string &path, std::string &directory,
+                std::string &name) {
+    std::string::size_type slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        directory = ".";
+        name = path;
+    } else {
+        directory = slash == 0 ? "/" : path.substr(0, slash);
+        name = path.substr(slash + 1);
+    }
+}
+
+void drain(int fd) {
+    uint64_t value = 0;
+    while (read(fd, &value, sizeof(value)) > 0) {
+    }
+}
+}  // namespace
+
+EventLoop::EventLoop() : inotify_fd_(-1), next_watch_id_(0) {}
+
+EventLoop::~EventLoop() {
+    for (int timer : timers_) {
+        close(timer);
+    }
+    if (inotify_fd_ != -1) {
+        close(inotify_fd_);
+    }
+}
+
+void EventLoop::add_reader(int fd, const Callback &callback) {
+    remove_reader(fd);
+    readers_.push_back({fd, callback});
+}
+
+void EventLoop::remove_reader(int fd) {
+    readers_.erase(std::remove_if(readers_.begin(), readers_.end(),
+                                  [fd](const Reader &reader) {
+                                      return reader.fd == fd;
+                                  }),
+                   readers_.end());
+}
+
+int EventLoop::add_timer(int interval, const Callback &callback) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    struct itimerspec spec {};
+    spec.it_interval.tv_sec = interval / 1000;
+    spec.it_interval.tv_nsec = static_cast<long>(interval % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(fd, 0, &spec, nullptr);
+    timers_.push_back(fd);
+    add_reader(fd, [fd, callback] {
+        drain(fd);
+        callback();
+    });
+    return fd;
+}
+
+void EventLoop::remove_timer(int id) {
+    std::vector<int>::iterator it =
+        std::find(timers_.begin(), timers_.end(), id);
+    if (it == timers_.end()) {
+        return;
+    }
+    timers_.erase(it);
+    remove_reader(id);
+    close(id);
+}
+
+int EventLoop::watch_file(const std::string &path, const Callback &callback) {
+    if (inotify_fd_ == -1) {
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ == -1) {
+            return -1;
+        }
+        add_reader(inotify_fd_, [this] { read_file_events(); });
+    }
+    std::string directory;
+    std::string name;
+    split_path(path, directory, name);
+    int descriptor =
+        inotify_add_watch(inotify_fd_, directory.c_str(), FILE_EVENTS);
+    if (descriptor == -1) {
+        return -1;
+    }
+    watches_.push_back({next_watch_id_, descriptor, name, callback});
+    return next_watch_id_++;
+}
+
+void EventLoop::remove_watch(int id) {
+    std::vector<FileWatch>::iterator it = std::find_if(
+        watches_.begin(), watches_.end(),
+        [id](const FileWatch &watch) { return watch.id == id; });
+    if (it == watches_.end()) {
+        return;
+    }
+    int descriptor = it->descriptor;
+    watches_.erase(it);
+    // Watches of files in the same directory share a descriptor
+    if (std::none_of(watches_.begin(), watches_.end(),
+                     [descriptor](const FileWatch &watch) {
+                         return watch.descriptor == descriptor;
+                     })) {
+        inotify_rm_watch(inotify_fd_, descriptor);
+    }
+}
+
+bool EventLoop::run_once(int timeout) {
+    std::vector<pollfd> fds;
+    fds.reserve(readers_.size());
+    for (const Reader &reader : readers_) {
+        fds.push_back({reader.fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), timeout) <= 0) {
+        // Timed out or interrupted by a signal
+        return false;
+    }
+    bool ran = false;
+    // Callbacks may add or remove readers, so look each one up again
+    for (std::vector<pollfd>::size_type i = 0; i < fds.size(); ++i) {
+        if (fds[i].revents == 0) {
+            continue;
+        }
+        int fd = fds[i].fd;
+        std::vector<Reader>::iterator it = std::find_if(
+            readers_.begin(), readers_.end(),
+            [fd](const Reader &reader) { return reader.fd == fd; });
+        if (it != readers_.end()) {
+            Callback callback = it->callback;
+            callback();
+            ran = true;
+        }
+    }
+    return ran;
+}
+
+void EventLoop::read_file_events() {
+    alignas(inotify_event) char buffer[4096];
+    std::vector<int> changed;
+    ssize_t length = 0;
+    while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+        for (char *position = buffer; position < buffer + length;) {
+            const inotify_event *event =
+                reinterpret_cast<const inotify_event *>(position);
+            std::string name = event->len > 0 ? event->name : "";
+            for (const FileWatch &watch : watches_) {
+                if (watch.descriptor == event->wd && watch.name == name) {
+                    changed.push_back(watch.id);
+                }
+            }
+            position += sizeof(inotify_event) + event->len;
+        }
+    }
+    // A burst of events for a file results in a single callback
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    for (int id : changed) {
+        std::vector<FileWatch>::iterator it = std::find_if(
+            watches_.begin(), watches_.end(),
+            [id](const FileWatch &watch) { return watch.id == id; });
+        if (it != watches_.end()) {
+            Callback callback = it->callback;
+            callback();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef CLADITOR_EVENT_LOOP_HPP
+#define CLADITOR_EVENT_LOOP_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Waits on file descriptors, timers and file changes with a single poll so
+// that idle time can be used for events
+class EventLoop {
+   public:
+    using Callback = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // Run callback whenever the file descriptor is readable
+    void add_reader(int, const Callback &);
+    void remove_reader(int);
+    // Run callback periodically given an interval in milliseconds and return
+    // an identifier of the timer
+    int add_timer(int, const Callback &);
+    void remove_timer(int);
+    // Run callback when the file at the path is written, created, moved or
+    // removed and return an identifier of the watch
+    int watch_file(const std::string &, const Callback &);
+    void remove_watch(int);
+    // Wait for events given a timeout in milliseconds, negative waits
+    // indefinitely, and return whether any callback ran
+    bool run_once(int);
+
+   private:
+    struct Reader {
+        int fd;
+        Callback callback;
+    };
+    struct FileWatch {
+        int id;
+        int descriptor;
+        std::string name;
+        Callback callback;
+    };
+
+    int inotify_fd_;
+    int next_watch_id_;
+    std::vector<Reader> readers_;
+    // Timer descriptors owned by the loop
+    std::vector<int> timers_;
+    std::vector<FileWatch> watches_;
+
+    void read_file_events();
+};
+#endif
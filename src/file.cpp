@@ -1,5 +1,7 @@
 #include "file.hpp"
 
+#include <sys/stat.h>
+
 #include <exception>
 #include <fstream>
 #include <sstream>
@@ -13,7 +15,7 @@ struct FileError : public std::runtime_error {
 };
 
 File::File(const std::string &file_path, const std::stringstream &file_stream)
-    : file_path_(file_path) {
+    : file_path_(file_path), disk_state_(get_disk_state()) {
     file_stream_.str(file_stream.str());
 }
 
@@ -26,17 +28,30 @@ std::vector<std::string> File::get_content() {
     return file_content;
 }
 
-void File::write_content(const std::vector<std::string> &content) {
-#ifndef UNIT_TEST
-    if (!content.empty()) {
-        std::ofstream file;
-        file.open(file_path_.c_str(), std::ios::out);
-        for (const std::string &line : content) {
-            file << line << '\n';
-        }
-        file.close();
+std::string File::get_path() const { return file_path_; }
+
+bool File::has_changed_on_disk() {
+    DiskState disk_state = get_disk_state();
+    if (disk_state == disk_state_) {
+        return false;
     }
-#endif
+    disk_state_ = disk_state;
+    return true;
 }
 
-std::string File::get_path() const { return file_path_; }
+void File::mark_written() { disk_state_ = get_disk_state(); }
+
+bool File::DiskState::operator==(const DiskState &other) const {
+    return exists == other.exists && size == other.size &&
+           modification_time == other.modification_time;
+}
+
+File::DiskState File::get_disk_state() const {
+    struct stat file_stat;
+    if (file_path_.empty() || stat(file_path_.c_str(), &file_stat) != 0) {
+        return {false, 0, 0};
+    }
+    return {true, static_cast<long long>(file_stat.st_size),
+            static_cast<long long>(file_stat.st_mtim.tv_sec) * 1000000000 +
+                file_stat.st_mtim.tv_nsec};
+}
@@ -10,12 +10,27 @@ class File {
    public:
     File(const std::string &, const std::stringstream &);
     std::vector<std::string> get_content();
-    void write_content(const std::vector<std::string> &);
     std::string get_path() const;
+    // Whether the file was changed by another program since it was last read
+    // or written, the change is only reported once
+    bool has_changed_on_disk();
+    // Remember the state of the file after it was written by the editor
+    void mark_written();
 
    private:
+    struct DiskState {
+        bool exists;
+        long long size;
+        long long modification_time;
+
+        bool operator==(const DiskState &) const;
+    };
+
     std::string file_path_;
     std::stringstream file_stream_;
+    DiskState disk_state_;
+
+    DiskState get_disk_state() const;
 };
 
 #endif
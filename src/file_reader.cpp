@@ -0,0 +1,51 @@
+#include "file_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+bool read_lines(const std::string &file_path,
+                std::vector<std::string> &lines) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+        close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(file_stat.st_size);
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    const char *position = static_cast<const char *>(data);
+    const char *end = position + size;
+    // Lines are counted first so that the vector grows once
+    lines.reserve(lines.size() +
+                  static_cast<std::size_t>(std::count(position, end, '\n')) +
+                  (end[-1] == '\n' ? 0 : 1));
+    while (position < end) {
+        const char *newline = static_cast<const char *>(
+            std::memchr(position, '\n', end - position));
+        const char *line_end = newline == nullptr ? end : newline;
+        lines.emplace_back(position, line_end);
+        position = line_end + 1;
+    }
+    munmap(data, size);
+    return true;
+}
@@ -0,0 +1,10 @@
+#ifndef CLADITOR_FILE_READER_HPP
+#define CLADITOR_FILE_READER_HPP
+
+#include <string>
+#include <vector>
+
+// Append the lines of a regular file to the vector, reading them straight
+// from a memory mapping of the file. Returns false if it cannot be read
+bool read_lines(const std::string &, std::vector<std::string> &);
+#endif
@@ -0,0 +1,153 @@
+#include "file_writer.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+namespace {
+// Number of lines written between checks of the deadline
+const std::size_t LINES_PER_CHECK = 4096;
+const std::size_t WRITE_BUFFER_SIZE = 1 << 16;
+}  // namespace
+
+FileWriter::FileWriter(const std::string &file_path,
+                       const std::vector<std::string> &lines)
+    : FileWriter(file_path, lines, 0, lines.size(), false) {}
+
+FileWriter::FileWriter(const std::string &file_path,
+                       const std::vector<std::string> &lines,
+                       std::size_t first, std::size_t end, bool append)
+    : file_path_(file_path),
+      lines_(lines),
+      first_line_(first),
+      end_line_(end),
+      written_lines_(first),
+      append_(append),
+      append_offset_(-1),
+      in_place_(false),
+      buffer_(WRITE_BUFFER_SIZE),
+      failed_(false),
+      finished_(false) {}
+
+FileWriter::~FileWriter() {
+    if (!finished_) {
+        cancel();
+    }
+}
+
+bool FileWriter::run_slice(Clock::time_point deadline) {
+    if (finished_) {
+        return true;
+    }
+    if (output_path_.empty() && !open()) {
+        fail();
+        return true;
+    }
+    while (written_lines_ < end_line_) {
+        std::size_t end = std::min(end_line_, written_lines_ + LINES_PER_CHECK);
+        for (; written_lines_ < end; ++written_lines_) {
+            file_ << lines_[written_lines_] << '\n';
+        }
+        if (!file_) {
+            fail();
+            return true;
+        }
+        if (written_lines_ < end_line_ && Clock::now() >= deadline) {
+            return false;
+        }
+    }
+    file_.close();
+    bool replaced = output_path_ == file_path_ ||
+                    std::rename(output_path_.c_str(), file_path_.c_str()) == 0;
+    if (!file_ || !replaced) {
+        fail();
+        return true;
+    }
+    finished_ = true;
+    return true;
+}
+
+double FileWriter::get_progress() const {
+    return end_line_ == first_line_
+               ? 1.0
+               : static_cast<double>(written_lines_ - first_line_) /
+                     static_cast<double>(end_line_ - first_line_);
+}
+
+std::string FileWriter::get_description() const {
+    return "Writing \"" + file_path_ + "\"";
+}
+
+void FileWriter::cancel() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+    if (append_ && append_offset_ >= 0) {
+        truncate(file_path_.c_str(), static_cast<off_t>(append_offset_));
+    } else if (!output_path_.empty() && !in_place_) {
+        unlink(output_path_.c_str());
+    }
+    finished_ = true;
+}
+
+bool FileWriter::has_failed() const { return failed_; }
+
+bool FileWriter::must_write_in_place(const struct stat &file_stat) const {
+    struct stat link_stat;
+    bool is_link = lstat(file_path_.c_str(), &link_stat) == 0 &&
+                   S_ISLNK(link_stat.st_mode);
+    return is_link || file_stat.st_nlink > 1 ||
+           file_stat.st_uid != geteuid() || file_stat.st_gid != getegid();
+}
+
+bool FileWriter::open() {
+    if (file_path_.empty()) {
+        return false;
+    }
+    struct stat file_stat;
+    bool exists = stat(file_path_.c_str(), &file_stat) == 0;
+    if (append_) {
+        output_path_ = file_path_;
+        append_offset_ =
+            exists ? static_cast<long long>(file_stat.st_size) : -1;
+        file_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+        file_.open(output_path_, std::ios::out | std::ios::app);
+        return file_.is_open();
+    }
+    if (exists && must_write_in_place(file_stat)) {
+        // Renaming over the file would turn a symlink into a regular file,
+        // split hard links or give the file to the current user
+        output_path_ = file_path_;
+        in_place_ = true;
+    } else if (exists) {
+        // Create the temporary file next to the file so that it can be renamed
+        // and keep the permissions of the file
+        std::string temporary_path = file_path_ + ".XXXXXX";
+        int fd = mkstemp(&temporary_path[0]);
+        if (fd == -1) {
+            return false;
+        }
+        fchmod(fd, file_stat.st_mode & 07777);
+        close(fd);
+        output_path_ = temporary_path;
+    } else {
+        // There is nothing to keep intact for a new file
+        output_path_ = file_path_;
+    }
+    file_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+    file_.open(output_path_, std::ios::out | std::ios::trunc);
+    return file_.is_open();
+}
+
+void FileWriter::fail() {
+    failed_ = true;
+    cancel();
+}
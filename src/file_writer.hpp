@@ -0,0 +1,57 @@
+#ifndef CLADITOR_FILE_WRITER_HPP
+#define CLADITOR_FILE_WRITER_HPP
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+// Writes lines to a temporary file in slices and replaces the file with it
+// once every line is written, so that a cancelled write leaves the file intact.
+// Appended lines are written to the file itself and cut off if cancelled.
+// Symlinks, files with several hard links and files owned by someone else are
+// written in place since replacing them would change what the path refers to,
+// a cancelled write then leaves them cut short
+class FileWriter : public Job {
+   public:
+    // Lines must not change while the job is running
+    FileWriter(const std::string &, const std::vector<std::string> &);
+    // Write the lines from first up to but not including end, or append them
+    // to the file
+    FileWriter(const std::string &, const std::vector<std::string> &,
+               std::size_t, std::size_t, bool);
+    ~FileWriter() override;
+
+    bool run_slice(Clock::time_point) override;
+    double get_progress() const override;
+    std::string get_description() const override;
+    void cancel() override;
+    bool has_failed() const;
+
+   private:
+    std::string file_path_;
+    // Path that lines are written to, a temporary file if the file exists
+    std::string output_path_;
+    const std::vector<std::string> &lines_;
+    std::size_t first_line_;
+    std::size_t end_line_;
+    std::size_t written_lines_;
+    bool append_;
+    // Size of the file before lines were appended, -1 if it did not exist
+    long long append_offset_;
+    // The existing file is truncated and written to directly
+    bool in_place_;
+    std::vector<char> buffer_;
+    std::ofstream file_;
+    bool failed_;
+    bool finished_;
+
+    bool must_write_in_place(const struct stat &) const;
+    bool open();
+    void fail();
+};
+#endif
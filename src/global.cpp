@@ -0,0 +1,143 @@
+#include "global.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "search.hpp"
+#include "substitution.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// Lines marked by a task of a parallel global command before it takes another
+// chunk
+const int MARK_CHUNK_LINES = 16384;
+
+void mark_chunk(const std::vector<std::string> &lines, int first, int last,
+                bool inverse, SearchPattern &pattern, const LineFilter &filter,
+                std::vector<int> &marked) {
+    std::size_t match_start = 0;
+    std::size_t match_end = 0;
+    int filtered = first;
+    for (int line = first; line <= last; ++line) {
+        if (filter && line >= filtered) {
+            int run = 1;
+            if (!filter(line, SearchDirection::FORWARD, run)) {
+                // None of the lines of the run match
+                int run_last = std::min(last, line + run - 1);
+                for (; inverse && line <= run_last; ++line) {
+                    marked.push_back(line);
+                }
+                line = run_last;
+                continue;
+            }
+            filtered = line + run;
+        }
+        if (pattern.find(lines[line], 0, match_start, match_end) != inverse) {
+            marked.push_back(line);
+        }
+    }
+}
+}  // namespace
+
+Global::Global() : inverse(false) {}
+
+bool parse_global(const std::string &arg, bool inverse, Global &global) {
+    if (arg.empty()) {
+        return false;
+    }
+    global = Global();
+    global.inverse = inverse;
+    std::string::size_type position =
+        read_delimited_part(arg, 1, arg[0], global.pattern);
+    global.command = arg.substr(position);
+    return !global.pattern.empty() &&
+           global.search_pattern.set(global.pattern);
+}
+
+std::vector<int> mark_lines(const std::vector<std::string> &lines, int first,
+                            int last, const Global &global, ThreadPool *pool,
+                            const LineFilter &filter) {
+    std::vector<int> marked;
+    if (pool == nullptr || last - first < MARK_CHUNK_LINES) {
+        SearchPattern pattern = global.search_pattern;
+        mark_chunk(lines, first, last, global.inverse, pattern, filter,
+                   marked);
+        return marked;
+    }
+    // Chunks keep their own marks so that they can be joined in order
+    int chunk_count = (last - first + MARK_CHUNK_LINES) / MARK_CHUNK_LINES;
+    std::vector<std::vector<int>> chunk_marks(chunk_count);
+    std::atomic<int> next_chunk(0);
+    for (int i = 0; i < pool->get_thread_count(); ++i) {
+        pool->submit([&] {
+            // Patterns build their automaton while matching, so every task
+            // has its own copy
+            SearchPattern pattern = global.search_pattern;
+            for (int chunk = next_chunk++; chunk < chunk_count;
+                 chunk = next_chunk++) {
+                int chunk_first = first + chunk * MARK_CHUNK_LINES;
+                int chunk_last =
+                    std::min(last, chunk_first + MARK_CHUNK_LINES - 1);
+                mark_chunk(lines, chunk_first, chunk_last, global.inverse,
+                           pattern, filter, chunk_marks[chunk]);
+            }
+        });
+    }
+    pool->wait();
+    std::size_t marked_count = 0;
+    for (const std::vector<int> &chunk : chunk_marks) {
+        marked_count += chunk.size();
+    }
+    marked.reserve(marked_count);
+    for (const std::vector<int> &chunk : chunk_marks) {
+        marked.insert(marked.end(), chunk.begin(), chunk.end());
+    }
+    return marked;
+}
+
+GlobalMarks::GlobalMarks(std::vector<int> marks)
+    : marks_(std::move(marks)), next_(0) {}
+
+bool GlobalMarks::next(int &line) {
+    if (next_ == marks_.size()) {
+        return false;
+    }
+    line = marks_[next_++];
+    return true;
+}
+
+void GlobalMarks::on_change(const std::vector<std::string> &,
+                            const BufferChange &change) {
+    if (change.removed == change.inserted) {
+        // Lines changed in place keep their marks
+        return;
+    }
+    int removed_end = change.first + change.removed;
+    int shift = change.inserted - change.removed;
+    // Marks are in increasing order, so only the marks from the first
+    // changed line on move
+    std::vector<int>::iterator kept = std::lower_bound(
+        marks_.begin() + static_cast<std::ptrdiff_t>(next_), marks_.end(),
+        change.first);
+    for (std::vector<int>::iterator mark = kept; mark != marks_.end();
+         ++mark) {
+        if (*mark >= removed_end) {
+            *kept++ = *mark + shift;
+        } else if (change.rows != nullptr) {
+            // Only the given rows of a scattered removal are gone, the lines
+            // between them move up by the rows removed before them
+            const std::vector<int> &rows = *change.rows;
+            std::vector<int>::const_iterator row =
+                std::lower_bound(rows.begin(), rows.end(), *mark);
+            if (row == rows.end() || *row != *mark) {
+                *kept++ = *mark - static_cast<int>(row - rows.begin());
+            }
+        }
+    }
+    marks_.erase(kept, marks_.end());
+}
@@ -0,0 +1,51 @@
+#ifndef CLADITOR_GLOBAL_HPP
+#define CLADITOR_GLOBAL_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+// Argument of the global command
+struct Global {
+    Global();
+
+    std::string pattern;
+    // Command that runs on every marked line
+    std::string command;
+    // Mark the lines that do not match instead
+    bool inverse;
+    // Pattern compiled by parse_global
+    SearchPattern search_pattern;
+};
+
+// Parse "/pattern/command" where the first character is the delimiter,
+// returns false if the argument or the pattern is invalid
+bool parse_global(const std::string &, bool, Global &);
+// Return the lines from first to last inclusive that the global command runs
+// on in order, marked in chunks on the pool if it is given. Blocks of lines
+// that the filter rejects are known not to match
+std::vector<int> mark_lines(const std::vector<std::string> &, int, int,
+                            const Global &, ThreadPool *,
+                            const LineFilter & = LineFilter());
+
+// Marked lines that a global command has not run on yet. Marks follow the
+// lines that commands insert or remove, and marks of removed lines are dropped
+class GlobalMarks : public BufferObserver {
+   public:
+    explicit GlobalMarks(std::vector<int>);
+    // Take the next mark, returns false once every mark is taken
+    bool next(int &);
+    void on_change(const std::vector<std::string> &,
+                   const BufferChange &) override;
+
+   private:
+    std::vector<int> marks_;
+    // Marks before it have been taken
+    std::size_t next_;
+};
+
+#endif
@@ -1,116 +1,237 @@
 #include "interface.hpp"
 
 #ifndef UNIT_TEST
+#include <fcntl.h>
 #include <ncurses.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
 #endif
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "color.hpp"
 
-Interface::Interface() : lines(0), columns(0) { update(); }
+#ifndef UNIT_TEST
+namespace {
+// Self-pipe written to by the SIGWINCH handler so that resizes can be picked
+// up outside of signal context
+int resize_pipe[2] = {-1, -1};
+
+void handle_resize(int) {
+    int saved_errno = errno;
+    char byte = 0;
+    if (write(resize_pipe[1], &byte, 1) < 0) {
+        // Pipe is full, a resize is already pending
+    }
+    errno = saved_errno;
+}
+}  // namespace
+#endif
+
+Interface::Interface()
+    : lines(0), columns(0), headless_(false), current_input_(0) {
+    update();
+}
 
 void Interface::update() {
 #ifndef UNIT_TEST
+    if (headless_) {
+        return;
+    }
     lines = LINES;
     columns = COLS;
 #endif
 }
 
-int Interface::refresh() {
+void Interface::install_resize_handler() {
+#ifndef UNIT_TEST
+    if (resize_pipe[0] != -1 || pipe(resize_pipe) != 0) {
+        return;
+    }
+    for (int fd : resize_pipe) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    struct sigaction action {};
+    action.sa_handler = handle_resize;
+    sigemptyset(&action.sa_mask);
+    // No SA_RESTART so that a blocking getch is interrupted by the resize
+    action.sa_flags = 0;
+    sigaction(SIGWINCH, &action, nullptr);
+#endif
+}
+
+bool Interface::has_resized() {
+    // Drain every pending resize event so that a burst of SIGWINCH signals
+    // results in a single relayout
+    bool resized = false;
+#ifndef UNIT_TEST
+    char bytes[64];
+    while (resize_pipe[0] != -1 &&
+           read(resize_pipe[0], bytes, sizeof(bytes)) > 0) {
+        resized = true;
+    }
+    if (resized) {
+        struct winsize size {};
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) {
+            resizeterm(size.ws_row, size.ws_col);
+        }
+        update();
+    }
+#endif
+    return resized;
+}
+
+int Interface::get_input_fd() const {
+#ifdef UNIT_TEST
+    return -1;
+#else
+    return headless_ ? -1 : STDIN_FILENO;
+#endif
+}
+
+int Interface::get_resize_fd() {
+#ifdef UNIT_TEST
+    return -1;
+#else
+    return resize_pipe[0];
+#endif
+}
+
+int Interface::refresh() const {
 #ifdef UNIT_TEST
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return wrefresh(stdscr);
 #endif
 }
 
-int Interface::cursor_set(int visibility) {
+int Interface::cursor_set(int visibility) const {
 #ifdef UNIT_TEST
     (void)(visibility);
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return curs_set(visibility);
 #endif
 }
 
-int Interface::move_cursor(int y, int x) {
+int Interface::move_cursor(int y, int x) const {
 #ifdef UNIT_TEST
     (void)(y);
     (void)(x);
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return move(y, x);
 #endif
 }
 
-int Interface::mv_print(int y, int x, const std::string &str) {
+int Interface::mv_print(int y, int x, const std::string &str) const {
 #ifdef UNIT_TEST
     (void)(y);
     (void)(x);
     (void)(str);
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return mvprintw(y, x, "%s", str.c_str());
 #endif
 }
 
-int Interface::mv_print_ch(int y, int x, char c) {
+int Interface::mv_print_ch(int y, int x, char c) const {
 #ifdef UNIT_TEST
     (void)(y);
     (void)(x);
     (void)(c);
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return mvaddch(y, x, c);
 #endif
 }
 
-int Interface::clear_to_eol() {
+int Interface::clear_to_eol() const {
 #ifdef UNIT_TEST
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return clrtoeol();
 #endif
 }
 
-int Interface::attribute_on(short color_pair) {
+int Interface::attribute_on(short color_pair) const {
 #ifdef UNIT_TEST
     (void)(color_pair);
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return attron(COLOR_PAIR(color_pair));
 #endif
 }
 
-int Interface::attribute_off(short color_pair) {
+int Interface::attribute_off(short color_pair) const {
 #ifdef UNIT_TEST
     (void)(color_pair);
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return attroff(COLOR_PAIR(color_pair));
 #endif
 }
 
-int Interface::get_current_y() {
+int Interface::get_current_y() const {
 #ifdef UNIT_TEST
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return getcury(stdscr);
 #endif
 }
 
-int Interface::get_current_x() {
+int Interface::get_current_x() const {
 #ifdef UNIT_TEST
     return 1;
 #else
+    if (headless_) {
+        return 1;
+    }
     return getcurx(stdscr);
 #endif
 }
 
 int Interface::get_input() {
 #ifdef UNIT_TEST
+    // Record how deep the stack is whenever input is requested
+    char marker = 0;
+    auto stack_address = reinterpret_cast<std::uintptr_t>(&marker);
+    lowest_stack_address_ = std::min(lowest_stack_address_, stack_address);
+    highest_stack_address_ = std::max(highest_stack_address_, stack_address);
     int result = 0;
     if (static_cast<std::vector<int>::size_type>(current_input_) <
         inputs_.size()) {
@@ -119,10 +240,54 @@ int Interface::get_input() {
     }
     return result;
 #else
+    if (headless_) {
+        int result = NO_INPUT;
+        if (has_input()) {
+            result = inputs_[current_input_];
+            ++current_input_;
+        }
+        return result;
+    }
     return getch();
 #endif
 }
 
+int Interface::set_input_blocking(bool blocking) const {
+#ifdef UNIT_TEST
+    (void)(blocking);
+    return 1;
+#else
+    if (headless_) {
+        return 1;
+    }
+    return nodelay(stdscr, !blocking);
+#endif
+}
+
+bool Interface::has_input() const {
+#ifndef UNIT_TEST
+    if (!headless_) {
+        return true;
+    }
+#endif
+    return static_cast<std::vector<int>::size_type>(current_input_) <
+           inputs_.size();
+}
+
+void Interface::set_headless(bool headless) { headless_ = headless; }
+
+bool Interface::is_headless() const { return headless_; }
+
+void Interface::set_inputs(const std::vector<int> &inputs) {
+    current_input_ = 0;
+    inputs_ = inputs;
+}
+
+void Interface::set_dimensions(int lines, int columns) {
+    this->lines = lines;
+    this->columns = columns;
+}
+
 int Interface::initialize_color(short &color_number, Color color) {
     int result = 0;
 #ifdef UNIT_TEST
@@ -135,22 +300,16 @@ int Interface::initialize_color(short &color_number, Color color) {
     return result;
 }
 
-bool Interface::has_color_capability() {
+bool Interface::has_color_capability() const {
 #ifdef UNIT_TEST
     return 1;
 #else
-    return has_colors();
+    return !headless_ && has_colors();
 #endif
 }
 
 #ifdef UNIT_TEST
-void Interface::set_inputs(const std::vector<int> &inputs) {
-    current_input_ = 0;
-    inputs_ = inputs;
-}
-
-void Interface::set_dimensions(int lines, int columns) {
-    this->lines = lines;
-    this->columns = columns;
+std::uintptr_t Interface::get_input_stack_range() const {
+    return highest_stack_address_ - lowest_stack_address_;
 }
 #endif
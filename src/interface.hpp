@@ -1,6 +1,7 @@
 #ifndef CLADITOR_INTERFACE_HPP
 #define CLADITOR_INTERFACE_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -8,35 +9,58 @@ struct Color;
 
 class Interface {
    public:
+    // Returned by get_input when the read was interrupted without a key
+    static constexpr int NO_INPUT = -1;
+
     int lines;    // LINES
     int columns;  // COLS
 
     Interface();
 
     void update();
+    void install_resize_handler();
+    bool has_resized();
+    // Descriptors that become readable when a key is typed or the terminal is
+    // resized, -1 if unavailable
+    int get_input_fd() const;
+    static int get_resize_fd();
 
-    static int refresh();                                // refresh
-    static int cursor_set(int);                          // curs_set
-    static int move_cursor(int, int);                    // move
-    static int mv_print(int, int, const std::string &);  // mvprintw
-    static int mv_print_ch(int, int, char);              // mvaddch
-    static int clear_to_eol();                           // clrtoeol
-    static int attribute_on(short);                      // attron
-    static int attribute_off(short);                     // attroff
-    static int get_current_y();                          // getcury
-    static int get_current_x();                          // getcurx
-    int get_input();                                     // getch
-    static int initialize_color(short &, Color);         // init_color
-    static bool has_color_capability();                  // has_colors
+    int refresh() const;                                // refresh
+    int cursor_set(int) const;                          // curs_set
+    int move_cursor(int, int) const;                    // move
+    int mv_print(int, int, const std::string &) const;  // mvprintw
+    int mv_print_ch(int, int, char) const;              // mvaddch
+    int clear_to_eol() const;                           // clrtoeol
+    int attribute_on(short) const;                      // attron
+    int attribute_off(short) const;                     // attroff
+    int get_current_y() const;                          // getcury
+    int get_current_x() const;                          // getcurx
+    int get_input();                                    // getch
+    int set_input_blocking(bool) const;                 // nodelay
+    bool has_input() const;
+    static int initialize_color(short &, Color);        // init_color
+    bool has_color_capability() const;                  // has_colors
 
-#ifdef UNIT_TEST
+    // Headless interfaces never draw and read input from a vector instead of
+    // the terminal
+    void set_headless(bool);
+    bool is_headless() const;
     void set_inputs(const std::vector<int> &);
     void set_dimensions(int, int);
 
+#ifdef UNIT_TEST
+    std::uintptr_t get_input_stack_range() const;
+#endif
+
    private:
-    // Mock input for unit test by storing sequential inputs in vector
+    bool headless_;
+    // Sequential inputs returned when headless or in unit tests
     std::vector<int> inputs_;
-    int current_input_ = 0;
+    int current_input_;
+#ifdef UNIT_TEST
+    // Lowest and highest stack addresses seen when input was requested
+    std::uintptr_t lowest_stack_address_ = UINTPTR_MAX;
+    std::uintptr_t highest_stack_address_ = 0;
 #endif
 };
 #endif
@@ -0,0 +1,5 @@
+#include "job.hpp"
+
+Job::~Job() = default;
+
+void Job::cancel() {}
@@ -0,0 +1,22 @@
+#ifndef CLADITOR_JOB_HPP
+#define CLADITOR_JOB_HPP
+
+#include <chrono>
+#include <string>
+
+// Long operation that is run in slices so that input can be handled between
+// them and the operation can be cancelled
+class Job {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~Job();
+    // Do work until the deadline and return whether the job has finished
+    virtual bool run_slice(Clock::time_point) = 0;
+    // Fraction of the work that is done
+    virtual double get_progress() const = 0;
+    virtual std::string get_description() const = 0;
+    // Undo the effects of an unfinished job
+    virtual void cancel();
+};
+#endif
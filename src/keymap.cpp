@@ -0,0 +1,215 @@
+#include "keymap.hpp"
+
+#include <array>
+#include <cctype>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "command.hpp"
+#include "runtime.hpp"
+
+const int KEY_COUNT = 256;
+
+namespace {
+struct DefaultBinding {
+    KeymapMode mode;
+    const char *keys;
+    Action action;
+};
+
+// Bindings available without any configuration
+constexpr std::array<DefaultBinding, 48> DEFAULT_BINDINGS = {{
+    {KeymapMode::NORMAL, "h", Action::MOVE_LEFT},
+    {KeymapMode::NORMAL, "j", Action::MOVE_DOWN},
+    {KeymapMode::NORMAL, "k", Action::MOVE_UP},
+    {KeymapMode::NORMAL, "l", Action::MOVE_RIGHT},
+    {KeymapMode::NORMAL, "0", Action::FIRST_CHAR},
+    {KeymapMode::NORMAL, "^", Action::FIRST_NON_BLANK_CHAR},
+    {KeymapMode::NORMAL, "x", Action::DELETE},
+    {KeymapMode::NORMAL, "gg", Action::FIRST_LINE},
+    {KeymapMode::NORMAL, "G", Action::END_OF_FILE},
+    {KeymapMode::NORMAL, "\x06", Action::PAGE_DOWN},  // Ctrl-F
+    {KeymapMode::NORMAL, "\x02", Action::PAGE_UP},    // Ctrl-B
+    {KeymapMode::NORMAL, "zz", Action::CENTER_LINE},
+    {KeymapMode::NORMAL, "dd", Action::DELETE_LINE},
+    {KeymapMode::NORMAL, "p", Action::PUT_AFTER},
+    {KeymapMode::NORMAL, "P", Action::PUT_BEFORE},
+    {KeymapMode::NORMAL, "a", Action::APPEND_AFTER_CURSOR},
+    {KeymapMode::NORMAL, "A", Action::APPEND_END_OF_LINE},
+    {KeymapMode::NORMAL, "o", Action::BEGIN_NEW_LINE_BELOW},
+    {KeymapMode::NORMAL, "O", Action::BEGIN_NEW_LINE_ABOVE},
+    {KeymapMode::NORMAL, "i", Action::INSERT_MODE},
+    {KeymapMode::NORMAL, "v", Action::VISUAL_MODE},
+    {KeymapMode::NORMAL, "V", Action::VISUAL_LINE_MODE},
+    {KeymapMode::NORMAL, ":", Action::COMMAND_MODE},
+    {KeymapMode::NORMAL, "q", Action::RECORD_MACRO},
+    {KeymapMode::NORMAL, "@", Action::EXECUTE_MACRO},
+    {KeymapMode::NORMAL, ".", Action::REPEAT_CHANGE},
+    {KeymapMode::NORMAL, "/", Action::SEARCH_FORWARD},
+    {KeymapMode::NORMAL, "?", Action::SEARCH_BACKWARD},
+    {KeymapMode::NORMAL, "n", Action::SEARCH_NEXT},
+    {KeymapMode::NORMAL, "N", Action::SEARCH_PREVIOUS},
+    {KeymapMode::VISUAL, "h", Action::MOVE_LEFT},
+    {KeymapMode::VISUAL, "j", Action::MOVE_DOWN},
+    {KeymapMode::VISUAL, "k", Action::MOVE_UP},
+    {KeymapMode::VISUAL, "l", Action::MOVE_RIGHT},
+    {KeymapMode::VISUAL, "0", Action::FIRST_CHAR},
+    {KeymapMode::VISUAL, "^", Action::FIRST_NON_BLANK_CHAR},
+    {KeymapMode::VISUAL, "x", Action::DELETE},
+    {KeymapMode::VISUAL, "gg", Action::FIRST_LINE},
+    {KeymapMode::VISUAL, "G", Action::END_OF_FILE},
+    {KeymapMode::VISUAL, "\x06", Action::PAGE_DOWN},  // Ctrl-F
+    {KeymapMode::VISUAL, "\x02", Action::PAGE_UP},    // Ctrl-B
+    {KeymapMode::VISUAL, "n", Action::SEARCH_NEXT},
+    {KeymapMode::VISUAL, "N", Action::SEARCH_PREVIOUS},
+    {KeymapMode::VISUAL, "d", Action::DELETE_SELECTION},
+    {KeymapMode::VISUAL, "\x1b", Action::NORMAL_MODE},  // Escape
+    {KeymapMode::VISUAL, "v", Action::VISUAL_MODE},
+    {KeymapMode::VISUAL, "V", Action::VISUAL_LINE_MODE},
+    {KeymapMode::VISUAL, ":", Action::COMMAND_MODE},
+}};
+
+std::vector<KeymapMode> get_command_modes(const std::string &command) {
+    // Return the modes that a map command applies to
+    if (command == "map" || command == "noremap") {
+        return {KeymapMode::NORMAL, KeymapMode::VISUAL};
+    }
+    if (command.front() == 'n') {
+        return {KeymapMode::NORMAL};
+    }
+    return {KeymapMode::VISUAL};
+}
+
+bool is_noremap_command(const std::string &command) {
+    return command.find("noremap") != std::string::npos;
+}
+}  // namespace
+
+Binding::Binding() : action(Action::NONE), noremap(false) {}
+
+Binding::Binding(Action action) : action(action), noremap(false) {}
+
+Binding::Binding(const std::vector<int> &keys, bool noremap)
+    : action(Action::MAPPING), keys(keys), noremap(noremap) {}
+
+KeyTrie::Node::Node() : children(KEY_COUNT, -1), child_count(0) {}
+
+KeyTrie::KeyTrie() : nodes_(1) {}
+
+void KeyTrie::insert(const std::vector<int> &keys, const Binding &binding) {
+    int node = ROOT;
+    for (int key : keys) {
+        int child = get_child(node, key);
+        if (child == -1) {
+            child = static_cast<int>(nodes_.size());
+            nodes_.emplace_back();
+            nodes_[node].children[key] = child;
+            ++nodes_[node].child_count;
+        }
+        node = child;
+    }
+    nodes_[node].binding = binding;
+}
+
+int KeyTrie::get_child(int node, int key) const {
+    // Keys outside of the table cannot be part of a sequence
+    if (key < 0 || key >= KEY_COUNT) {
+        return -1;
+    }
+    return nodes_[node].children[key];
+}
+
+bool KeyTrie::has_children(int node) const {
+    return nodes_[node].child_count > 0;
+}
+
+const Binding &KeyTrie::get_binding(int node) const {
+    return nodes_[node].binding;
+}
+
+Keymap::Keymap() {
+    for (const DefaultBinding &binding : DEFAULT_BINDINGS) {
+        default_tries_[static_cast<int>(binding.mode)].insert(
+            parse_keys(binding.keys), Binding(binding.action));
+    }
+    user_tries_ = default_tries_;
+}
+
+bool Keymap::map(const std::string &command, const std::string &arg) {
+    // Add user mapping given a map command and an argument containing the
+    // left hand side and right hand side delimited by white space
+    std::string::size_type lhs_start = arg.find_first_not_of(' ');
+    if (lhs_start == std::string::npos) {
+        return false;
+    }
+    std::string::size_type lhs_end = arg.find(' ', lhs_start);
+    std::string::size_type rhs_start = arg.find_first_not_of(' ', lhs_end);
+    if (lhs_end == std::string::npos || rhs_start == std::string::npos) {
+        return false;
+    }
+    std::vector<int> lhs =
+        parse_keys(arg.substr(lhs_start, lhs_end - lhs_start));
+    std::vector<int> rhs = parse_keys(arg.substr(rhs_start));
+    for (int key : lhs) {
+        if (key < 0 || key >= KEY_COUNT) {
+            return false;
+        }
+    }
+    Binding binding(rhs, is_noremap_command(command));
+    for (KeymapMode mode : get_command_modes(command)) {
+        user_tries_[static_cast<int>(mode)].insert(lhs, binding);
+    }
+    return true;
+}
+
+void Keymap::set_keymaps_from_config() {
+    // Set mappings based on config content
+    std::vector<std::string> config_content = get_runtime_config();
+    for (const std::string &command : config_content) {
+        std::vector<Command> commands = get_command(command);
+        for (const Command &c : commands) {
+            if (c.type == CommandType::MAP) {
+                map(c.content, c.arg);
+            }
+        }
+    }
+}
+
+const KeyTrie &Keymap::get_trie(KeymapMode mode, bool noremap) const {
+    return noremap ? default_tries_[static_cast<int>(mode)]
+                   : user_tries_[static_cast<int>(mode)];
+}
+
+std::vector<int> parse_keys(const std::string &str) {
+    // Convert key notation such as "<C-f>dd<Esc>" to a sequence of keys
+    const std::unordered_map<std::string, int> KEY_NAMES = {
+        {"esc", 27},  {"cr", 10},    {"enter", 10},  {"return", 10},
+        {"tab", 9},   {"bs", 127},   {"space", ' '}, {"lt", '<'},
+        {"bar", '|'}, {"bslash", '\\'}};
+    std::vector<int> keys;
+    std::string::size_type i = 0;
+    while (i < str.length()) {
+        std::string::size_type end = str[i] == '<' ? str.find('>', i) : i;
+        if (end != std::string::npos && end > i + 1) {
+            std::string name = str.substr(i + 1, end - i - 1);
+            for (char &c : name) {
+                c = static_cast<char>(std::tolower(c));
+            }
+            if (name.length() == 3 && name.substr(0, 2) == "c-") {
+                // Control key
+                keys.push_back(name[2] & 0x1f);
+                i = end + 1;
+                continue;
+            }
+            if (KEY_NAMES.find(name) != KEY_NAMES.end()) {
+                keys.push_back(KEY_NAMES.at(name));
+                i = end + 1;
+                continue;
+            }
+        }
+        keys.push_back(static_cast<unsigned char>(str[i]));
+        ++i;
+    }
+    return keys;
+}
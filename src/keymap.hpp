@@ -0,0 +1,101 @@
+#ifndef CLADITOR_KEYMAP_HPP
+#define CLADITOR_KEYMAP_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Number of distinct keys that can be part of a key sequence
+extern const int KEY_COUNT;
+
+enum class KeymapMode { NORMAL, VISUAL };
+
+enum class Action {
+    NONE,
+    // Replay the keys of a user mapping
+    MAPPING,
+
+    MOVE_LEFT,
+    MOVE_DOWN,
+    MOVE_UP,
+    MOVE_RIGHT,
+    FIRST_CHAR,
+    FIRST_NON_BLANK_CHAR,
+    DELETE,
+    FIRST_LINE,
+    END_OF_FILE,
+    PAGE_DOWN,
+    PAGE_UP,
+    CENTER_LINE,
+    DELETE_LINE,
+    PUT_AFTER,
+    PUT_BEFORE,
+    APPEND_AFTER_CURSOR,
+    APPEND_END_OF_LINE,
+    BEGIN_NEW_LINE_BELOW,
+    BEGIN_NEW_LINE_ABOVE,
+    DELETE_SELECTION,
+    RECORD_MACRO,
+    EXECUTE_MACRO,
+    REPEAT_CHANGE,
+    SEARCH_FORWARD,
+    SEARCH_BACKWARD,
+    SEARCH_NEXT,
+    SEARCH_PREVIOUS,
+
+    NORMAL_MODE,
+    INSERT_MODE,
+    VISUAL_MODE,
+    VISUAL_LINE_MODE,
+    COMMAND_MODE
+};
+
+struct Binding {
+    Binding();
+    explicit Binding(Action);
+    Binding(const std::vector<int> &, bool);
+
+    Action action;
+    // Keys to replay if action is Action::MAPPING
+    std::vector<int> keys;
+    // Replayed keys should only be dispatched against default bindings
+    bool noremap;
+};
+
+class KeyTrie {
+   public:
+    static const int ROOT = 0;
+
+    KeyTrie();
+    void insert(const std::vector<int> &, const Binding &);
+    int get_child(int, int) const;
+    bool has_children(int) const;
+    const Binding &get_binding(int) const;
+
+   private:
+    struct Node {
+        Node();
+
+        std::vector<int> children;
+        int child_count;
+        Binding binding;
+    };
+
+    std::vector<Node> nodes_;
+};
+
+class Keymap {
+   public:
+    Keymap();
+    bool map(const std::string &, const std::string &);
+    void set_keymaps_from_config();
+    const KeyTrie &get_trie(KeymapMode, bool) const;
+
+   private:
+    std::array<KeyTrie, 2> default_tries_;
+    std::array<KeyTrie, 2> user_tries_;
+};
+
+std::vector<int> parse_keys(const std::string &);
+
+#endif
@@ -0,0 +1,221 @@
+#include "latency.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mode.hpp"
+
+namespace {
+// Each power of two is split into HALF_BUCKET_COUNT linear buckets
+const int SUB_BUCKET_BITS = 5;
+const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+const int HALF_BUCKET_COUNT = SUB_BUCKET_COUNT / 2;
+const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * HALF_BUCKET_COUNT +
+                         SUB_BUCKET_COUNT;
+
+const std::array<const char *, 6> MODE_NAMES = {
+    "exit", "normal", "insert", "visual", "visual_line", "command"};
+const std::array<const char *, 6> KEY_CLASS_NAMES = {
+    "character", "control", "escape", "enter", "backspace", "special"};
+
+int get_bucket(long long value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<int>(value);
+    }
+    int shift = 63 - __builtin_clzll(static_cast<unsigned long long>(value)) -
+                (SUB_BUCKET_BITS - 1);
+    return shift * HALF_BUCKET_COUNT + static_cast<int>(value >> shift);
+}
+
+long long get_bucket_upper_bound(int bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    int shift = bucket / HALF_BUCKET_COUNT - 1;
+    long long sub_bucket = bucket - shift * HALF_BUCKET_COUNT;
+    return (sub_bucket << shift) + (1LL << shift) - 1;
+}
+
+std::string format_duration(long long nanoseconds) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2)
+           << static_cast<double>(nanoseconds) / 1000000 << "ms";
+    return stream.str();
+}
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : count_(0), min_(LLONG_MAX), max_(0), sum_(0) {}
+
+void LatencyHistogram::record(long long value) {
+    value = std::max(0LL, value);
+    if (counts_.empty()) {
+        counts_.resize(BUCKET_COUNT, 0);
+    }
+    ++counts_[get_bucket(value)];
+    ++count_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+}
+
+long long LatencyHistogram::get_count() const { return count_; }
+
+long long LatencyHistogram::get_max() const { return max_; }
+
+long long LatencyHistogram::get_mean() const {
+    return count_ == 0 ? 0 : sum_ / count_;
+}
+
+long long LatencyHistogram::get_percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    long long target = std::max(
+        1LL, static_cast<long long>(percentile / 100 *
+                                        static_cast<double>(count_) +
+                                    0.5));
+    long long seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::min(get_bucket_upper_bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::get_summary() const {
+    return std::to_string(count_) + " p50 " +
+           format_duration(get_percentile(50)) + " p90 " +
+           format_duration(get_percentile(90)) + " p99 " +
+           format_duration(get_percentile(99)) + " max " +
+           format_duration(max_);
+}
+
+std::string LatencyHistogram::to_json() const {
+    std::ostringstream stream;
+    stream << "{\"count\":" << count_
+           << ",\"min_ns\":" << (count_ == 0 ? 0 : min_)
+           << ",\"max_ns\":" << max_ << ",\"mean_ns\":" << get_mean()
+           << ",\"p50_ns\":" << get_percentile(50)
+           << ",\"p90_ns\":" << get_percentile(90)
+           << ",\"p99_ns\":" << get_percentile(99)
+           << ",\"p999_ns\":" << get_percentile(99.9) << ",\"buckets\":[";
+    bool first = true;
+    for (int i = 0; i < static_cast<int>(counts_.size()); ++i) {
+        if (counts_[i] > 0) {
+            stream << (first ? "" : ",") << '[' << get_bucket_upper_bound(i)
+                   << ',' << counts_[i] << ']';
+            first = false;
+        }
+    }
+    stream << "]}";
+    return stream.str();
+}
+
+KeyClass get_key_class(int key) {
+    switch (key) {
+        case 27:
+            return KeyClass::ESCAPE;
+        case 10:
+        case 13:
+            return KeyClass::ENTER;
+        case 8:
+        case 127:
+            return KeyClass::BACKSPACE;
+        default:
+            break;
+    }
+    if (key >= 256) {
+        return KeyClass::SPECIAL;
+    }
+    return key < 32 ? KeyClass::CONTROL : KeyClass::CHARACTER;
+}
+
+LatencyRecorder::LatencyRecorder() = default;
+
+void LatencyRecorder::record_input(int key, ModeType mode,
+                                   Clock::time_point time) {
+    pending_inputs_.push_back({time, mode, get_key_class(key)});
+}
+
+void LatencyRecorder::record_frame() {
+    // Every key read since the previous frame is shown by this frame
+    Clock::time_point now = Clock::now();
+    for (const PendingInput &input : pending_inputs_) {
+        long long latency =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                                 input.time)
+                .count();
+        keys_.record(latency);
+        modes_[static_cast<int>(input.mode)].record(latency);
+        key_classes_[static_cast<int>(input.key_class)].record(latency);
+    }
+    pending_inputs_.clear();
+}
+
+void LatencyRecorder::record_update(Clock::duration duration) {
+    update_.record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+}
+
+void LatencyRecorder::record_print_buffer(Clock::duration duration) {
+    print_buffer_.record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+}
+
+bool LatencyRecorder::get_summary(const std::string &name,
+                                  std::string &summary) const {
+    if (name.empty()) {
+        summary = "keys " + keys_.get_summary() + ", update p99 " +
+                  format_duration(update_.get_percentile(99)) +
+                  ", print p99 " +
+                  format_duration(print_buffer_.get_percentile(99));
+        return true;
+    }
+    for (int i = 0; i < static_cast<int>(MODE_NAMES.size()); ++i) {
+        if (name == MODE_NAMES[i]) {
+            summary = name + " " + modes_[i].get_summary();
+            return true;
+        }
+    }
+    for (int i = 0; i < static_cast<int>(KEY_CLASS_NAMES.size()); ++i) {
+        if (name == KEY_CLASS_NAMES[i]) {
+            summary = name + " " + key_classes_[i].get_summary();
+            return true;
+        }
+    }
+    if (name == "update" || name == "print_buffer") {
+        summary = name + " " +
+                  (name == "update" ? update_ : print_buffer_).get_summary();
+        return true;
+    }
+    return false;
+}
+
+std::string LatencyRecorder::to_json() const {
+    std::ostringstream stream;
+    stream << "{\"keys\":" << keys_.to_json() << ",\"modes\":{";
+    // The exit mode never reads keys
+    for (int i = 1; i < static_cast<int>(MODE_NAMES.size()); ++i) {
+        stream << (i == 1 ? "" : ",") << '"' << MODE_NAMES[i]
+               << "\":" << modes_[i].to_json();
+    }
+    stream << "},\"key_classes\":{";
+    for (int i = 0; i < static_cast<int>(KEY_CLASS_NAMES.size()); ++i) {
+        stream << (i == 0 ? "" : ",") << '"' << KEY_CLASS_NAMES[i]
+               << "\":" << key_classes_[i].to_json();
+    }
+    stream << "},\"update\":" << update_.to_json()
+           << ",\"print_buffer\":" << print_buffer_.to_json() << "}\n";
+    return stream.str();
+}
@@ -0,0 +1,70 @@
+#ifndef CLADITOR_LATENCY_HPP
+#define CLADITOR_LATENCY_HPP
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mode.hpp"
+
+// Histogram of durations in nanoseconds where every power of two is split
+// into linear buckets, which bounds the relative error of any value to about
+// three percent
+class LatencyHistogram {
+   public:
+    LatencyHistogram();
+    void record(long long);
+    long long get_count() const;
+    long long get_max() const;
+    long long get_mean() const;
+    // Highest value that is equivalent to the value at the percentile
+    long long get_percentile(double) const;
+    std::string get_summary() const;
+    std::string to_json() const;
+
+   private:
+    // Buckets are only allocated once a value is recorded
+    std::vector<long long> counts_;
+    long long count_;
+    long long min_;
+    long long max_;
+    long long sum_;
+};
+
+enum class KeyClass { CHARACTER, CONTROL, ESCAPE, ENTER, BACKSPACE, SPECIAL };
+
+KeyClass get_key_class(int);
+
+// Records the time from reading a key until the frame showing its effect has
+// been refreshed
+class LatencyRecorder {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyRecorder();
+    // Keys are given with the time that they were read at
+    void record_input(int, ModeType, Clock::time_point);
+    void record_frame();
+    void record_update(Clock::duration);
+    void record_print_buffer(Clock::duration);
+    // Return the summary of a histogram given the name of a mode or key
+    // class, or of every histogram if the name is empty
+    bool get_summary(const std::string &, std::string &) const;
+    std::string to_json() const;
+
+   private:
+    struct PendingInput {
+        Clock::time_point time;
+        ModeType mode;
+        KeyClass key_class;
+    };
+
+    std::vector<PendingInput> pending_inputs_;
+    LatencyHistogram keys_;
+    std::array<LatencyHistogram, 6> modes_;
+    std::array<LatencyHistogram, 6> key_classes_;
+    LatencyHistogram update_;
+    LatencyHistogram print_buffer_;
+};
+#endif
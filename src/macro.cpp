@@ -0,0 +1,64 @@
+#include "macro.hpp"
+
+#include <cctype>
+#include <unordered_map>
+#include <vector>
+
+MacroRecorder::MacroRecorder() : recording_register_(0), last_register_(0) {}
+
+bool MacroRecorder::is_valid_register(int reg) {
+    return (reg >= 'a' && reg <= 'z') || (reg >= 'A' && reg <= 'Z') ||
+           (reg >= '0' && reg <= '9');
+}
+
+bool MacroRecorder::start_recording(int reg) {
+    if (!is_valid_register(reg)) {
+        return false;
+    }
+    if (reg >= 'A' && reg <= 'Z') {
+        // Uppercase registers append to their lowercase register
+        recording_register_ = std::tolower(reg);
+    } else {
+        recording_register_ = reg;
+        registers_[reg].clear();
+    }
+    return true;
+}
+
+void MacroRecorder::stop_recording() { recording_register_ = 0; }
+
+bool MacroRecorder::is_recording() const { return recording_register_ != 0; }
+
+int MacroRecorder::get_recording_register() const {
+    return recording_register_;
+}
+
+void MacroRecorder::record(int key) {
+    if (is_recording()) {
+        registers_[recording_register_].push_back(key);
+    }
+}
+
+void MacroRecorder::drop_last_key() {
+    if (is_recording() && !registers_[recording_register_].empty()) {
+        registers_[recording_register_].pop_back();
+    }
+}
+
+std::vector<int> MacroRecorder::get_keys(int reg) const {
+    reg = std::tolower(reg);
+    if (registers_.find(reg) == registers_.end()) {
+        return {};
+    }
+    return registers_.at(reg);
+}
+
+bool MacroRecorder::set_last_register(int reg) {
+    if (!is_valid_register(reg)) {
+        return false;
+    }
+    last_register_ = std::tolower(reg);
+    return true;
+}
+
+int MacroRecorder::get_last_register() const { return last_register_; }
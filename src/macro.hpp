@@ -0,0 +1,28 @@
+#ifndef CLADITOR_MACRO_HPP
+#define CLADITOR_MACRO_HPP
+
+#include <unordered_map>
+#include <vector>
+
+class MacroRecorder {
+   public:
+    MacroRecorder();
+    static bool is_valid_register(int);
+    bool start_recording(int);
+    void stop_recording();
+    bool is_recording() const;
+    int get_recording_register() const;
+    void record(int);
+    void drop_last_key();
+    std::vector<int> get_keys(int) const;
+    bool set_last_register(int);
+    int get_last_register() const;
+
+   private:
+    // Register currently being recorded to, zero if not recording
+    int recording_register_;
+    // Register that was most recently executed, zero if none was executed
+    int last_register_;
+    std::unordered_map<int, std::vector<int>> registers_;
+};
+#endif
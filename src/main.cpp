@@ -1,14 +1,23 @@
 #include <ncurses.h>
 
+#include <chrono>
+#include <cstddef>
 #include <cxxopts.hpp>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "color.hpp"
 #include "editor.hpp"
+#include "keymap.hpp"
 #include "options.hpp"
+#include "stream_editor.hpp"
+#include "thread_pool.hpp"
 
 std::vector<Color> default_colors(COLORS_DEFINED);
 std::vector<std::pair<short, short>> default_pairs(PAIRS_DEFINED);
@@ -59,12 +68,126 @@ void initialize_ncurses() {
     keypad(stdscr, true);
 }
 
+std::stringstream read_file(const std::string& file_path) {
+    std::ifstream file;
+    file.open(file_path.c_str(), std::ios::in);
+    std::stringstream file_stream;
+    file_stream << file.rdbuf();
+    return file_stream;
+}
+
+struct BatchResult {
+    std::vector<std::string> errors;
+    std::chrono::steady_clock::duration duration;
+};
+
+int run_batch(const std::vector<std::string>& file_paths,
+              const std::string& commands, const std::vector<int>& keys,
+              int thread_count) {
+    // Edit every file without a terminal on a thread pool and report errors
+    // and timing on stderr
+    // Configuration is read once and shared read-only by every editor
+    Options config_options;
+    config_options.set_options_from_config();
+    Keymap keymap;
+    keymap.set_keymaps_from_config();
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    std::vector<BatchResult> results(file_paths.size());
+    {
+        ThreadPool thread_pool(thread_count);
+        thread_count = thread_pool.get_thread_count();
+        for (std::size_t i = 0; i < file_paths.size(); ++i) {
+            thread_pool.submit([&, i] {
+                std::chrono::steady_clock::time_point file_start =
+                    std::chrono::steady_clock::now();
+                std::stringstream file_stream = read_file(file_paths[i]);
+                Editor editor(file_paths[i], file_stream);
+                try {
+                    results[i].errors = editor.run_batch(
+                        commands, keys, config_options, keymap);
+                } catch (const std::exception& exception) {
+                    results[i].errors.emplace_back(exception.what());
+                }
+                results[i].duration =
+                    std::chrono::steady_clock::now() - file_start;
+            });
+        }
+        thread_pool.wait();
+    }
+    std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    int error_count = 0;
+    int failed_files = 0;
+    std::chrono::steady_clock::duration busy{0};
+    for (std::size_t i = 0; i < file_paths.size(); ++i) {
+        for (const std::string& error : results[i].errors) {
+            std::cerr << file_paths[i] << ": " << error << '\n';
+        }
+        error_count += static_cast<int>(results[i].errors.size());
+        failed_files += results[i].errors.empty() ? 0 : 1;
+        busy += results[i].duration;
+    }
+    if (file_paths.size() > 1) {
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        std::cerr << file_paths.size() << " files in "
+                  << Milliseconds(elapsed).count() << " ms on "
+                  << thread_count << " threads ("
+                  << Milliseconds(busy).count() << " ms editing), "
+                  << error_count << " errors in " << failed_files
+                  << " files\n";
+    }
+    return error_count > 0 ? 1 : 0;
+}
+
+int run_stream(const std::vector<std::string>& file_paths,
+               const std::string& commands) {
+    // Apply line addressed commands to each file or to standard input while
+    // reading it
+    StreamEditor stream_editor;
+    if (!stream_editor.set_commands(commands)) {
+        std::cerr << stream_editor.get_error() << '\n';
+        return 1;
+    }
+    if (file_paths.empty()) {
+        std::ios::sync_with_stdio(false);
+        if (!stream_editor.run(std::cin, std::cout)) {
+            std::cerr << stream_editor.get_error() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    int status = 0;
+    for (const std::string& file_path : file_paths) {
+        if (!stream_editor.edit_file(file_path)) {
+            std::cerr << file_path << ": " << stream_editor.get_error()
+                      << '\n';
+            status = 1;
+        }
+    }
+    return status;
+}
+
 int main(int argc, char* argv[]) {
     cxxopts::Options options("clad", "Modal text editor");
 
     options.add_options()("h,help", "Print usage")(
         "c", "Execute command after reading file",
         cxxopts::value<std::string>())(
+        "e", "Execute commands on each file without a terminal and exit",
+        cxxopts::value<std::string>())(
+        "batch", "Edit files without a terminal and exit",
+        cxxopts::value<bool>()->default_value("false"))(
+        "stream",
+        "Apply line addressed commands while reading files or standard input",
+        cxxopts::value<bool>()->default_value("false"))(
+        "s", "Read batch mode keys from script file",
+        cxxopts::value<std::string>())(
+        "j,jobs", "Number of files edited at once in batch mode",
+        cxxopts::value<int>()->default_value(
+            std::to_string(ThreadPool::get_default_thread_count())))(
         "dump-config", "Dumps configuration",
         cxxopts::value<bool>()->default_value("false"));
 
@@ -77,16 +200,45 @@ int main(int argc, char* argv[]) {
 
     std::vector<std::string> unmatched = result.unmatched();
 
+    bool stream = result["stream"].as<bool>();
+    if (stream || result["batch"].as<bool>() || result.count("e")) {
+        std::string commands;
+        if (result.count("e")) {
+            commands = result["e"].as<std::string>();
+        } else if (result.count("c")) {
+            commands = result["c"].as<std::string>();
+        }
+        if (!commands.empty() && commands.front() == ':') {
+            commands.erase(0, 1);
+        }
+        if (stream) {
+            return run_stream(unmatched, commands);
+        }
+        std::vector<int> keys;
+        if (result.count("s")) {
+            std::ifstream script(result["s"].as<std::string>(),
+                                 std::ios::in | std::ios::binary);
+            if (!script) {
+                std::cerr << "Cannot read script "
+                          << result["s"].as<std::string>() << '\n';
+                return 1;
+            }
+            for (std::istreambuf_iterator<char> it(script), end; it != end;
+                 ++it) {
+                keys.push_back(static_cast<unsigned char>(*it));
+            }
+        }
+        return run_batch(unmatched, commands, keys,
+                         result["jobs"].as<int>());
+    }
+
     if (result["dump-config"].as<bool>()) {
         Options config_options;
         config_options.set_options_from_config();
         config_options.dump_config();
     } else if (unmatched.size() > 0) {
         std::string file_path = unmatched[0];
-        std::ifstream file;
-        file.open(file_path.c_str(), std::ios::in);
-        std::stringstream file_stream;
-        file_stream << file.rdbuf();
+        std::stringstream file_stream = read_file(file_path);
         Editor editor(file_path, file_stream);
         initialize_ncurses();
         std::string initial_command =
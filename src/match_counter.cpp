@@ -0,0 +1,101 @@
+#include "match_counter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+#include "position.hpp"
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// Number of lines counted by a task between checks of the deadline
+const std::size_t LINES_PER_CHECK = 4096;
+}  // namespace
+
+MatchCounter::MatchCounter(const std::vector<std::string> &lines,
+                           const SearchPattern &pattern, Position position,
+                           ThreadPool *pool)
+    : lines_(lines),
+      position_(position),
+      pool_(pool),
+      patterns_(pool == nullptr ? 1 : pool->get_thread_count(), pattern),
+      counted_lines_(0),
+      count_(0),
+      count_before_(0) {}
+
+bool MatchCounter::run_slice(Clock::time_point deadline) {
+    while (counted_lines_ < lines_.size()) {
+        std::size_t task_count = patterns_.size();
+        std::vector<std::size_t> counts(task_count, 0);
+        std::vector<std::size_t> counts_before(task_count, 0);
+        for (std::size_t i = 0; i < task_count; ++i) {
+            std::size_t first = counted_lines_ + i * LINES_PER_CHECK;
+            std::size_t last = std::min(lines_.size(), first + LINES_PER_CHECK);
+            auto count_lines = [this, i, first, last, &counts,
+                                &counts_before] {
+                for (std::size_t line = first; line < last; ++line) {
+                    count_line(patterns_[i], line, counts[i],
+                               counts_before[i]);
+                }
+            };
+            if (pool_ == nullptr) {
+                count_lines();
+            } else {
+                pool_->submit(count_lines);
+            }
+        }
+        if (pool_ != nullptr) {
+            pool_->wait();
+        }
+        for (std::size_t i = 0; i < task_count; ++i) {
+            count_ += counts[i];
+            count_before_ += counts_before[i];
+        }
+        counted_lines_ = std::min(
+            lines_.size(), counted_lines_ + task_count * LINES_PER_CHECK);
+        if (counted_lines_ < lines_.size() && Clock::now() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double MatchCounter::get_progress() const {
+    return lines_.empty() ? 1.0
+                          : static_cast<double>(counted_lines_) /
+                                static_cast<double>(lines_.size());
+}
+
+std::string MatchCounter::get_description() const {
+    return "Counting matches of " + patterns_.front().get_source();
+}
+
+const SearchPattern &MatchCounter::get_pattern() const {
+    return patterns_.front();
+}
+
+Position MatchCounter::get_position() const { return position_; }
+
+std::size_t MatchCounter::get_count() const { return count_; }
+
+std::size_t MatchCounter::get_index() const { return count_before_ + 1; }
+
+void MatchCounter::count_line(SearchPattern &pattern, std::size_t line,
+                              std::size_t &count,
+                              std::size_t &count_before) const {
+    std::vector<MatchRange> matches;
+    pattern.find_all(lines_[line], std::string::npos, matches);
+    for (const MatchRange &match : matches) {
+        ++count;
+        bool is_before =
+            static_cast<int>(line) < position_.y ||
+            (static_cast<int>(line) == position_.y &&
+             static_cast<int>(match.first) < position_.x);
+        if (is_before) {
+            ++count_before;
+        }
+    }
+}
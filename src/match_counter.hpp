@@ -0,0 +1,46 @@
+#ifndef CLADITOR_MATCH_COUNTER_HPP
+#define CLADITOR_MATCH_COUNTER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+#include "position.hpp"
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+// Counts the matches of a pattern in lines in slices, along with the matches
+// before a position, so that a search can report which match it moved to
+class MatchCounter : public Job {
+   public:
+    // Lines must not change while the job is running, lines are counted on
+    // the pool if it is given
+    MatchCounter(const std::vector<std::string> &, const SearchPattern &,
+                 Position, ThreadPool *);
+
+    bool run_slice(Clock::time_point) override;
+    double get_progress() const override;
+    std::string get_description() const override;
+    const SearchPattern &get_pattern() const;
+    Position get_position() const;
+    std::size_t get_count() const;
+    // Number of the match at the position starting from one
+    std::size_t get_index() const;
+
+   private:
+    const std::vector<std::string> &lines_;
+    Position position_;
+    ThreadPool *pool_;
+    // Patterns build their automaton while matching, so every task has its
+    // own copy
+    std::vector<SearchPattern> patterns_;
+    std::size_t counted_lines_;
+    std::size_t count_;
+    std::size_t count_before_;
+
+    // Count the matches in a line and the matches before the position
+    void count_line(SearchPattern &, std::size_t, std::size_t &,
+                    std::size_t &) const;
+};
+#endif
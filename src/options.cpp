@@ -15,9 +15,10 @@ struct OptionError : public std::runtime_error {
 };
 
 Options::Options()
-    : int_options_{{"tabsize", 4}},
-      string_options_{{"colorscheme", ""}},
-      bool_options_{{"number", true}, {"tabs", false}} {}
+    : int_options_{{"tabsize", 4}, {"autosave", 0}},
+      string_options_{{"colorscheme", ""}, {"latencylog", ""}},
+      bool_options_{{"number", true}, {"tabs", false}, {"latency", false},
+                    {"hlsearch", false}, {"trigramindex", false}} {}
 
 bool Options::set_option(const std::string &option) {
     std::string::size_type equal_delimiter = option.find('=');
@@ -0,0 +1,879 @@
+#include "regex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "search.hpp"
+
+namespace {
+const int MAX_REPEAT = 1000;
+// Nesting of groups and repetitions, the parser and compiler recurse
+const int MAX_DEPTH = 1000;
+const std::size_t MAX_PROGRAM_SIZE = 100000;
+
+struct Node {
+    enum class Type { EMPTY, BYTES, CONCAT, ALTERNATE, REPEAT, BEGIN, END };
+
+    explicit Node(Type type = Type::EMPTY) : type(type), min(0), max(0) {}
+
+    Type type;
+    ByteSet bytes;
+    std::vector<Node> children;
+    int min;
+    // Unbounded if -1
+    int max;
+};
+
+ByteSet get_byte_range(int first, int last) {
+    ByteSet bytes;
+    for (int c = first; c <= last; ++c) {
+        bytes.set(c);
+    }
+    return bytes;
+}
+
+bool get_escaped_class(char c, ByteSet &bytes) {
+    // Character classes such as \d, an upper case letter negates the class
+    ByteSet digits = get_byte_range('0', '9');
+    ByteSet lower = get_byte_range('a', 'z');
+    ByteSet upper = get_byte_range('A', 'Z');
+    switch (std::tolower(static_cast<unsigned char>(c))) {
+        case 'd':
+            bytes = digits;
+            break;
+        case 'w':
+            bytes = digits | lower | upper;
+            bytes.set('_');
+            break;
+        case 's':
+            bytes.reset();
+            bytes.set(' ');
+            bytes.set('\t');
+            break;
+        case 'a':
+            bytes = lower | upper;
+            break;
+        case 'l':
+            bytes = lower;
+            break;
+        case 'u':
+            bytes = upper;
+            break;
+        case 'x':
+            bytes =
+                digits | get_byte_range('a', 'f') | get_byte_range('A', 'F');
+            break;
+        default:
+            return false;
+    }
+    if (std::isupper(static_cast<unsigned char>(c))) {
+        bytes.flip();
+    }
+    return true;
+}
+
+char get_escaped_char(char c) {
+    switch (c) {
+        case 't':
+            return '\t';
+        case 'e':
+            return '\x1b';
+        default:
+            return c;
+    }
+}
+
+class Parser {
+   public:
+    explicit Parser(const std::string &pattern)
+        : pattern_(pattern), position_(0), depth_(0) {}
+
+    bool parse(Node &root) {
+        if (!parse_alternation(root)) {
+            return false;
+        }
+        if (position_ < pattern_.length()) {
+            return fail("Unmatched )");
+        }
+        return true;
+    }
+
+    const std::string &get_error() const { return error_; }
+
+   private:
+    const std::string &pattern_;
+    std::string::size_type position_;
+    int depth_;
+    std::string error_;
+
+    bool fail(const std::string &error) {
+        error_ = error;
+        return false;
+    }
+
+    bool at(char c) const {
+        return position_ < pattern_.length() && pattern_[position_] == c;
+    }
+
+    bool parse_alternation(Node &node) {
+        Node alternative;
+        if (!parse_concatenation(alternative)) {
+            return false;
+        }
+        if (!at('|')) {
+            node = std::move(alternative);
+            return true;
+        }
+        node = Node(Node::Type::ALTERNATE);
+        node.children.push_back(std::move(alternative));
+        while (at('|')) {
+            ++position_;
+            if (!parse_concatenation(alternative)) {
+                return false;
+            }
+            node.children.push_back(std::move(alternative));
+        }
+        return true;
+    }
+
+    bool parse_concatenation(Node &node) {
+        node = Node(Node::Type::CONCAT);
+        while (position_ < pattern_.length() && !at('|') && !at(')')) {
+            Node atom;
+            if (!parse_repetition(atom)) {
+                return false;
+            }
+            node.children.push_back(std::move(atom));
+        }
+        return true;
+    }
+
+    bool parse_repetition(Node &node) {
+        if (!parse_atom(node)) {
+            return false;
+        }
+        for (int depth = depth_; position_ < pattern_.length(); ++depth) {
+            if (depth >= MAX_DEPTH) {
+                return fail("Pattern is nested too deeply");
+            }
+            int min = 0;
+            int max = -1;
+            switch (pattern_[position_]) {
+                case '*':
+                    ++position_;
+                    break;
+                case '+':
+                    min = 1;
+                    ++position_;
+                    break;
+                case '?':
+                case '=':
+                    max = 1;
+                    ++position_;
+                    break;
+                case '{':
+                    if (!parse_count(min, max)) {
+                        return false;
+                    }
+                    break;
+                default:
+                    return true;
+            }
+            Node repeat(Node::Type::REPEAT);
+            repeat.min = min;
+            repeat.max = max;
+            repeat.children.push_back(std::move(node));
+            node = std::move(repeat);
+        }
+        return true;
+    }
+
+    bool parse_number(int &number) {
+        // Returns false if there is no number
+        std::string::size_type start = position_;
+        number = 0;
+        while (position_ < pattern_.length() &&
+               std::isdigit(static_cast<unsigned char>(pattern_[position_]))) {
+            number = std::min(number * 10 + (pattern_[position_] - '0'),
+                              MAX_REPEAT + 1);
+            ++position_;
+        }
+        return position_ > start;
+    }
+
+    bool parse_count(int &min, int &max) {
+        // Parse {n}, {n,}, {,m} or {n,m}, a leading '-' asking for the
+        // shortest match has no effect on leftmost-longest matches
+        ++position_;
+        if (at('-')) {
+            ++position_;
+        }
+        bool has_min = parse_number(min);
+        max = min;
+        if (at(',')) {
+            ++position_;
+            if (!parse_number(max)) {
+                max = -1;
+            }
+        } else if (!has_min) {
+            max = -1;
+        }
+        if (!at('}')) {
+            return fail("Unmatched {");
+        }
+        ++position_;
+        if (min > MAX_REPEAT || max > MAX_REPEAT ||
+            (max != -1 && min > max)) {
+            return fail("Invalid repeat count");
+        }
+        return true;
+    }
+
+    bool parse_atom(Node &node) {
+        char c = pattern_[position_++];
+        switch (c) {
+            case '(':
+                if (++depth_ >= MAX_DEPTH) {
+                    return fail("Pattern is nested too deeply");
+                }
+                if (!parse_alternation(node)) {
+                    return false;
+                }
+                if (!at(')')) {
+                    return fail("Unmatched (");
+                }
+                ++position_;
+                --depth_;
+                return true;
+            case '[':
+                return parse_class(node);
+            case '.':
+                node = Node(Node::Type::BYTES);
+                node.bytes.set();
+                return true;
+            case '^':
+                node = Node(Node::Type::BEGIN);
+                return true;
+            case '$':
+                node = Node(Node::Type::END);
+                return true;
+            case '*':
+            case '+':
+            case '?':
+            case '=':
+            case '{':
+                return fail("Nothing to repeat");
+            case '<':
+            case '>':
+            case '@':
+            case '%':
+            case '&':
+            case '~':
+                return fail(std::string("Unsupported operator: ") + c);
+            case '\\':
+                if (position_ == pattern_.length()) {
+                    return fail("Trailing \\");
+                }
+                c = pattern_[position_++];
+                node = Node(Node::Type::BYTES);
+                if (!get_escaped_class(c, node.bytes)) {
+                    node.bytes.set(static_cast<unsigned char>(
+                        get_escaped_char(c)));
+                }
+                return true;
+            default:
+                node = Node(Node::Type::BYTES);
+                node.bytes.set(static_cast<unsigned char>(c));
+                return true;
+        }
+    }
+
+    bool parse_class_byte(unsigned char &byte) {
+        byte = static_cast<unsigned char>(pattern_[position_++]);
+        if (byte == '\\' && position_ < pattern_.length()) {
+            byte = static_cast<unsigned char>(
+                get_escaped_char(pattern_[position_++]));
+        }
+        return true;
+    }
+
+    bool parse_class(Node &node) {
+        node = Node(Node::Type::BYTES);
+        bool negated = at('^');
+        if (negated) {
+            ++position_;
+        }
+        // A ']' at the start is part of the class
+        bool first = true;
+        while (position_ < pattern_.length() && (first || !at(']'))) {
+            first = false;
+            ByteSet escaped;
+            if (at('\\') && position_ + 1 < pattern_.length() &&
+                get_escaped_class(pattern_[position_ + 1], escaped)) {
+                node.bytes |= escaped;
+                position_ += 2;
+                continue;
+            }
+            unsigned char low = 0;
+            parse_class_byte(low);
+            unsigned char high = low;
+            if (at('-') && position_ + 1 < pattern_.length() &&
+                pattern_[position_ + 1] != ']') {
+                ++position_;
+                parse_class_byte(high);
+                if (high < low) {
+                    return fail("Invalid range in []");
+                }
+            }
+            node.bytes |= get_byte_range(low, high);
+        }
+        if (!at(']')) {
+            return fail("Unmatched [");
+        }
+        ++position_;
+        if (negated) {
+            node.bytes.flip();
+        }
+        return true;
+    }
+};
+
+class Compiler {
+   public:
+    // A reversed program matches the reversed text
+    Compiler(std::vector<Instruction> &program, bool reverse)
+        : program_(program), reverse_(reverse) {}
+
+    bool compile(const Node &node) {
+        switch (node.type) {
+            case Node::Type::EMPTY:
+                break;
+            case Node::Type::BYTES:
+                emit(Instruction::Op::BYTE).bytes = node.bytes;
+                break;
+            case Node::Type::BEGIN:
+                emit(reverse_ ? Instruction::Op::ASSERT_END
+                              : Instruction::Op::ASSERT_BEGIN);
+                break;
+            case Node::Type::END:
+                emit(reverse_ ? Instruction::Op::ASSERT_BEGIN
+                              : Instruction::Op::ASSERT_END);
+                break;
+            case Node::Type::CONCAT:
+                if (reverse_) {
+                    for (auto it = node.children.rbegin();
+                         it != node.children.rend(); ++it) {
+                        if (!compile(*it)) {
+                            return false;
+                        }
+                    }
+                } else {
+                    for (const Node &child : node.children) {
+                        if (!compile(child)) {
+                            return false;
+                        }
+                    }
+                }
+                break;
+            case Node::Type::ALTERNATE:
+                return compile_alternate(node);
+            case Node::Type::REPEAT:
+                return compile_repeat(node);
+        }
+        return program_.size() <= MAX_PROGRAM_SIZE;
+    }
+
+   private:
+    std::vector<Instruction> &program_;
+    bool reverse_;
+
+    Instruction &emit(Instruction::Op op, int x = -1, int y = -1) {
+        program_.emplace_back(op, x, y);
+        return program_.back();
+    }
+
+    int get_size() const { return static_cast<int>(program_.size()); }
+
+    bool compile_alternate(const Node &node) {
+        std::vector<int> jumps;
+        for (std::size_t i = 0; i < node.children.size(); ++i) {
+            int split = -1;
+            if (i + 1 < node.children.size()) {
+                split = get_size();
+                emit(Instruction::Op::SPLIT, split + 1);
+            }
+            if (!compile(node.children[i])) {
+                return false;
+            }
+            if (split != -1) {
+                jumps.push_back(get_size());
+                emit(Instruction::Op::JUMP);
+                program_[split].y = get_size();
+            }
+        }
+        for (int jump : jumps) {
+            program_[jump].x = get_size();
+        }
+        return true;
+    }
+
+    bool compile_repeat(const Node &node) {
+        const Node &child = node.children.front();
+        for (int i = 0; i < node.min; ++i) {
+            if (!compile(child)) {
+                return false;
+            }
+        }
+        if (node.max == -1) {
+            int split = get_size();
+            emit(Instruction::Op::SPLIT, split + 1);
+            if (!compile(child)) {
+                return false;
+            }
+            emit(Instruction::Op::JUMP, split);
+            program_[split].y = get_size();
+            return true;
+        }
+        // Each optional repetition can skip to the end
+        std::vector<int> splits;
+        for (int i = node.min; i < node.max; ++i) {
+            splits.push_back(get_size());
+            emit(Instruction::Op::SPLIT, get_size() + 1);
+            if (!compile(child)) {
+                return false;
+            }
+        }
+        for (int split : splits) {
+            program_[split].y = get_size();
+        }
+        return true;
+    }
+};
+
+bool append_literal_prefix(const Node &node, std::string &prefix) {
+    // Append the literal that a match of the node starts with, returns
+    // whether the node only matches that literal
+    switch (node.type) {
+        case Node::Type::BYTES:
+            if (node.bytes.count() != 1) {
+                return false;
+            }
+            for (int c = 0; c < 256; ++c) {
+                if (node.bytes.test(c)) {
+                    prefix += static_cast<char>(c);
+                }
+            }
+            return true;
+        case Node::Type::BEGIN:
+        case Node::Type::EMPTY:
+            return true;
+        case Node::Type::CONCAT:
+            for (const Node &child : node.children) {
+                if (!append_literal_prefix(child, prefix)) {
+                    return false;
+                }
+            }
+            return true;
+        case Node::Type::REPEAT:
+            if (node.min > 0) {
+                append_literal_prefix(node.children.front(), prefix);
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+void fold_case(Node &node) {
+    // Let every byte set match both cases of its letters
+    if (node.type == Node::Type::BYTES) {
+        ByteSet bytes = node.bytes;
+        for (int c = 0; c < 256; ++c) {
+            if (bytes.test(c) && std::isalpha(c)) {
+                node.bytes.set(std::tolower(c));
+                node.bytes.set(std::toupper(c));
+            }
+        }
+    }
+    for (Node &child : node.children) {
+        fold_case(child);
+    }
+}
+
+void append_required_literals(const Node &node,
+                              std::vector<std::string> &literals,
+                              std::string &literal) {
+    // Append literals that every match contains, literal is the run of single
+    // bytes that the node continues
+    switch (node.type) {
+        case Node::Type::BYTES:
+            if (node.bytes.count() != 1) {
+                break;
+            }
+            for (int c = 0; c < 256; ++c) {
+                if (node.bytes.test(c)) {
+                    literal += static_cast<char>(c);
+                }
+            }
+            return;
+        case Node::Type::BEGIN:
+        case Node::Type::END:
+        case Node::Type::EMPTY:
+            return;
+        case Node::Type::CONCAT:
+            for (const Node &child : node.children) {
+                append_required_literals(child, literals, literal);
+            }
+            return;
+        case Node::Type::REPEAT:
+            if (node.min > 0) {
+                // The literals of one repetition are required but repetitions
+                // do not join the run around them
+                if (!literal.empty()) {
+                    literals.push_back(literal);
+                }
+                literal.clear();
+                append_required_literals(node.children.front(), literals,
+                                         literal);
+            }
+            break;
+        default:
+            break;
+    }
+    if (!literal.empty()) {
+        literals.push_back(literal);
+    }
+    literal.clear();
+}
+}  // namespace
+
+Instruction::Instruction(Op op, int x, int y) : op(op), x(x), y(y) {}
+
+Automaton::Automaton() : Automaton({Instruction(Instruction::Op::MATCH)}) {}
+
+Automaton::Automaton(const std::vector<Instruction> &program)
+    : program_(program), class_count_(1), starts_{{-1, -1}} {
+    byte_classes_[0] = 0;
+    for (int c = 1; c < 256; ++c) {
+        bool is_boundary = false;
+        for (const Instruction &instruction : program_) {
+            if (instruction.op == Instruction::Op::BYTE &&
+                instruction.bytes.test(c) != instruction.bytes.test(c - 1)) {
+                is_boundary = true;
+                break;
+            }
+        }
+        if (is_boundary) {
+            ++class_count_;
+        }
+        byte_classes_[c] = static_cast<unsigned char>(class_count_ - 1);
+    }
+}
+
+int Automaton::get_start(bool at_begin) {
+    int &start = starts_[at_begin ? 1 : 0];
+    if (start == -1) {
+        std::vector<int> pcs;
+        std::vector<bool> visited(program_.size(), false);
+        add_closure(pcs, visited, 0, at_begin, false);
+        start = get_state(pcs, at_begin);
+    }
+    return start;
+}
+
+int Automaton::step(int state, unsigned char byte) {
+    int byte_class = byte_classes_[byte];
+    int next = states_[state].next[byte_class];
+    if (next != -1) {
+        return next;
+    }
+    std::vector<int> pcs;
+    std::vector<bool> visited(program_.size(), false);
+    for (int pc : states_[state].pcs) {
+        const Instruction &instruction = program_[pc];
+        if (instruction.op == Instruction::Op::BYTE &&
+            instruction.bytes.test(byte)) {
+            add_closure(pcs, visited, pc + 1, false, false);
+        }
+    }
+    if (states_.size() >= MAX_STATES) {
+        // Start over instead of growing without bound, the transition is not
+        // recorded since the state it leaves is gone
+        clear_states();
+        return get_state(pcs, false);
+    }
+    next = get_state(pcs, false);
+    states_[state].next[byte_class] = next;
+    return next;
+}
+
+bool Automaton::is_match(int state) const { return states_[state].match; }
+
+bool Automaton::is_match_at_end(int state) const {
+    return states_[state].match_at_end;
+}
+
+bool Automaton::is_dead(int state) const { return states_[state].pcs.empty(); }
+
+std::size_t Automaton::get_state_count() const { return states_.size(); }
+
+void Automaton::add_closure(std::vector<int> &pcs, std::vector<bool> &visited,
+                            int pc, bool at_begin, bool at_end) const {
+    // Follow instructions that do not consume a byte, an explicit stack keeps
+    // long chains of them from overflowing the call stack
+    std::vector<int> stack = {pc};
+    while (!stack.empty()) {
+        pc = stack.back();
+        stack.pop_back();
+        if (visited[pc]) {
+            continue;
+        }
+        visited[pc] = true;
+        const Instruction &instruction = program_[pc];
+        switch (instruction.op) {
+            case Instruction::Op::BYTE:
+            case Instruction::Op::MATCH:
+                pcs.push_back(pc);
+                break;
+            case Instruction::Op::SPLIT:
+                stack.push_back(instruction.y);
+                stack.push_back(instruction.x);
+                break;
+            case Instruction::Op::JUMP:
+                stack.push_back(instruction.x);
+                break;
+            case Instruction::Op::ASSERT_BEGIN:
+                if (at_begin) {
+                    stack.push_back(pc + 1);
+                }
+                break;
+            case Instruction::Op::ASSERT_END:
+                // Kept until it is known whether the text ends
+                if (at_end) {
+                    stack.push_back(pc + 1);
+                } else {
+                    pcs.push_back(pc);
+                }
+                break;
+        }
+    }
+}
+
+int Automaton::get_state(const std::vector<int> &pcs, bool at_begin) {
+    std::vector<int> key = pcs;
+    std::sort(key.begin(), key.end());
+    if (at_begin) {
+        // Start states can still pass an assertion of the beginning after an
+        // assertion of the end
+        key.push_back(-1);
+    }
+    auto it = state_ids_.find(key);
+    if (it != state_ids_.end()) {
+        return it->second;
+    }
+    State state;
+    state.pcs = pcs;
+    state.match = false;
+    state.match_at_end = false;
+    std::vector<int> end_pcs;
+    std::vector<bool> visited(program_.size(), false);
+    for (int pc : pcs) {
+        if (program_[pc].op == Instruction::Op::MATCH) {
+            state.match = true;
+        }
+        add_closure(end_pcs, visited, pc, at_begin, true);
+    }
+    for (int pc : end_pcs) {
+        if (program_[pc].op == Instruction::Op::MATCH) {
+            state.match_at_end = true;
+        }
+    }
+    state.next.assign(class_count_, -1);
+    int id = static_cast<int>(states_.size());
+    states_.push_back(std::move(state));
+    state_ids_.emplace(std::move(key), id);
+    return id;
+}
+
+void Automaton::clear_states() {
+    states_.clear();
+    state_ids_.clear();
+    starts_ = {{-1, -1}};
+}
+
+Regex::Regex() : valid_(false) {}
+
+bool Regex::compile(const std::string &pattern, bool ignore_case) {
+    pattern_ = pattern;
+    error_.clear();
+    prefix_.clear();
+    required_literals_.clear();
+    valid_ = false;
+    Node root;
+    Parser parser(pattern);
+    if (!parser.parse(root)) {
+        error_ = parser.get_error();
+        return false;
+    }
+    if (ignore_case) {
+        fold_case(root);
+    }
+    std::vector<Instruction> forward;
+    // Matches can end anywhere before the point the reverse program starts
+    std::vector<Instruction> reverse = {
+        Instruction(Instruction::Op::SPLIT, 3, 1),
+        Instruction(Instruction::Op::BYTE),
+        Instruction(Instruction::Op::JUMP, 0)};
+    reverse[1].bytes.set();
+    if (!Compiler(forward, false).compile(root) ||
+        !Compiler(reverse, true).compile(root)) {
+        error_ = "Pattern is too large";
+        return false;
+    }
+    forward.emplace_back(Instruction::Op::MATCH);
+    reverse.emplace_back(Instruction::Op::MATCH);
+    forward_ = Automaton(forward);
+    reverse_ = Automaton(reverse);
+    append_literal_prefix(root, prefix_);
+    std::string literal;
+    append_required_literals(root, required_literals_, literal);
+    if (!literal.empty()) {
+        required_literals_.push_back(literal);
+    }
+    valid_ = true;
+    return true;
+}
+
+const std::string &Regex::get_pattern() const { return pattern_; }
+
+bool Regex::is_valid() const { return valid_; }
+
+const std::string &Regex::get_error() const { return error_; }
+
+bool Regex::find(const std::string &text, std::size_t start,
+                 std::size_t &match_start, std::size_t &match_end) {
+    if (!valid_ || start > text.length()) {
+        return false;
+    }
+    // Every match starts with the prefix, so no match starts before it
+    std::size_t lowest = start;
+    if (!prefix_.empty()) {
+        lowest = find_literal(text, prefix_, start);
+        if (lowest == std::string::npos) {
+            return false;
+        }
+    }
+    // Scan backward from the end, the last position in a matching state is
+    // the first position a match starts at
+    std::size_t length = text.length();
+    int state = reverse_.get_start(true);
+    match_start = std::string::npos;
+    if (reverse_.is_match(state) ||
+        (length == 0 && reverse_.is_match_at_end(state))) {
+        match_start = length;
+    }
+    for (std::size_t i = length; i > lowest; --i) {
+        state = reverse_.step(state, static_cast<unsigned char>(text[i - 1]));
+        if (reverse_.is_match(state) ||
+            (i == 1 && reverse_.is_match_at_end(state))) {
+            match_start = i - 1;
+        }
+    }
+    if (match_start == std::string::npos) {
+        return false;
+    }
+    match_end = get_match_end(text, match_start);
+    return true;
+}
+
+bool Regex::rfind(const std::string &text, std::size_t end,
+                  std::size_t &match_start, std::size_t &match_end) {
+    if (!valid_ || end == 0) {
+        return false;
+    }
+    if (!prefix_.empty() &&
+        rfind_literal(text, prefix_, end) == std::string::npos) {
+        return false;
+    }
+    std::size_t length = text.length();
+    int state = reverse_.get_start(true);
+    match_start = std::string::npos;
+    if (end > length && (reverse_.is_match(state) ||
+                         (length == 0 && reverse_.is_match_at_end(state)))) {
+        match_start = length;
+    }
+    for (std::size_t i = length; i > 0 && match_start == std::string::npos;
+         --i) {
+        state = reverse_.step(state, static_cast<unsigned char>(text[i - 1]));
+        bool is_match = reverse_.is_match(state) ||
+                        (i == 1 && reverse_.is_match_at_end(state));
+        if (is_match && i - 1 < end) {
+            match_start = i - 1;
+        }
+    }
+    if (match_start == std::string::npos) {
+        return false;
+    }
+    match_end = get_match_end(text, match_start);
+    return true;
+}
+
+void Regex::find_all(const std::string &text, std::size_t limit,
+                     std::vector<MatchRange> &matches) {
+    if (!valid_ || (!prefix_.empty() && find_literal(text, prefix_, 0) ==
+                                            std::string::npos)) {
+        return;
+    }
+    // One backward scan finds every position a match starts at
+    std::size_t length = text.length();
+    std::vector<bool> is_start(length + 1, false);
+    int state = reverse_.get_start(true);
+    is_start[length] = reverse_.is_match(state) ||
+                       (length == 0 && reverse_.is_match_at_end(state));
+    for (std::size_t i = length; i > 0; --i) {
+        state = reverse_.step(state, static_cast<unsigned char>(text[i - 1]));
+        is_start[i - 1] = reverse_.is_match(state) ||
+                          (i == 1 && reverse_.is_match_at_end(state));
+    }
+    std::size_t start = 0;
+    while (start < limit && start <= length) {
+        if (!is_start[start]) {
+            ++start;
+            continue;
+        }
+        std::size_t end = get_match_end(text, start);
+        matches.emplace_back(start, end);
+        // Step past an empty match so that the scan moves forward
+        start = end > start ? end : start + 1;
+    }
+}
+
+const std::vector<std::string> &Regex::get_required_literals() const {
+    return required_literals_;
+}
+
+std::size_t Regex::get_state_count() const {
+    return forward_.get_state_count() + reverse_.get_state_count();
+}
+
+std::size_t Regex::get_match_end(const std::string &text, std::size_t start) {
+    // Longest match from a position where a match is known to start
+    std::size_t length = text.length();
+    int state = forward_.get_start(start == 0);
+    std::size_t end = start;
+    for (std::size_t i = start; i < length; ++i) {
+        state = forward_.step(state, static_cast<unsigned char>(text[i]));
+        if (forward_.is_dead(state)) {
+            break;
+        }
+        if (forward_.is_match(state) ||
+            (i + 1 == length && forward_.is_match_at_end(state))) {
+            end = i + 1;
+        }
+    }
+    return end;
+}
@@ -0,0 +1,120 @@
+#ifndef CLADITOR_REGEX_HPP
+#define CLADITOR_REGEX_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using ByteSet = std::bitset<256>;
+// Start and end of a match
+using MatchRange = std::pair<std::size_t, std::size_t>;
+
+// Instruction of a Thompson automaton program
+struct Instruction {
+    enum class Op {
+        // Consume a byte of the set and continue with the next instruction
+        BYTE,
+        // Continue with both x and y
+        SPLIT,
+        JUMP,
+        // Only continue at the start or the end of the scanned text
+        ASSERT_BEGIN,
+        ASSERT_END,
+        MATCH
+    };
+
+    Op op;
+    int x;
+    int y;
+    ByteSet bytes;
+
+    explicit Instruction(Op, int = -1, int = -1);
+};
+
+// Deterministic automaton that simulates a program and builds its states
+// lazily while text is scanned
+class Automaton {
+   public:
+    // States are dropped once there are more than this many
+    static const std::size_t MAX_STATES = 4096;
+
+    Automaton();
+    explicit Automaton(const std::vector<Instruction> &);
+    // State before any byte is scanned, at_begin is whether the text begins
+    // at this point
+    int get_start(bool);
+    // Returned state may invalidate previously returned states when the cache
+    // is full
+    int step(int, unsigned char);
+    bool is_match(int) const;
+    // Whether the state matches if the text ends at this point
+    bool is_match_at_end(int) const;
+    bool is_dead(int) const;
+    std::size_t get_state_count() const;
+
+   private:
+    struct State {
+        // Instructions that consume a byte or need the end of the text
+        std::vector<int> pcs;
+        bool match;
+        bool match_at_end;
+        // Next state for each byte class or -1 if it was not built yet
+        std::vector<int> next;
+    };
+
+    std::vector<Instruction> program_;
+    // Bytes that no instruction distinguishes share a class
+    std::array<unsigned char, 256> byte_classes_;
+    int class_count_;
+    std::vector<State> states_;
+    std::map<std::vector<int>, int> state_ids_;
+    std::array<int, 2> starts_;
+
+    void add_closure(std::vector<int> &, std::vector<bool> &, int, bool,
+                     bool) const;
+    int get_state(const std::vector<int> &, bool);
+    void clear_states();
+};
+
+// Regular expression with the very magic syntax of Vim, matched in linear
+// time. Matches are leftmost-longest
+class Regex {
+   public:
+    Regex();
+    // Returns false and sets the error if the pattern is invalid, letters
+    // match either case if the flag is set
+    bool compile(const std::string &, bool = false);
+    const std::string &get_pattern() const;
+    bool is_valid() const;
+    const std::string &get_error() const;
+    // Find the match that starts first at or after the start index
+    bool find(const std::string &, std::size_t, std::size_t &, std::size_t &);
+    // Find the match that starts last before the end index
+    bool rfind(const std::string &, std::size_t, std::size_t &,
+               std::size_t &);
+    // Append the matches that do not overlap and start before the limit
+    void find_all(const std::string &, std::size_t, std::vector<MatchRange> &);
+    // Literals that every match contains
+    const std::vector<std::string> &get_required_literals() const;
+    std::size_t get_state_count() const;
+
+   private:
+    std::string pattern_;
+    std::string error_;
+    bool valid_;
+    // Literal that every match starts with
+    std::string prefix_;
+    std::vector<std::string> required_literals_;
+    // Anchored at the start of a match
+    Automaton forward_;
+    // Runs backward from the end of the text to find where matches start
+    Automaton reverse_;
+
+    std::size_t get_match_end(const std::string &, std::size_t);
+};
+
+#endif
@@ -0,0 +1,550 @@
+#include "search.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "position.hpp"
+#include "regex.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// Lines searched by a task of a parallel search before it takes another chunk
+const int SEARCH_CHUNK_LINES = 16384;
+
+// Searches return the start of a match in the haystack or std::string::npos
+using FindFunction = std::size_t (*)(const char *, std::size_t, const char *,
+                                     std::size_t);
+
+bool matches_middle(const char *candidate, const char *needle,
+                    std::size_t needle_length) {
+    // First and last bytes are already known to match
+    return needle_length <= 2 ||
+           std::memcmp(candidate + 1, needle + 1, needle_length - 2) == 0;
+}
+
+std::size_t find_scalar(const char *haystack, std::size_t length,
+                        const char *needle, std::size_t needle_length) {
+    if (needle_length > length) {
+        return std::string::npos;
+    }
+    const char *end = haystack + length - needle_length + 1;
+    const char *candidate = haystack;
+    while (candidate < end) {
+        candidate = static_cast<const char *>(
+            std::memchr(candidate, needle[0], end - candidate));
+        if (candidate == nullptr) {
+            break;
+        }
+        if (candidate[needle_length - 1] == needle[needle_length - 1] &&
+            matches_middle(candidate, needle, needle_length)) {
+            return candidate - haystack;
+        }
+        ++candidate;
+    }
+    return std::string::npos;
+}
+
+std::size_t rfind_scalar(const char *haystack, std::size_t length,
+                         const char *needle, std::size_t needle_length) {
+    if (needle_length > length) {
+        return std::string::npos;
+    }
+    for (std::size_t i = length - needle_length + 1; i-- > 0;) {
+        if (haystack[i] == needle[0] &&
+            haystack[i + needle_length - 1] == needle[needle_length - 1] &&
+            matches_middle(haystack + i, needle, needle_length)) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+#if defined(__SSE2__)
+// Vectorized searches compare a block of candidate first bytes and the block
+// of their last bytes at once, only candidates matching both are verified
+
+std::size_t find_sse2(const char *haystack, std::size_t length,
+                      const char *needle, std::size_t needle_length) {
+    if (needle_length > length) {
+        return std::string::npos;
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    std::size_t candidates = length - needle_length + 1;
+    std::size_t i = 0;
+    for (; i + 16 <= candidates; i += 16) {
+        __m128i first_block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i last_block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(haystack + i + needle_length -
+                                              1));
+        unsigned int mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, first_block),
+                                            _mm_cmpeq_epi8(last, last_block))));
+        while (mask != 0) {
+            std::size_t candidate = i + __builtin_ctz(mask);
+            if (matches_middle(haystack + candidate, needle, needle_length)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    std::size_t tail = find_scalar(haystack + i, length - i, needle,
+                                   needle_length);
+    return tail == std::string::npos ? tail : i + tail;
+}
+
+std::size_t rfind_sse2(const char *haystack, std::size_t length,
+                       const char *needle, std::size_t needle_length) {
+    if (needle_length > length) {
+        return std::string::npos;
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    std::size_t end = length - needle_length + 1;
+    for (; end >= 16; end -= 16) {
+        std::size_t i = end - 16;
+        __m128i first_block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i last_block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(haystack + i + needle_length -
+                                              1));
+        unsigned int mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, first_block),
+                                            _mm_cmpeq_epi8(last, last_block))));
+        while (mask != 0) {
+            int bit = 31 - __builtin_clz(mask);
+            if (matches_middle(haystack + i + bit, needle, needle_length)) {
+                return i + bit;
+            }
+            mask &= ~(1U << bit);
+        }
+    }
+    return rfind_scalar(haystack, end + needle_length - 1, needle,
+                        needle_length);
+}
+
+#if defined(__GNUC__)
+// The upper halves of the AVX registers are cleared before returning, since
+// unoptimized builds do not, and SSE code after them runs much slower
+__attribute__((target("avx2"))) std::size_t find_avx2(
+    const char *haystack, std::size_t length, const char *needle,
+    std::size_t needle_length) {
+    if (needle_length > length) {
+        return std::string::npos;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    std::size_t candidates = length - needle_length + 1;
+    std::size_t i = 0;
+    for (; i + 32 <= candidates; i += 32) {
+        __m256i first_block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i last_block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(haystack + i + needle_length -
+                                              1));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, first_block),
+                             _mm256_cmpeq_epi8(last, last_block))));
+        while (mask != 0) {
+            std::size_t candidate = i + __builtin_ctz(mask);
+            if (matches_middle(haystack + candidate, needle, needle_length)) {
+                _mm256_zeroupper();
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    _mm256_zeroupper();
+    std::size_t tail =
+        find_sse2(haystack + i, length - i, needle, needle_length);
+    return tail == std::string::npos ? tail : i + tail;
+}
+
+__attribute__((target("avx2"))) std::size_t rfind_avx2(
+    const char *haystack, std::size_t length, const char *needle,
+    std::size_t needle_length) {
+    if (needle_length > length) {
+        return std::string::npos;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    std::size_t end = length - needle_length + 1;
+    for (; end >= 32; end -= 32) {
+        std::size_t i = end - 32;
+        __m256i first_block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i last_block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(haystack + i + needle_length -
+                                              1));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, first_block),
+                             _mm256_cmpeq_epi8(last, last_block))));
+        while (mask != 0) {
+            int bit = 31 - __builtin_clz(mask);
+            if (matches_middle(haystack + i + bit, needle, needle_length)) {
+                _mm256_zeroupper();
+                return i + bit;
+            }
+            mask &= ~(1U << bit);
+        }
+    }
+    _mm256_zeroupper();
+    return rfind_sse2(haystack, end + needle_length - 1, needle,
+                      needle_length);
+}
+
+bool has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+// Selected once depending on the instructions supported by the processor
+const FindFunction FIND = has_avx2() ? find_avx2 : find_sse2;
+const FindFunction RFIND = has_avx2() ? rfind_avx2 : rfind_sse2;
+#else
+const FindFunction FIND = find_sse2;
+const FindFunction RFIND = rfind_sse2;
+#endif
+#else
+const FindFunction FIND = find_scalar;
+const FindFunction RFIND = rfind_scalar;
+#endif
+}  // namespace
+
+std::size_t find_literal(const std::string &haystack,
+                         const std::string &needle, std::size_t start) {
+    if (start > haystack.length()) {
+        return std::string::npos;
+    }
+    if (needle.empty()) {
+        return start;
+    }
+    std::size_t result =
+        FIND(haystack.data() + start, haystack.length() - start, needle.data(),
+             needle.length());
+    return result == std::string::npos ? result : start + result;
+}
+
+std::size_t rfind_literal(const std::string &haystack,
+                          const std::string &needle, std::size_t end) {
+    if (end == 0) {
+        return std::string::npos;
+    }
+    if (needle.empty()) {
+        return std::min(end - 1, haystack.length());
+    }
+    // Matches starting before end can extend past it
+    std::size_t length =
+        end > haystack.length()
+            ? haystack.length()
+            : std::min(haystack.length(), end - 1 + needle.length());
+    return RFIND(haystack.data(), length, needle.data(), needle.length());
+}
+
+namespace {
+template <typename Find, typename ReverseFind>
+bool search_lines_with(const std::vector<std::string> &lines, Position from,
+                       SearchDirection direction, Position &match,
+                       bool &wrapped, int line_count,
+                       const LineFilter &filter, Find find,
+                       ReverseFind rfind) {
+    // find(line, start) and rfind(line, end) return the start of a match in
+    // the line or std::string::npos
+    wrapped = false;
+    if (lines.empty()) {
+        return false;
+    }
+    int size = static_cast<int>(lines.size());
+    bool forward = direction == SearchDirection::FORWARD;
+    std::size_t column = static_cast<std::size_t>(std::max(0, from.x));
+    // Rest of the line of the cursor
+    std::size_t result = forward ? find(lines[from.y], column + 1)
+                                 : rfind(lines[from.y], column);
+    if (result != std::string::npos) {
+        match = {from.y, static_cast<int>(result)};
+        return true;
+    }
+    int last = line_count == -1 ? size : std::min(size, line_count);
+    // Lines before this distance are known to pass the filter
+    int filtered = 0;
+    for (int i = 1; i <= last; ++i) {
+        int line = forward ? from.y + i : from.y - i;
+        if (line >= size || line < 0) {
+            wrapped = true;
+            line = (line + size) % size;
+        }
+        if (filter && i >= filtered) {
+            // Runs stop at the first and last line, so skipping never wraps
+            int run = 1;
+            if (!filter(line, direction, run)) {
+                i += run - 1;
+                continue;
+            }
+            filtered = i + run;
+        }
+        result = forward ? find(lines[line], 0)
+                         : rfind(lines[line], std::string::npos);
+        if (result != std::string::npos) {
+            // After wrapping around, the line of the cursor can only match on
+            // the side of the cursor that has not been searched
+            match = {line, static_cast<int>(result)};
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace
+
+SearchPattern::SearchPattern() : is_regex_(false) {}
+
+bool SearchPattern::set(const std::string &source, bool ignore_case) {
+    source_ = source;
+    if (source.compare(0, 2, "\\v") == 0) {
+        is_regex_ = true;
+        return regex_.compile(source.substr(2), ignore_case);
+    }
+    is_regex_ = ignore_case;
+    if (!ignore_case) {
+        return true;
+    }
+    // Literals that ignore case are matched as a regular expression where
+    // every character but letters and digits is escaped
+    std::string escaped;
+    for (char c : source) {
+        if (!std::isalnum(static_cast<unsigned char>(c))) {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return regex_.compile(escaped, true);
+}
+
+const std::string &SearchPattern::get_source() const { return source_; }
+
+const std::string &SearchPattern::get_error() const {
+    return regex_.get_error();
+}
+
+bool SearchPattern::empty() const { return source_.empty(); }
+
+bool SearchPattern::is_valid() const { return !is_regex_ || regex_.is_valid(); }
+
+bool SearchPattern::find(const std::string &text, std::size_t start,
+                         std::size_t &match_start, std::size_t &match_end) {
+    if (is_regex_) {
+        return regex_.find(text, start, match_start, match_end);
+    }
+    match_start = find_literal(text, source_, start);
+    match_end = match_start + source_.length();
+    return !source_.empty() && match_start != std::string::npos;
+}
+
+bool SearchPattern::rfind(const std::string &text, std::size_t end,
+                          std::size_t &match_start, std::size_t &match_end) {
+    if (is_regex_) {
+        return regex_.rfind(text, end, match_start, match_end);
+    }
+    match_start = rfind_literal(text, source_, end);
+    match_end = match_start + source_.length();
+    return !source_.empty() && match_start != std::string::npos;
+}
+
+void SearchPattern::find_all(const std::string &text, std::size_t limit,
+                             std::vector<MatchRange> &matches) {
+    if (is_regex_) {
+        regex_.find_all(text, limit, matches);
+        return;
+    }
+    if (source_.empty()) {
+        return;
+    }
+    std::size_t start = find_literal(text, source_, 0);
+    while (start != std::string::npos && start < limit) {
+        matches.emplace_back(start, start + source_.length());
+        start = find_literal(text, source_, start + source_.length());
+    }
+}
+
+std::vector<std::string> SearchPattern::get_required_literals() const {
+    if (is_regex_) {
+        return regex_.get_required_literals();
+    }
+    return {source_};
+}
+
+bool search_lines(const std::vector<std::string> &lines,
+                  const std::string &needle, Position from,
+                  SearchDirection direction, Position &match, bool &wrapped,
+                  int line_count) {
+    if (needle.empty()) {
+        wrapped = false;
+        return false;
+    }
+    return search_lines_with(
+        lines, from, direction, match, wrapped, line_count, LineFilter(),
+        [&needle](const std::string &line, std::size_t start) {
+            return find_literal(line, needle, start);
+        },
+        [&needle](const std::string &line, std::size_t end) {
+            return rfind_literal(line, needle, end);
+        });
+}
+
+bool search_lines(const std::vector<std::string> &lines,
+                  SearchPattern &pattern, Position from,
+                  SearchDirection direction, Position &match, bool &wrapped,
+                  int line_count, const LineFilter &filter) {
+    return search_lines_with(
+        lines, from, direction, match, wrapped, line_count, filter,
+        [&pattern](const std::string &line, std::size_t start) {
+            std::size_t match_start = 0;
+            std::size_t match_end = 0;
+            return pattern.find(line, start, match_start, match_end)
+                       ? match_start
+                       : std::string::npos;
+        },
+        [&pattern](const std::string &line, std::size_t end) {
+            std::size_t match_start = 0;
+            std::size_t match_end = 0;
+            return pattern.rfind(line, end, match_start, match_end)
+                       ? match_start
+                       : std::string::npos;
+        });
+}
+
+bool search_lines(ThreadPool &pool, const std::vector<std::string> &lines,
+                  const SearchPattern &pattern, Position from,
+                  SearchDirection direction, Position &match, bool &wrapped,
+                  const LineFilter &filter) {
+    SearchPattern cursor_pattern = pattern;
+    if (search_lines(lines, cursor_pattern, from, direction, match, wrapped,
+                     0)) {
+        return true;
+    }
+    // Lines are numbered by their distance from the cursor in the direction
+    // of the search, as in the serial search, and chunks are taken in that
+    // order so that a task can stop once an earlier line has matched
+    int size = static_cast<int>(lines.size());
+    bool forward = direction == SearchDirection::FORWARD;
+    int chunk_count = (size + SEARCH_CHUNK_LINES - 1) / SEARCH_CHUNK_LINES;
+    std::atomic<int> next_chunk(0);
+    std::atomic<int> best_distance(INT_MAX);
+    std::mutex match_mutex;
+    for (int i = 0; i < pool.get_thread_count(); ++i) {
+        pool.submit([&] {
+            // Patterns build their automaton while matching, so every task
+            // has its own copy
+            SearchPattern task_pattern = pattern;
+            std::size_t match_start = 0;
+            std::size_t match_end = 0;
+            for (int chunk = next_chunk++; chunk < chunk_count;
+                 chunk = next_chunk++) {
+                int first = chunk * SEARCH_CHUNK_LINES + 1;
+                int last = std::min(size, first + SEARCH_CHUNK_LINES - 1);
+                int filtered = first;
+                for (int distance = first; distance <= last; ++distance) {
+                    if (distance >= best_distance.load()) {
+                        return;
+                    }
+                    int line = forward ? from.y + distance : from.y - distance;
+                    line = (line + size) % size;
+                    if (filter && distance >= filtered) {
+                        int run = 1;
+                        if (!filter(line, direction, run)) {
+                            distance += run - 1;
+                            continue;
+                        }
+                        filtered = distance + run;
+                    }
+                    bool found = forward
+                                     ? task_pattern.find(lines[line], 0,
+                                                         match_start, match_end)
+                                     : task_pattern.rfind(
+                                           lines[line], std::string::npos,
+                                           match_start, match_end);
+                    if (found) {
+                        std::lock_guard<std::mutex> lock(match_mutex);
+                        if (distance < best_distance.load()) {
+                            best_distance = distance;
+                            match = {line, static_cast<int>(match_start)};
+                        }
+                        return;
+                    }
+                }
+            }
+        });
+    }
+    pool.wait();
+    if (best_distance.load() == INT_MAX) {
+        return false;
+    }
+    int distance = best_distance.load();
+    wrapped = forward ? from.y + distance >= size : from.y - distance < 0;
+    return true;
+}
+
+MatchCache::MatchCache() : version_(0) {}
+
+const std::vector<MatchRange> &MatchCache::get_matches(
+    SearchPattern &pattern, const std::vector<std::string> &lines,
+    std::uint64_t version, int line, std::size_t limit) {
+    if (pattern.get_source() != pattern_ || version != version_ ||
+        entries_.size() >= MAX_LINES) {
+        pattern_ = pattern.get_source();
+        version_ = version;
+        entries_.clear();
+    }
+    auto it = entries_.find(line);
+    if (it != entries_.end() && it->second.limit >= limit) {
+        return it->second.matches;
+    }
+    Entry &entry = entries_[line];
+    entry.limit = limit;
+    entry.matches.clear();
+    pattern.find_all(lines[line], limit, entry.matches);
+    return entry.matches;
+}
+
+void MatchCache::on_change(const std::vector<std::string> &,
+                           const BufferChange &change) {
+    if (version_ + 1 != change.version) {
+        // Matches were found before an earlier change, get_matches drops them
+        return;
+    }
+    version_ = change.version;
+    if (entries_.empty()) {
+        return;
+    }
+    int end = change.first + change.removed;
+    int shift = change.inserted - change.removed;
+    std::unordered_map<int, Entry> entries;
+    for (auto &entry : entries_) {
+        int line = entry.first;
+        if (line < change.first) {
+            entries.emplace(line, std::move(entry.second));
+        } else if (line >= end) {
+            entries.emplace(line + shift, std::move(entry.second));
+        } else if (change.rows != nullptr && shift == 0 &&
+                   !std::binary_search(change.rows->begin(),
+                                       change.rows->end(), line)) {
+            // Lines between the changed lines of a scattered change stay
+            entries.emplace(line, std::move(entry.second));
+        }
+    }
+    entries_ = std::move(entries);
+}
@@ -0,0 +1,100 @@
+#ifndef CLADITOR_SEARCH_HPP
+#define CLADITOR_SEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "position.hpp"
+#include "regex.hpp"
+#include "thread_pool.hpp"
+
+enum class SearchDirection { FORWARD, BACKWARD };
+
+// Returns whether a line may match and sets the number of lines from it in
+// the direction that have the same answer, which lets searches skip lines
+using LineFilter = std::function<bool(int, SearchDirection, int &)>;
+
+// Return the index of the first occurrence of the needle that starts at or
+// after the start index, or std::string::npos
+std::size_t find_literal(const std::string &, const std::string &,
+                         std::size_t);
+// Return the index of the last occurrence of the needle that starts before
+// the end index, or std::string::npos
+std::size_t rfind_literal(const std::string &, const std::string &,
+                          std::size_t);
+
+// Literal text or a regular expression if it starts with \v
+class SearchPattern {
+   public:
+    SearchPattern();
+    // Returns false and sets the error if the regular expression is invalid,
+    // letters match either case if the flag is set
+    bool set(const std::string &, bool = false);
+    const std::string &get_source() const;
+    const std::string &get_error() const;
+    bool empty() const;
+    bool is_valid() const;
+    bool find(const std::string &, std::size_t, std::size_t &, std::size_t &);
+    bool rfind(const std::string &, std::size_t, std::size_t &,
+               std::size_t &);
+    // Append the matches that do not overlap and start before the limit
+    void find_all(const std::string &, std::size_t, std::vector<MatchRange> &);
+    // Literals that every match contains
+    std::vector<std::string> get_required_literals() const;
+
+   private:
+    std::string source_;
+    bool is_regex_;
+    // Compiled once, its states are kept between searches
+    Regex regex_;
+};
+
+// Find the next occurrence of the needle in lines from a position, wrapping
+// around the end of the lines. Returns false if there is no occurrence. Only
+// the given number of lines after the position are searched if it is not -1,
+// and lines that the filter rejects are skipped if it is given
+bool search_lines(const std::vector<std::string> &, const std::string &,
+                  Position, SearchDirection, Position &, bool &, int = -1);
+bool search_lines(const std::vector<std::string> &, SearchPattern &, Position,
+                  SearchDirection, Position &, bool &, int = -1,
+                  const LineFilter & = LineFilter());
+// Search chunks of lines on the pool, chunks after a match are skipped
+bool search_lines(ThreadPool &, const std::vector<std::string> &,
+                  const SearchPattern &, Position, SearchDirection, Position &,
+                  bool &, const LineFilter & = LineFilter());
+
+// Matches of a pattern in lines, kept per line until the line changes
+class MatchCache : public BufferObserver {
+   public:
+    // Lines are dropped once there are more than this many
+    static const std::size_t MAX_LINES = 4096;
+
+    MatchCache();
+    // Matches in a line that start before the limit
+    const std::vector<MatchRange> &get_matches(SearchPattern &,
+                                               const std::vector<std::string> &,
+                                               std::uint64_t, int,
+                                               std::size_t);
+    // Drop the matches of changed lines and move the matches after them
+    void on_change(const std::vector<std::string> &,
+                   const BufferChange &) override;
+
+   private:
+    struct Entry {
+        // Matches were found up to this limit
+        std::size_t limit;
+        std::vector<MatchRange> matches;
+    };
+
+    std::string pattern_;
+    // Version of the lines that the matches were found in
+    std::uint64_t version_;
+    std::unordered_map<int, Entry> entries_;
+};
+
+#endif
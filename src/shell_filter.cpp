@@ -0,0 +1,317 @@
+#include "shell_filter.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+namespace {
+const std::size_t READ_BUFFER_SIZE = 1 << 16;
+// Lines given to a single writev
+const int LINES_PER_WRITE = 512;
+char NEWLINE = '\n';
+// Milliseconds between checks whether the command has exited
+const int EXIT_CHECK_INTERVAL = 1;
+
+int get_timeout(Job::Clock::time_point deadline) {
+    // Milliseconds until the deadline for poll
+    return static_cast<int>(std::max<std::chrono::milliseconds::rep>(
+        0, std::chrono::duration_cast<std::chrono::milliseconds>(
+               deadline - Job::Clock::now())
+               .count()));
+}
+
+bool set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+}  // namespace
+
+ShellFilter::ShellFilter(const std::string &command,
+                         const std::vector<std::string> &lines, int first,
+                         int last)
+    : command_(command),
+      lines_(lines),
+      first_line_(first),
+      last_line_(last),
+      next_line_(first),
+      line_offset_(0),
+      pid_(-1),
+      input_fd_(-1),
+      output_fd_(-1),
+      partial_line_(false),
+      buffer_(READ_BUFFER_SIZE),
+      previous_sigpipe_(),
+      failed_(false),
+      finished_(false) {}
+
+ShellFilter::~ShellFilter() {
+    if (!finished_) {
+        cancel();
+    }
+}
+
+bool ShellFilter::run_slice(Clock::time_point deadline) {
+    if (finished_) {
+        return true;
+    }
+    if (pid_ == -1 && !start()) {
+        return true;
+    }
+    // Input is written until the command stops reading it, even after the
+    // command closed its output
+    while (output_fd_ != -1 || input_fd_ != -1) {
+        pollfd fds[2];
+        int fd_count = 0;
+        pollfd *output = nullptr;
+        pollfd *input = nullptr;
+        if (output_fd_ != -1) {
+            output = &fds[fd_count++];
+            *output = {output_fd_, POLLIN, 0};
+        }
+        if (input_fd_ != -1) {
+            input = &fds[fd_count++];
+            *input = {input_fd_, POLLOUT, 0};
+        }
+        int ready = poll(fds, fd_count, get_timeout(deadline));
+        if (ready == -1 && errno != EINTR) {
+            fail(std::strerror(errno));
+            return true;
+        }
+        if (ready > 0 && input != nullptr && input->revents != 0) {
+            write_input();
+        }
+        if (ready > 0 && output != nullptr && output->revents != 0) {
+            read_output();
+        }
+        if (failed_) {
+            return true;
+        }
+        if ((output_fd_ != -1 || input_fd_ != -1) &&
+            Clock::now() >= deadline) {
+            return false;
+        }
+    }
+    // The command is not waited on past the deadline, so that one that keeps
+    // running after closing its output can still be cancelled
+    int status = 0;
+    pid_t exited = 0;
+    while ((exited = waitpid(pid_, &status, WNOHANG)) != pid_) {
+        if (exited == -1 && errno != EINTR) {
+            fail(std::strerror(errno));
+            return true;
+        }
+        if (exited == 0) {
+            if (Clock::now() >= deadline) {
+                return false;
+            }
+            poll(nullptr, 0,
+                 std::min(EXIT_CHECK_INTERVAL, get_timeout(deadline)));
+        }
+    }
+    pid_ = -1;
+    stop();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        failed_ = true;
+        error_ = WIFEXITED(status)
+                     ? "Shell returned " + std::to_string(WEXITSTATUS(status))
+                     : "Shell was terminated";
+    }
+    finished_ = true;
+    return true;
+}
+
+double ShellFilter::get_progress() const {
+    // Input that is written, the output is not known in advance
+    return last_line_ < first_line_
+               ? 1.0
+               : static_cast<double>(next_line_ - first_line_) /
+                     (last_line_ - first_line_ + 1);
+}
+
+std::string ShellFilter::get_description() const {
+    return "Filtering through " + command_;
+}
+
+void ShellFilter::cancel() {
+    if (pid_ != -1) {
+        // The whole group is killed so that pipelines stop as well. A signal
+        // that can be handled could run handlers of the editor in a child
+        // that has not run the command yet
+        kill(-pid_, SIGKILL);
+        close_input();
+        if (output_fd_ != -1) {
+            close(output_fd_);
+            output_fd_ = -1;
+        }
+        while (waitpid(pid_, nullptr, 0) == -1 && errno == EINTR) {
+        }
+        pid_ = -1;
+        stop();
+    }
+    finished_ = true;
+}
+
+bool ShellFilter::has_failed() const { return failed_; }
+
+const std::string &ShellFilter::get_error() const { return error_; }
+
+std::vector<std::string> &ShellFilter::get_output() { return output_; }
+
+bool ShellFilter::start() {
+    int input_pipe[2];
+    int output_pipe[2];
+    if (pipe(input_pipe) == -1) {
+        fail(std::strerror(errno));
+        return false;
+    }
+    if (pipe(output_pipe) == -1) {
+        fail(std::strerror(errno));
+        close(input_pipe[0]);
+        close(input_pipe[1]);
+        return false;
+    }
+    // A command that exits before reading its input makes writes fail with
+    // EPIPE instead of ending the editor
+    struct sigaction ignore = {};
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &previous_sigpipe_);
+    const char *command = command_.c_str();
+    pid_ = fork();
+    if (pid_ == 0) {
+        // Only async signal safe functions are called before exec
+        setpgid(0, 0);
+        sigaction(SIGPIPE, &previous_sigpipe_, nullptr);
+        dup2(input_pipe[0], STDIN_FILENO);
+        dup2(output_pipe[1], STDOUT_FILENO);
+        dup2(output_pipe[1], STDERR_FILENO);
+        close(input_pipe[0]);
+        close(input_pipe[1]);
+        close(output_pipe[0]);
+        close(output_pipe[1]);
+        execl("/bin/sh", "sh", "-c", command, static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    if (pid_ != -1) {
+        // Also set by the child, whichever runs first
+        setpgid(pid_, pid_);
+    }
+    close(input_pipe[0]);
+    close(output_pipe[1]);
+    input_fd_ = input_pipe[1];
+    output_fd_ = output_pipe[0];
+    if (pid_ == -1) {
+        fail(std::strerror(errno));
+        return false;
+    }
+    fcntl(input_fd_, F_SETFD, FD_CLOEXEC);
+    fcntl(output_fd_, F_SETFD, FD_CLOEXEC);
+    if (!set_non_blocking(input_fd_) || !set_non_blocking(output_fd_)) {
+        fail(std::strerror(errno));
+        return false;
+    }
+    if (next_line_ > last_line_) {
+        close_input();
+    }
+    return true;
+}
+
+void ShellFilter::write_input() {
+    // Lines and their new lines are written straight from the buffer
+    iovec vectors[LINES_PER_WRITE * 2];
+    int count = 0;
+    // A line takes one or two vectors, so one is only added if both fit
+    for (int line = next_line_;
+         line <= last_line_ && count + 2 <= LINES_PER_WRITE * 2; ++line) {
+        std::size_t offset = line == next_line_ ? line_offset_ : 0;
+        const std::string &text = lines_[line];
+        if (offset < text.length()) {
+            vectors[count++] = {const_cast<char *>(text.data()) + offset,
+                                text.length() - offset};
+        }
+        vectors[count++] = {&NEWLINE, 1};
+    }
+    ssize_t written = writev(input_fd_, vectors, count);
+    if (written == -1) {
+        if (errno == EPIPE) {
+            // The command stopped reading
+            close_input();
+        } else if (errno != EAGAIN && errno != EINTR) {
+            fail(std::strerror(errno));
+        }
+        return;
+    }
+    std::size_t remaining = static_cast<std::size_t>(written);
+    while (remaining > 0) {
+        std::size_t line_remaining =
+            lines_[next_line_].length() + 1 - line_offset_;
+        if (remaining < line_remaining) {
+            line_offset_ += remaining;
+            break;
+        }
+        remaining -= line_remaining;
+        ++next_line_;
+        line_offset_ = 0;
+    }
+    if (next_line_ > last_line_) {
+        close_input();
+    }
+}
+
+void ShellFilter::read_output() {
+    ssize_t count = read(output_fd_, buffer_.data(), buffer_.size());
+    if (count == -1) {
+        if (errno != EAGAIN && errno != EINTR) {
+            fail(std::strerror(errno));
+        }
+        return;
+    }
+    if (count == 0) {
+        close(output_fd_);
+        output_fd_ = -1;
+        return;
+    }
+    // Output is split into lines as it arrives
+    const char *position = buffer_.data();
+    const char *end = position + count;
+    while (position < end) {
+        const char *newline = static_cast<const char *>(
+            std::memchr(position, '\n', end - position));
+        const char *line_end = newline == nullptr ? end : newline;
+        if (partial_line_) {
+            output_.back().append(position, line_end);
+        } else {
+            output_.emplace_back(position, line_end);
+        }
+        partial_line_ = newline == nullptr;
+        position = line_end + (newline == nullptr ? 0 : 1);
+    }
+}
+
+void ShellFilter::close_input() {
+    if (input_fd_ != -1) {
+        close(input_fd_);
+        input_fd_ = -1;
+    }
+}
+
+void ShellFilter::stop() { sigaction(SIGPIPE, &previous_sigpipe_, nullptr); }
+
+void ShellFilter::fail(const std::string &error) {
+    failed_ = true;
+    error_ = error;
+    cancel();
+}
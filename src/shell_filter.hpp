@@ -0,0 +1,63 @@
+#ifndef CLADITOR_SHELL_FILTER_HPP
+#define CLADITOR_SHELL_FILTER_HPP
+
+#include <sys/types.h>
+
+#include <csignal>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+// Runs lines through a shell command in slices. Lines are written to the
+// input of the command while its output is read, so that neither side waits
+// for the other and the input is never copied
+class ShellFilter : public Job {
+   public:
+    // Lines from first to last inclusive are the input, there is none if
+    // first is after last. Lines must not change while the job is running
+    ShellFilter(const std::string &, const std::vector<std::string> &, int,
+                int);
+    ~ShellFilter() override;
+
+    bool run_slice(Clock::time_point) override;
+    double get_progress() const override;
+    std::string get_description() const override;
+    void cancel() override;
+    bool has_failed() const;
+    const std::string &get_error() const;
+    // Lines of the output, stderr included. The whole output is kept until
+    // the job has finished, so that a cancelled or failed command leaves the
+    // input lines as they were
+    std::vector<std::string> &get_output();
+
+   private:
+    std::string command_;
+    const std::vector<std::string> &lines_;
+    int first_line_;
+    int last_line_;
+    // Line that is being written and the bytes of it that are written, the
+    // new line after it is written once the offset passes its length
+    int next_line_;
+    std::size_t line_offset_;
+    pid_t pid_;
+    int input_fd_;
+    int output_fd_;
+    std::vector<std::string> output_;
+    // Whether the last line of the output has not ended yet
+    bool partial_line_;
+    std::vector<char> buffer_;
+    struct sigaction previous_sigpipe_;
+    bool failed_;
+    bool finished_;
+    std::string error_;
+
+    bool start();
+    void write_input();
+    void read_output();
+    void close_input();
+    void stop();
+    void fail(const std::string &);
+};
+#endif
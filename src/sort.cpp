@@ -0,0 +1,272 @@
+#include "sort.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstddef>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "job.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// Rows sorted by a task of a parallel sort, and rows of the result that a task
+// merges, before it takes another chunk
+const int SORT_CHUNK_LINES = 65536;
+// Number of lines without a number, which sort before every number
+const long long NO_NUMBER = LLONG_MIN;
+
+long long get_number(const std::string &line) {
+    // First decimal number of the line, negative if a '-' is before it
+    std::size_t i = 0;
+    while (i < line.length() &&
+           !std::isdigit(static_cast<unsigned char>(line[i]))) {
+        ++i;
+    }
+    if (i == line.length()) {
+        return NO_NUMBER;
+    }
+    bool negative = i > 0 && line[i - 1] == '-';
+    long long number = 0;
+    for (; i < line.length() &&
+           std::isdigit(static_cast<unsigned char>(line[i]));
+         ++i) {
+        int digit = line[i] - '0';
+        // Numbers that are too large are all equal
+        number = number > (LLONG_MAX - digit) / 10 ? LLONG_MAX
+                                                   : number * 10 + digit;
+    }
+    return negative ? -number : number;
+}
+
+int compare_ignore_case(const std::string &a, const std::string &b) {
+    std::size_t length = std::min(a.length(), b.length());
+    for (std::size_t i = 0; i < length; ++i) {
+        int a_char = std::tolower(static_cast<unsigned char>(a[i]));
+        int b_char = std::tolower(static_cast<unsigned char>(b[i]));
+        if (a_char != b_char) {
+            return a_char < b_char ? -1 : 1;
+        }
+    }
+    return a.length() < b.length() ? -1 : (a.length() > b.length() ? 1 : 0);
+}
+
+// Orders rows by their lines, rows are compared instead of copies of the lines
+class LineOrder {
+   public:
+    LineOrder(const std::vector<std::string> &lines,
+              const std::vector<long long> &numbers, int first,
+              const Sort &sort)
+        : lines_(lines), numbers_(numbers), first_(first), sort_(sort) {}
+
+    int compare(int a, int b) const {
+        if (sort_.numeric) {
+            long long a_number = numbers_[a - first_];
+            long long b_number = numbers_[b - first_];
+            return a_number < b_number ? -1 : (a_number > b_number ? 1 : 0);
+        }
+        if (sort_.ignore_case) {
+            return compare_ignore_case(lines_[a], lines_[b]);
+        }
+        return lines_[a].compare(lines_[b]);
+    }
+
+    bool operator()(int a, int b) const {
+        return sort_.reverse ? compare(b, a) < 0 : compare(a, b) < 0;
+    }
+
+   private:
+    const std::vector<std::string> &lines_;
+    const std::vector<long long> &numbers_;
+    int first_;
+    const Sort &sort_;
+};
+
+void run_chunks(ThreadPool *pool, int chunk_count,
+                const std::function<void(int)> &run) {
+    if (pool == nullptr) {
+        for (int chunk = 0; chunk < chunk_count; ++chunk) {
+            run(chunk);
+        }
+        return;
+    }
+    std::atomic<int> next_chunk(0);
+    for (int i = 0; i < pool->get_thread_count(); ++i) {
+        pool->submit([&] {
+            for (int chunk = next_chunk++; chunk < chunk_count;
+                 chunk = next_chunk++) {
+                run(chunk);
+            }
+        });
+    }
+    pool->wait();
+}
+
+int split_runs(const int *a, int a_count, const int *b, int b_count, int k,
+               const LineOrder &order) {
+    // Number of rows of a among the first k rows of the merge of a and b,
+    // where rows of a come first when they are equal
+    int low = std::max(0, k - b_count);
+    int high = std::min(k, a_count);
+    while (low < high) {
+        int i = low + (high - low) / 2;
+        int j = k - i;
+        if (j > 0 && !order(b[j - 1], a[i])) {
+            // a[i] comes before b[j - 1]
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+}  // namespace
+
+Sort::Sort()
+    : numeric(false), unique(false), reverse(false), ignore_case(false) {}
+
+bool parse_sort(const std::string &arg, Sort &sort) {
+    sort = Sort();
+    for (char c : arg) {
+        if (c == 'n') {
+            sort.numeric = true;
+        } else if (c == 'u') {
+            sort.unique = true;
+        } else if (c == 'r') {
+            sort.reverse = true;
+        } else if (c == 'i') {
+            sort.ignore_case = true;
+        } else if (c != ' ') {
+            return false;
+        }
+    }
+    return true;
+}
+
+SortJob::SortJob(const std::vector<std::string> &lines, int first, int last,
+                 const Sort &sort, ThreadPool *pool)
+    : lines_(lines),
+      first_(first),
+      count_(last - first + 1),
+      sort_(sort),
+      // A single chunk is sorted without the overhead of the pool
+      pool_(last - first + 1 > SORT_CHUNK_LINES ? pool : nullptr),
+      rows_(count_),
+      numbers_(sort.numeric ? count_ : 0),
+      chunk_count_((count_ + SORT_CHUNK_LINES - 1) / SORT_CHUNK_LINES),
+      width_(0),
+      next_chunk_(0),
+      done_steps_(0),
+      total_steps_(chunk_count_),
+      finished_(false) {
+    std::iota(rows_.begin(), rows_.end(), first);
+    // Every merge pass goes over each chunk once
+    for (int width = SORT_CHUNK_LINES; width < count_; width *= 2) {
+        total_steps_ += chunk_count_;
+    }
+    if (chunk_count_ > 1) {
+        merged_.resize(count_);
+    }
+}
+
+bool SortJob::run_slice(Clock::time_point deadline) {
+    // Chunks are sorted and then merged pass by pass, a slice handles a
+    // batch of chunks per pool thread at a time
+    int batch = pool_ == nullptr ? 1 : pool_->get_thread_count();
+    while (!finished_) {
+        if (width_ >= count_) {
+            finish();
+            break;
+        }
+        int begin = next_chunk_;
+        int end = std::min(chunk_count_, begin + batch);
+        run_chunks(pool_, end - begin, [this, begin](int chunk) {
+            if (width_ == 0) {
+                sort_chunk(begin + chunk);
+            } else {
+                merge_chunk(begin + chunk);
+            }
+        });
+        done_steps_ += end - begin;
+        next_chunk_ = end;
+        if (next_chunk_ == chunk_count_) {
+            if (width_ > 0) {
+                rows_.swap(merged_);
+            }
+            width_ = width_ == 0 ? SORT_CHUNK_LINES : width_ * 2;
+            next_chunk_ = 0;
+        }
+        if (width_ < count_ && Clock::now() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double SortJob::get_progress() const {
+    return total_steps_ == 0 ? 1.0
+                             : static_cast<double>(done_steps_) /
+                                   static_cast<double>(total_steps_);
+}
+
+std::string SortJob::get_description() const { return "Sorting"; }
+
+std::vector<int> &SortJob::get_rows() { return rows_; }
+
+void SortJob::sort_chunk(int chunk) {
+    LineOrder order(lines_, numbers_, first_, sort_);
+    int begin = chunk * SORT_CHUNK_LINES;
+    int end = std::min(count_, begin + SORT_CHUNK_LINES);
+    for (int i = begin; sort_.numeric && i < end; ++i) {
+        numbers_[i] = get_number(lines_[first_ + i]);
+    }
+    std::stable_sort(rows_.begin() + begin, rows_.begin() + end, order);
+}
+
+void SortJob::merge_chunk(int chunk) {
+    // Runs are merged in pairs until one is left. Every chunk of the result
+    // is merged from the parts of the two runs that end up in it, so that
+    // the last merges also use the pool
+    LineOrder order(lines_, numbers_, first_, sort_);
+    int chunk_begin = chunk * SORT_CHUNK_LINES;
+    int chunk_end = std::min(count_, chunk_begin + SORT_CHUNK_LINES);
+    int begin = chunk_begin / (2 * width_) * (2 * width_);
+    int middle = std::min(count_, begin + width_);
+    int end = std::min(count_, begin + 2 * width_);
+    const int *a = rows_.data() + begin;
+    const int *b = rows_.data() + middle;
+    int a_first = split_runs(a, middle - begin, b, end - middle,
+                             chunk_begin - begin, order);
+    int a_last = split_runs(a, middle - begin, b, end - middle,
+                            chunk_end - begin, order);
+    std::merge(a + a_first, a + a_last, b + (chunk_begin - begin - a_first),
+               b + (chunk_end - begin - a_last), merged_.begin() + chunk_begin,
+               order);
+}
+
+void SortJob::finish() {
+    if (sort_.unique) {
+        // Equal lines are next to each other after the stable sort, and the
+        // first of them is the first in the buffer
+        LineOrder order(lines_, numbers_, first_, sort_);
+        rows_.erase(std::unique(rows_.begin(), rows_.end(),
+                                [&order](int a, int b) {
+                                    return order.compare(a, b) == 0;
+                                }),
+                    rows_.end());
+    }
+    finished_ = true;
+}
+
+std::vector<int> sort_lines(const std::vector<std::string> &lines, int first,
+                            int last, const Sort &sort, ThreadPool *pool) {
+    SortJob job(lines, first, last, sort, pool);
+    while (!job.run_slice(Job::Clock::time_point::max())) {
+    }
+    return std::move(job.get_rows());
+}
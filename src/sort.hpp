@@ -0,0 +1,68 @@
+#ifndef CLADITOR_SORT_HPP
+#define CLADITOR_SORT_HPP
+
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+#include "thread_pool.hpp"
+
+// Flags of the sort command
+struct Sort {
+    Sort();
+
+    // Order by the first decimal number in each line, lines without one come
+    // first
+    bool numeric;
+    // Keep only the first of lines that compare equal
+    bool unique;
+    bool reverse;
+    bool ignore_case;
+};
+
+// Parse flags such as "n u" or "nu", returns false for any other character
+bool parse_sort(const std::string &, Sort &);
+// Return the rows from first to last inclusive in sorted order, without the
+// rows that unique drops. Equal lines keep their order. Chunks of rows are
+// sorted and merged on the pool if it is given
+std::vector<int> sort_lines(const std::vector<std::string> &, int, int,
+                            const Sort &, ThreadPool *);
+
+// Sorts rows as sort_lines does in slices, so that a sort of many lines can be
+// cancelled. Chunks of rows are sorted and then merged pass by pass
+class SortJob : public Job {
+   public:
+    // Lines must not change while the job is running
+    SortJob(const std::vector<std::string> &, int, int, const Sort &,
+            ThreadPool *);
+
+    bool run_slice(Clock::time_point) override;
+    double get_progress() const override;
+    std::string get_description() const override;
+    // Rows in sorted order once the job has finished
+    std::vector<int> &get_rows();
+
+   private:
+    const std::vector<std::string> &lines_;
+    int first_;
+    int count_;
+    Sort sort_;
+    ThreadPool *pool_;
+    std::vector<int> rows_;
+    std::vector<int> merged_;
+    // Numbers of the lines for a numeric sort
+    std::vector<long long> numbers_;
+    int chunk_count_;
+    // Length of the sorted runs, zero until the chunks are sorted
+    int width_;
+    int next_chunk_;
+    int done_steps_;
+    int total_steps_;
+    bool finished_;
+
+    void sort_chunk(int);
+    void merge_chunk(int);
+    void finish();
+};
+
+#endif
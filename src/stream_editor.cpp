@@ -0,0 +1,251 @@
+#include "stream_editor.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "command.hpp"
+#include "substitution.hpp"
+
+namespace {
+// Size of the buffers used to read and write files
+const std::size_t STREAM_BUFFER_SIZE = 1 << 16;
+
+bool is_in_range(const LineRange &range, std::int64_t line, bool is_last) {
+    if (range.start == LineRange::LAST_LINE) {
+        return is_last;
+    }
+    return line >= range.start &&
+           (range.end == LineRange::LAST_LINE || line <= range.end);
+}
+
+bool is_append_target(const LineRange &range, std::int64_t line,
+                      bool is_last) {
+    return range.end == LineRange::LAST_LINE ? is_last : line == range.end;
+}
+}  // namespace
+
+StreamEditor::Stage::Stage(const Command &command)
+    : command(command), line_count(0), match_count(0), has_pending(false) {}
+
+StreamEditor::StreamEditor() : has_output_(false), trailing_newline_(true) {}
+
+bool StreamEditor::set_commands(const std::string &commands) {
+    stages_.clear();
+    for (const Command &c : get_command(commands)) {
+        switch (c.type) {
+            case CommandType::DELETE:
+            case CommandType::SUBSTITUTE:
+            case CommandType::APPEND:
+                break;
+            case CommandType::ERROR_INVALID_COMMAND:
+                error_ = "Not an editor command: " + c.content;
+                return false;
+            case CommandType::ERROR_TRAILING_CHARACTERS:
+                error_ = "Trailing characters";
+                return false;
+            case CommandType::ERROR_NO_RANGE_ALLOWED:
+                error_ = "No range allowed";
+                return false;
+            default:
+                error_ = "Cannot stream command: " + c.content;
+                return false;
+        }
+        if (c.range.start == LineRange::CURRENT_LINE) {
+            error_ = "Range required when streaming: " + c.content;
+            return false;
+        }
+        if (!c.range.is_absolute()) {
+            // Lines are only known by number while streaming
+            error_ = "Cannot stream range: " + c.content;
+            return false;
+        }
+        if (c.range.start == 0 && c.type != CommandType::APPEND) {
+            error_ = "Invalid range";
+            return false;
+        }
+        stages_.emplace_back(c);
+        if (c.type == CommandType::SUBSTITUTE &&
+            !parse_substitution(c.arg, stages_.back().substitution)) {
+            error_ = "Invalid substitute pattern: " + c.arg;
+            return false;
+        }
+        if (c.type == CommandType::SUBSTITUTE &&
+            stages_.back().substitution.confirm) {
+            error_ = "Cannot confirm substitutions when streaming";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamEditor::run(std::istream &input, std::ostream &output) {
+    reset();
+    std::string line;
+    while (std::getline(input, line)) {
+        // getline only reaches the end of the input when the last line has
+        // no newline
+        trailing_newline_ = !input.eof();
+        push(0, std::move(line), output);
+    }
+    finish(0, output);
+    return check_stages();
+}
+
+bool StreamEditor::edit_file(const std::string &file_path) {
+    std::vector<char> input_buffer(STREAM_BUFFER_SIZE);
+    std::ifstream input;
+    input.rdbuf()->pubsetbuf(input_buffer.data(), input_buffer.size());
+    input.open(file_path, std::ios::in | std::ios::binary);
+    if (!input) {
+        error_ = "Cannot open file: " + file_path;
+        return false;
+    }
+    // Create the temporary file next to the file so that it can be renamed
+    std::string temporary_path = file_path + ".XXXXXX";
+    int fd = mkstemp(&temporary_path[0]);
+    if (fd == -1) {
+        error_ = "Cannot create temporary file for " + file_path;
+        return false;
+    }
+    struct stat file_stat;
+    if (stat(file_path.c_str(), &file_stat) == 0) {
+        fchmod(fd, file_stat.st_mode & 07777);
+    }
+    close(fd);
+
+    std::vector<char> output_buffer(STREAM_BUFFER_SIZE);
+    std::ofstream output;
+    output.rdbuf()->pubsetbuf(output_buffer.data(), output_buffer.size());
+    output.open(temporary_path,
+                std::ios::out | std::ios::binary | std::ios::trunc);
+    bool success = run(input, output);
+    output.close();
+    if (!success) {
+        // A command that failed leaves the file as it was
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    if (!output || input.bad() ||
+        std::rename(temporary_path.c_str(), file_path.c_str()) != 0) {
+        unlink(temporary_path.c_str());
+        error_ = "Cannot write file: " + file_path;
+        return false;
+    }
+    return true;
+}
+
+const std::string &StreamEditor::get_error() const { return error_; }
+
+void StreamEditor::reset() {
+    error_.clear();
+    has_output_ = false;
+    trailing_newline_ = true;
+    for (Stage &stage : stages_) {
+        stage.line_count = 0;
+        stage.match_count = 0;
+        stage.has_pending = false;
+        stage.pending.clear();
+    }
+}
+
+void StreamEditor::push(std::size_t index, std::string &&line,
+                        std::ostream &output) {
+    if (index == stages_.size()) {
+        if (has_output_) {
+            output << '\n';
+        }
+        output << line;
+        has_output_ = true;
+        return;
+    }
+    Stage &stage = stages_[index];
+    if (stage.has_pending) {
+        process(index, false, output);
+    }
+    stage.pending = std::move(line);
+    stage.has_pending = true;
+}
+
+void StreamEditor::process(std::size_t index, bool is_last,
+                           std::ostream &output) {
+    // Apply the command of a stage to its pending line
+    Stage &stage = stages_[index];
+    std::int64_t line_number = ++stage.line_count;
+    std::string line = std::move(stage.pending);
+    stage.has_pending = false;
+    const LineRange &range = stage.command.range;
+    switch (stage.command.type) {
+        case CommandType::DELETE:
+            if (is_in_range(range, line_number, is_last)) {
+                return;
+            }
+            break;
+        case CommandType::SUBSTITUTE:
+            if (is_in_range(range, line_number, is_last)) {
+                stage.match_count += substitute(line, stage.substitution);
+            }
+            break;
+        case CommandType::APPEND:
+            if (line_number == 1 && range.end == 0) {
+                push(index + 1, std::string(stage.command.arg), output);
+            }
+            if (is_append_target(range, line_number, is_last)) {
+                push(index + 1, std::move(line), output);
+                push(index + 1, std::string(stage.command.arg), output);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+    push(index + 1, std::move(line), output);
+}
+
+void StreamEditor::finish(std::size_t index, std::ostream &output) {
+    if (index == stages_.size()) {
+        if (has_output_ && trailing_newline_) {
+            output << '\n';
+        }
+        output.flush();
+        return;
+    }
+    Stage &stage = stages_[index];
+    if (stage.has_pending) {
+        process(index, true, output);
+    } else if (stage.command.type == CommandType::APPEND &&
+               (stage.command.range.end == 0 ||
+                stage.command.range.end == LineRange::LAST_LINE)) {
+        // Appending to empty input
+        push(index + 1, std::string(stage.command.arg), output);
+    }
+    finish(index + 1, output);
+}
+
+bool StreamEditor::check_stages() {
+    // Report the first command that could not be applied
+    for (const Stage &stage : stages_) {
+        const LineRange &range = stage.command.range;
+        std::int64_t last_line =
+            range.end == LineRange::LAST_LINE ? range.start : range.end;
+        if (last_line > stage.line_count) {
+            error_ = "Invalid range";
+            return false;
+        }
+        if (stage.command.type == CommandType::SUBSTITUTE &&
+            stage.match_count == 0) {
+            error_ = "Pattern not found: " + stage.substitution.pattern;
+            return false;
+        }
+    }
+    return true;
+}
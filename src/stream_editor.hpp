@@ -0,0 +1,57 @@
+#ifndef CLADITOR_STREAM_EDITOR_HPP
+#define CLADITOR_STREAM_EDITOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "command.hpp"
+#include "substitution.hpp"
+
+// Applies line addressed commands to lines as they are read so that input of
+// any size is edited with constant memory
+class StreamEditor {
+   public:
+    StreamEditor();
+    // Returns false and sets the error if a command cannot be streamed
+    bool set_commands(const std::string &);
+    // Returns false and sets the error if a command failed
+    bool run(std::istream &, std::ostream &);
+    // Write the result to a temporary file that then replaces the file
+    bool edit_file(const std::string &);
+    const std::string &get_error() const;
+
+   private:
+    // Every command numbers the lines produced by the previous command, so
+    // line numbers refer to the same lines as when the commands are run one
+    // after another on the whole file
+    struct Stage {
+        explicit Stage(const Command &);
+
+        Command command;
+        Substitution substitution;
+        // 64 bit since files of many gigabytes can have more than 2^31 lines
+        std::int64_t line_count;
+        std::int64_t match_count;
+        // One line of lookahead is needed to know whether a line is the last
+        bool has_pending;
+        std::string pending;
+    };
+
+    std::vector<Stage> stages_;
+    std::string error_;
+    // Newlines are written before every line but the first so that input
+    // without a newline after its last line is reproduced as it was
+    bool has_output_;
+    bool trailing_newline_;
+
+    void reset();
+    void push(std::size_t, std::string &&, std::ostream &);
+    void process(std::size_t, bool, std::ostream &);
+    void finish(std::size_t, std::ostream &);
+    bool check_stages();
+};
+#endif
@@ -0,0 +1,201 @@
+#include "substitution.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// Lines substituted by a task of a parallel substitution before it takes
+// another chunk
+const int SUBSTITUTE_CHUNK_LINES = 16384;
+
+void substitute_chunk(std::vector<std::string> &lines, int first, int last,
+                      Substitution &substitution, std::vector<int> &changed,
+                      int &match_count) {
+    // The result is built in a string kept for the whole chunk and copied
+    // into the line, which only allocates if the line has to grow
+    std::string result;
+    for (int i = first; i <= last; ++i) {
+        int count = substitute(lines[i], substitution, result);
+        if (count > 0) {
+            match_count += count;
+            lines[i].assign(result);
+            changed.push_back(i);
+        }
+    }
+}
+}  // namespace
+
+std::string::size_type read_delimited_part(const std::string &str,
+                                           std::string::size_type position,
+                                           char delimiter, std::string &part) {
+    // Read until an unescaped delimiter and return the position after it
+    while (position < str.length() && str[position] != delimiter) {
+        if (str[position] == '\\' && position + 1 < str.length() &&
+            str[position + 1] == delimiter) {
+            // Escaped delimiter
+            ++position;
+        }
+        part += str[position];
+        ++position;
+    }
+    return position < str.length() ? position + 1 : position;
+}
+
+Substitution::Substitution()
+    : global(false), confirm(false), ignore_case(false) {}
+
+bool parse_substitution(const std::string &arg, Substitution &substitution) {
+    if (arg.empty()) {
+        return false;
+    }
+    char delimiter = arg[0];
+    substitution = Substitution();
+    std::string::size_type position =
+        read_delimited_part(arg, 1, delimiter, substitution.pattern);
+    position =
+        read_delimited_part(arg, position, delimiter, substitution.replacement);
+    for (; position < arg.length(); ++position) {
+        if (arg[position] == 'g') {
+            substitution.global = true;
+        } else if (arg[position] == 'c') {
+            substitution.confirm = true;
+        } else if (arg[position] == 'i') {
+            substitution.ignore_case = true;
+        } else {
+            return false;
+        }
+    }
+    return !substitution.pattern.empty() &&
+           substitution.search_pattern.set(substitution.pattern,
+                                           substitution.ignore_case);
+}
+
+void append_replacement(std::string &result, const Substitution &substitution,
+                        const std::string &line, std::size_t start,
+                        std::size_t end) {
+    const std::string &replacement = substitution.replacement;
+    for (std::string::size_type i = 0; i < replacement.length(); ++i) {
+        if (replacement[i] == '&') {
+            result.append(line, start, end - start);
+        } else if (replacement[i] == '\\' && i + 1 < replacement.length()) {
+            ++i;
+            if (replacement[i] == '0') {
+                result.append(line, start, end - start);
+            } else {
+                result += replacement[i];
+            }
+        } else {
+            result += replacement[i];
+        }
+    }
+}
+
+int substitute(const std::string &line, Substitution &substitution,
+               std::string &result) {
+    // Build the result in one pass instead of replacing in place
+    if (substitution.search_pattern.get_source() != substitution.pattern) {
+        // The pattern was set without parse_substitution
+        substitution.search_pattern.set(substitution.pattern,
+                                        substitution.ignore_case);
+    }
+    std::size_t start = 0;
+    std::size_t end = 0;
+    if (!substitution.search_pattern.find(line, 0, start, end)) {
+        return 0;
+    }
+    std::vector<MatchRange> matches;
+    if (substitution.global) {
+        // Every match comes from one scan of the line, finding them one at
+        // a time would scan the rest of the line again for each of them
+        substitution.search_pattern.find_all(line, std::string::npos,
+                                             matches);
+    } else {
+        matches.emplace_back(start, end);
+    }
+    int count = 0;
+    // Characters of the line before this index are in the result
+    std::size_t copied = 0;
+    std::size_t previous_end = std::string::npos;
+    for (const MatchRange &match : matches) {
+        if (match.first == match.second && match.first == previous_end) {
+            // An empty match directly after a match is not replaced
+            continue;
+        }
+        if (count == 0) {
+            result.clear();
+            result.reserve(line.length() + substitution.replacement.length());
+        }
+        result.append(line, copied, match.first - copied);
+        append_replacement(result, substitution, line, match.first,
+                           match.second);
+        ++count;
+        copied = match.second;
+        previous_end = match.second;
+    }
+    result.append(line, copied, std::string::npos);
+    return count;
+}
+
+int substitute(std::string &line, Substitution &substitution) {
+    std::string result;
+    int count = substitute(line, substitution, result);
+    if (count > 0) {
+        line = std::move(result);
+    }
+    return count;
+}
+
+std::vector<int> substitute_lines(std::vector<std::string> &lines, int first,
+                                  int last, const Substitution &substitution,
+                                  ThreadPool *pool, int &match_count) {
+    match_count = 0;
+    std::vector<int> changed;
+    if (pool == nullptr || last - first < SUBSTITUTE_CHUNK_LINES) {
+        Substitution task_substitution = substitution;
+        substitute_chunk(lines, first, last, task_substitution, changed,
+                         match_count);
+        return changed;
+    }
+    // Chunks only change their own lines and keep their own changed rows so
+    // that they can be joined in order
+    int chunk_count = (last - first + SUBSTITUTE_CHUNK_LINES) /
+                      SUBSTITUTE_CHUNK_LINES;
+    std::vector<std::vector<int>> chunk_changes(chunk_count);
+    std::vector<int> chunk_matches(chunk_count, 0);
+    std::atomic<int> next_chunk(0);
+    for (int i = 0; i < pool->get_thread_count(); ++i) {
+        pool->submit([&] {
+            // Patterns build their automaton while matching, so every task
+            // has its own copy
+            Substitution task_substitution = substitution;
+            for (int chunk = next_chunk++; chunk < chunk_count;
+                 chunk = next_chunk++) {
+                int chunk_first = first + chunk * SUBSTITUTE_CHUNK_LINES;
+                int chunk_last =
+                    std::min(last, chunk_first + SUBSTITUTE_CHUNK_LINES - 1);
+                substitute_chunk(lines, chunk_first, chunk_last,
+                                 task_substitution, chunk_changes[chunk],
+                                 chunk_matches[chunk]);
+            }
+        });
+    }
+    pool->wait();
+    std::size_t changed_count = 0;
+    for (const std::vector<int> &chunk : chunk_changes) {
+        changed_count += chunk.size();
+    }
+    changed.reserve(changed_count);
+    for (int chunk = 0; chunk < chunk_count; ++chunk) {
+        changed.insert(changed.end(), chunk_changes[chunk].begin(),
+                       chunk_changes[chunk].end());
+        match_count += chunk_matches[chunk];
+    }
+    return changed;
+}
@@ -0,0 +1,51 @@
+#ifndef CLADITOR_SUBSTITUTION_HPP
+#define CLADITOR_SUBSTITUTION_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+// Argument of the substitute command
+struct Substitution {
+    Substitution();
+
+    std::string pattern;
+    // & and \0 insert the match, \ escapes the next character
+    std::string replacement;
+    // Replace every match in a line instead of only the first
+    bool global;
+    // Ask before replacing each match
+    bool confirm;
+    bool ignore_case;
+    // Pattern compiled by parse_substitution
+    SearchPattern search_pattern;
+};
+
+// Read the part of str from the position until an unescaped delimiter into
+// part and return the position after the delimiter
+std::string::size_type read_delimited_part(const std::string &,
+                                           std::string::size_type, char,
+                                           std::string &);
+// Parse "/pattern/replacement/flags" where the first character is the
+// delimiter and the flags are any of g, c and i, returns false if the
+// argument or the pattern is invalid
+bool parse_substitution(const std::string &, Substitution &);
+// Append the replacement of the match from start to end in the line
+void append_replacement(std::string &, const Substitution &,
+                        const std::string &, std::size_t, std::size_t);
+// Write the line with its matches replaced to the result and return the
+// number of matches, the result is only written if there is a match
+int substitute(const std::string &, Substitution &, std::string &);
+// Replace matches of the pattern in line and return the number of matches
+int substitute(std::string &, Substitution &);
+// Substitute in the lines from first to last inclusive, in chunks on the pool
+// if it is given and there is more than one chunk, and return the changed
+// lines in order. A line allocates at most once, when its result is longer
+// than its capacity
+std::vector<int> substitute_lines(std::vector<std::string> &, int, int,
+                                  const Substitution &, ThreadPool *, int &);
+
+#endif
@@ -0,0 +1,122 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+// Pool and queue owned by the current thread if it is a worker
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local int current_queue = -1;
+}  // namespace
+
+ThreadPool::ThreadPool(int thread_count)
+    : queued_(0), pending_(0), stopping_(false), next_queue_(0) {
+    thread_count = std::max(1, thread_count);
+    for (int i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (std::thread &thread : threads_) {
+        thread.join();
+    }
+}
+
+int ThreadPool::get_default_thread_count() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+int ThreadPool::get_thread_count() const {
+    return static_cast<int>(threads_.size());
+}
+
+void ThreadPool::submit(Task task) {
+    // Tasks submitted by a worker stay on its own queue, others are spread
+    // across all queues
+    int index = current_pool == this
+                    ? current_queue
+                    : static_cast<int>(next_queue_++ % queues_.size());
+    {
+        // Count the task before it becomes visible, otherwise another worker
+        // could steal and finish it first and let wait() return while the
+        // submitting task is still running
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++queued_;
+        ++pending_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    work_available_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool ThreadPool::pop_task(int index, Task &task) {
+    // Take the newest task of the own queue, otherwise steal the oldest task
+    // of another queue
+    int queue_count = static_cast<int>(queues_.size());
+    for (int i = 0; i < queue_count; ++i) {
+        Queue &queue = *queues_[(index + i) % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(int index) {
+    current_pool = this;
+    current_queue = index;
+    while (true) {
+        Task task;
+        if (pop_task(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --queued_;
+            }
+            task();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) {
+                work_done_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_available_.wait(lock,
+                             [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ <= 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef CLADITOR_THREAD_POOL_HPP
+#define CLADITOR_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool where every worker owns a queue of tasks and steals from
+// the other queues once its own queue is empty
+class ThreadPool {
+   public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(int);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    static int get_default_thread_count();
+    int get_thread_count() const;
+    void submit(Task);
+    // Block until every submitted task has finished, must not be called from
+    // a task
+    void wait();
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable work_done_;
+    // Tasks that have been submitted but not taken from a queue
+    int queued_;
+    // Tasks that have been submitted but not finished
+    int pending_;
+    bool stopping_;
+    std::atomic<unsigned int> next_queue_;
+
+    bool pop_task(int, Task &);
+    void worker_loop(int);
+};
+#endif
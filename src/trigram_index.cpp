@@ -0,0 +1,382 @@
+#include "trigram_index.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "job.hpp"
+
+namespace {
+const char MAGIC[] = "CLADTRI1";
+// Multiplicative hash of a trigram keeps its top bits, as many as there are
+// bits in a signature
+const int HASH_SHIFT = 20;
+
+std::uint32_t hash_trigram(unsigned char a, unsigned char b, unsigned char c) {
+    std::uint32_t trigram = (static_cast<std::uint32_t>(a) << 16) |
+                            (static_cast<std::uint32_t>(b) << 8) | c;
+    return (trigram * 2654435761U) >> HASH_SHIFT;
+}
+
+struct SourceState {
+    std::int64_t size;
+    std::int64_t modification_time;
+};
+
+bool get_source_state(const std::string &path, SourceState &state) {
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0) {
+        return false;
+    }
+    state.size = static_cast<std::int64_t>(file_stat.st_size);
+    state.modification_time =
+        static_cast<std::int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 +
+        file_stat.st_mtim.tv_nsec;
+    return true;
+}
+
+template <typename T>
+void write_value(std::ofstream &stream, const T &value) {
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read_value(std::ifstream &stream, T &value) {
+    return static_cast<bool>(
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+}  // namespace
+
+TrigramIndex::TrigramIndex()
+    : line_count_(0), pending_lines_(0), block_bytes_(BLOCK_BYTES) {}
+
+void TrigramIndex::reset(const std::vector<std::string> &lines) {
+    blocks_ = std::vector<Block>();
+    starts_ = std::vector<int>();
+    line_count_ = static_cast<int>(lines.size());
+    pending_lines_ = line_count_;
+    // Larger blocks keep the signatures of huge buffers within the limit
+    std::size_t bytes = 0;
+    for (const std::string &line : lines) {
+        bytes += line.length() + 1;
+    }
+    std::size_t max_blocks = MAX_MEMORY / (sizeof(Block) + sizeof(int));
+    block_bytes_ = bytes / max_blocks > BLOCK_BYTES ? bytes / max_blocks
+                                                    : BLOCK_BYTES;
+    blocks_.reserve(bytes / block_bytes_ + 1);
+    starts_.reserve(blocks_.capacity());
+}
+
+bool TrigramIndex::build(const std::vector<std::string> &lines,
+                         Job::Clock::time_point deadline) {
+    while (pending_lines_ > 0) {
+        blocks_.push_back(make_block(lines, get_indexed_lines(), line_count_));
+        pending_lines_ -= blocks_.back().line_count;
+        update_starts(blocks_.size() - 1);
+        if (pending_lines_ > 0 && Job::Clock::now() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TrigramIndex::is_complete() const { return pending_lines_ == 0; }
+
+double TrigramIndex::get_progress() const {
+    return line_count_ == 0 ? 1.0
+                            : 1.0 - static_cast<double>(pending_lines_) /
+                                        static_cast<double>(line_count_);
+}
+
+std::size_t TrigramIndex::get_memory_usage() const {
+    return blocks_.capacity() * sizeof(Block) +
+           starts_.capacity() * sizeof(int);
+}
+
+void TrigramIndex::change_line(const std::vector<std::string> &lines,
+                               int row) {
+    if (row < get_indexed_lines()) {
+        add_line(blocks_[find_block(row)].signature, lines[row]);
+    }
+}
+
+void TrigramIndex::insert_lines(const std::vector<std::string> &lines,
+                                int row, int count) {
+    int indexed = get_indexed_lines();
+    line_count_ += count;
+    if (row > indexed || (row == indexed && pending_lines_ > 0) ||
+        blocks_.empty()) {
+        pending_lines_ += count;
+        return;
+    }
+    // Lines appended after the last block join it
+    std::size_t block = row == indexed ? blocks_.size() - 1 : find_block(row);
+    blocks_[block].line_count += count;
+    std::size_t bytes = 0;
+    for (int i = row; i < row + count; ++i) {
+        add_line(blocks_[block].signature, lines[i]);
+        bytes += lines[i].length() + 1;
+    }
+    if (bytes >= block_bytes_) {
+        // Split the block so that large insertions are not in a single block
+        // that no search can skip
+        int end = starts_[block] + blocks_[block].line_count;
+        std::vector<Block> split;
+        for (int line = starts_[block]; line < end;
+             line += split.back().line_count) {
+            split.push_back(make_block(lines, line, end));
+        }
+        blocks_.erase(blocks_.begin() + block);
+        blocks_.insert(blocks_.begin() + block, split.begin(), split.end());
+    }
+    update_starts(block);
+}
+
+void TrigramIndex::remove_lines(int first, int count) {
+    int indexed = get_indexed_lines();
+    line_count_ -= count;
+    if (first + count > indexed) {
+        int pending_count = first + count - std::max(first, indexed);
+        pending_lines_ -= pending_count;
+        count -= pending_count;
+    }
+    if (count == 0) {
+        return;
+    }
+    std::size_t block = find_block(first);
+    int offset = first - starts_[block];
+    std::size_t last = block;
+    for (; count > 0; ++last) {
+        int removed = std::min(count, blocks_[last].line_count - offset);
+        blocks_[last].line_count -= removed;
+        count -= removed;
+        offset = 0;
+    }
+    blocks_.erase(std::remove_if(blocks_.begin() + block,
+                                 blocks_.begin() + last,
+                                 [](const Block &removed_block) {
+                                     return removed_block.line_count == 0;
+                                 }),
+                  blocks_.begin() + last);
+    update_starts(block);
+}
+
+void TrigramIndex::remove_lines(const std::vector<int> &rows) {
+    int indexed = get_indexed_lines();
+    std::size_t block = 0;
+    for (int row : rows) {
+        if (row >= indexed) {
+            --pending_lines_;
+            continue;
+        }
+        // Starts are only updated once every line is removed
+        while (block + 1 < blocks_.size() && starts_[block + 1] <= row) {
+            ++block;
+        }
+        --blocks_[block].line_count;
+    }
+    line_count_ -= static_cast<int>(rows.size());
+    blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end(),
+                                 [](const Block &removed_block) {
+                                     return removed_block.line_count == 0;
+                                 }),
+                  blocks_.end());
+    update_starts(0);
+}
+
+void TrigramIndex::on_change(const std::vector<std::string> &lines,
+                             const BufferChange &change) {
+    if (change.first == 0 && change.removed == line_count_ &&
+        change.removed != change.inserted) {
+        // Every line was replaced
+        reset(lines);
+        return;
+    }
+    if (change.rows != nullptr) {
+        if (change.removed != change.inserted) {
+            remove_lines(*change.rows);
+            return;
+        }
+        for (int row : *change.rows) {
+            change_line(lines, row);
+        }
+        return;
+    }
+    int kept = std::min(change.removed, change.inserted);
+    for (int row = change.first; row < change.first + kept; ++row) {
+        change_line(lines, row);
+    }
+    if (change.removed > kept) {
+        remove_lines(change.first + kept, change.removed - kept);
+    } else if (change.inserted > kept) {
+        insert_lines(lines, change.first + kept, change.inserted - kept);
+    }
+}
+
+TrigramQuery TrigramIndex::get_query(const std::vector<std::string> &literals) {
+    TrigramQuery query;
+    for (const std::string &literal : literals) {
+        for (std::size_t i = 0; i + 2 < literal.length(); ++i) {
+            query.push_back(hash_trigram(literal[i], literal[i + 1],
+                                         literal[i + 2]));
+        }
+    }
+    std::sort(query.begin(), query.end());
+    query.erase(std::unique(query.begin(), query.end()), query.end());
+    return query;
+}
+
+bool TrigramIndex::may_match(const TrigramQuery &query, int line,
+                             bool forward, int &run) const {
+    int indexed = get_indexed_lines();
+    if (query.empty() || line >= indexed) {
+        // Lines that are not indexed may always match
+        int start = query.empty() ? 0 : indexed;
+        run = forward ? line_count_ - line : line - start + 1;
+        return true;
+    }
+    std::size_t block = find_block(line);
+    run = forward ? starts_[block] + blocks_[block].line_count - line
+                  : line - starts_[block] + 1;
+    const Signature &signature = blocks_[block].signature;
+    for (std::uint32_t bit : query) {
+        if ((signature[bit / 64] & (std::uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TrigramIndex::save(const std::string &path,
+                        const std::string &source_path) const {
+    SourceState source;
+    if (!is_complete() || !get_source_state(source_path, source)) {
+        return false;
+    }
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream.write(MAGIC, sizeof(MAGIC) - 1);
+    write_value(stream, source.size);
+    write_value(stream, source.modification_time);
+    write_value(stream, static_cast<std::int64_t>(line_count_));
+    write_value(stream, static_cast<std::uint64_t>(block_bytes_));
+    write_value(stream, static_cast<std::uint64_t>(blocks_.size()));
+    for (const Block &block : blocks_) {
+        write_value(stream, static_cast<std::int32_t>(block.line_count));
+        write_value(stream, block.signature);
+    }
+    return static_cast<bool>(stream);
+}
+
+bool TrigramIndex::load(const std::string &path,
+                        const std::string &source_path,
+                        const std::vector<std::string> &lines) {
+    // The index is only valid for the file as it was when the index was saved
+    SourceState source;
+    if (!get_source_state(source_path, source)) {
+        return false;
+    }
+    std::ifstream stream(path, std::ios::binary);
+    char magic[sizeof(MAGIC) - 1];
+    SourceState saved_source;
+    std::int64_t line_count = 0;
+    std::uint64_t block_bytes = 0;
+    std::uint64_t block_count = 0;
+    if (!stream.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, MAGIC, sizeof(magic)) != 0 ||
+        !read_value(stream, saved_source.size) ||
+        !read_value(stream, saved_source.modification_time) ||
+        !read_value(stream, line_count) || !read_value(stream, block_bytes) ||
+        !read_value(stream, block_count) || block_bytes < BLOCK_BYTES ||
+        saved_source.size != source.size ||
+        saved_source.modification_time != source.modification_time ||
+        line_count != static_cast<std::int64_t>(lines.size()) ||
+        block_count > lines.size()) {
+        return false;
+    }
+    std::vector<Block> blocks(block_count);
+    std::int64_t total = 0;
+    for (Block &block : blocks) {
+        std::int32_t block_line_count = 0;
+        if (!read_value(stream, block_line_count) ||
+            !read_value(stream, block.signature) || block_line_count <= 0) {
+            return false;
+        }
+        block.line_count = block_line_count;
+        total += block_line_count;
+    }
+    if (total != line_count) {
+        return false;
+    }
+    blocks_ = std::move(blocks);
+    line_count_ = static_cast<int>(line_count);
+    pending_lines_ = 0;
+    block_bytes_ = static_cast<std::size_t>(block_bytes);
+    update_starts(0);
+    return true;
+}
+
+std::string TrigramIndex::get_index_path(const std::string &path) {
+    std::string::size_type slash = path.rfind('/');
+    std::string::size_type name = slash == std::string::npos ? 0 : slash + 1;
+    return path.substr(0, name) + "." + path.substr(name) + ".trigrams";
+}
+
+int TrigramIndex::get_indexed_lines() const {
+    return line_count_ - pending_lines_;
+}
+
+std::size_t TrigramIndex::find_block(int line) const {
+    return static_cast<std::size_t>(
+               std::upper_bound(starts_.begin(), starts_.end(), line) -
+               starts_.begin()) -
+           1;
+}
+
+void TrigramIndex::update_starts(std::size_t first) {
+    starts_.resize(blocks_.size());
+    for (std::size_t i = first; i < blocks_.size(); ++i) {
+        starts_[i] = i == 0 ? 0 : starts_[i - 1] + blocks_[i - 1].line_count;
+    }
+}
+
+TrigramIndex::Block TrigramIndex::make_block(
+    const std::vector<std::string> &lines, int first, int end) const {
+    Block block{0, {}};
+    std::size_t bytes = 0;
+    for (int line = first; line < end && bytes < block_bytes_; ++line) {
+        add_line(block.signature, lines[line]);
+        bytes += lines[line].length() + 1;
+        ++block.line_count;
+    }
+    return block;
+}
+
+void TrigramIndex::add_line(Signature &signature, const std::string &line) {
+    for (std::size_t i = 0; i + 2 < line.length(); ++i) {
+        std::uint32_t bit = hash_trigram(line[i], line[i + 1], line[i + 2]);
+        signature[bit / 64] |= std::uint64_t(1) << (bit % 64);
+    }
+}
+
+TrigramIndexBuilder::TrigramIndexBuilder(TrigramIndex &index,
+                                         const std::vector<std::string> &lines)
+    : index_(index), lines_(lines) {}
+
+bool TrigramIndexBuilder::run_slice(Clock::time_point deadline) {
+    return index_.build(lines_, deadline);
+}
+
+double TrigramIndexBuilder::get_progress() const {
+    return index_.get_progress();
+}
+
+std::string TrigramIndexBuilder::get_description() const {
+    return "Indexing trigrams";
+}
@@ -0,0 +1,101 @@
+#ifndef CLADITOR_TRIGRAM_INDEX_HPP
+#define CLADITOR_TRIGRAM_INDEX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "job.hpp"
+
+// Bits of the signature of a block that a search needs to be set
+using TrigramQuery = std::vector<std::uint32_t>;
+
+// Index of the trigrams in blocks of lines, so that searches can skip blocks
+// that cannot contain a literal. Every block has a fixed size signature with a
+// bit set for the hash of each trigram in its lines, which bounds the memory
+// used. Edits only set bits, so a signature may have bits of removed text but
+// never misses text of the block
+class TrigramIndex : public BufferObserver {
+   public:
+    static const std::size_t SIGNATURE_BITS = 4096;
+    // Bytes of lines in a block unless the memory limit requires more
+    static const std::size_t BLOCK_BYTES = 2048;
+    static const std::size_t MAX_MEMORY = 64 << 20;
+
+    TrigramIndex();
+    // Start over with every line of the buffer waiting to be indexed
+    void reset(const std::vector<std::string> &);
+    // Index lines until the deadline, returns whether every line is indexed
+    bool build(const std::vector<std::string> &, Job::Clock::time_point);
+    bool is_complete() const;
+    double get_progress() const;
+    std::size_t get_memory_usage() const;
+
+    // Edits are given the lines after the edit
+    void change_line(const std::vector<std::string> &, int);
+    void insert_lines(const std::vector<std::string> &, int, int);
+    void remove_lines(int, int);
+    // Remove the given lines in increasing order, in one pass over the blocks
+    void remove_lines(const std::vector<int> &);
+    // Follow a change of the buffer with the edits above
+    void on_change(const std::vector<std::string> &,
+                   const BufferChange &) override;
+
+    // Every trigram of the literals, empty if no literal has one
+    static TrigramQuery get_query(const std::vector<std::string> &);
+    // Whether the block of a line may match the query, run is set to the
+    // number of lines from the line in the direction that have the same
+    // answer
+    bool may_match(const TrigramQuery &, int, bool, int &) const;
+
+    // Saved indexes are only loaded for the file they were saved with
+    bool save(const std::string &, const std::string &) const;
+    bool load(const std::string &, const std::string &,
+              const std::vector<std::string> &);
+    // Path of the index of a file, next to the file
+    static std::string get_index_path(const std::string &);
+
+   private:
+    using Signature = std::array<std::uint64_t, SIGNATURE_BITS / 64>;
+    struct Block {
+        int line_count;
+        Signature signature;
+    };
+
+    // Blocks that are indexed, lines after them are waiting to be indexed
+    std::vector<Block> blocks_;
+    // Index of the first line of each block
+    std::vector<int> starts_;
+    int line_count_;
+    int pending_lines_;
+    std::size_t block_bytes_;
+
+    int get_indexed_lines() const;
+    // Index of the block of an indexed line
+    std::size_t find_block(int) const;
+    // Recompute the starts of the blocks from a block on
+    void update_starts(std::size_t);
+    // Block of the lines from a line until block_bytes_ bytes or the end
+    // line
+    Block make_block(const std::vector<std::string> &, int, int) const;
+    static void add_line(Signature &, const std::string &);
+};
+
+// Builds a trigram index in slices
+class TrigramIndexBuilder : public Job {
+   public:
+    // Lines must only change while the index observes them
+    TrigramIndexBuilder(TrigramIndex &, const std::vector<std::string> &);
+
+    bool run_slice(Clock::time_point) override;
+    double get_progress() const override;
+    std::string get_description() const override;
+
+   private:
+    TrigramIndex &index_;
+    const std::vector<std::string> &lines_;
+};
+#endif
@@ -1,6 +1,7 @@
 #include "bind_count.hpp"
 
 #include <catch2/catch.hpp>
+#include <climits>
 
 TEST_CASE("Bind Count initial construction", "[bind_count]") {
     BindCount bind_count;
@@ -29,3 +30,12 @@ TEST_CASE("Bind Count add multiple digits", "[bind_count]") {
     int value = bind_count.get_value();
     REQUIRE(value == 10);
 }
+
+TEST_CASE("Bind Count saturates on overflow", "[bind_count]") {
+    BindCount bind_count;
+    for (int i = 0; i < 20; ++i) {
+        bind_count.add_digit(9);
+    }
+    int value = bind_count.get_value();
+    REQUIRE(value == INT_MAX);
+}
@@ -1,9 +1,15 @@
 #include "buffer.hpp"
 
 #include <catch2/catch.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
+#include "buffer_observer.hpp"
+#include "job.hpp"
 #include "position.hpp"
+#include "trigram_index.hpp"
 
 TEST_CASE("Buffer initial construction", "[buffer]") {
     // Buffer should be empty upon construction
@@ -16,21 +22,21 @@ TEST_CASE("Buffer initial construction", "[buffer]") {
 
 TEST_CASE("Buffer get line length of empty line", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {""};
+    buffer.set_lines({""});
     int length = buffer.get_line_length(0);
     REQUIRE(length == 0);
 }
 
 TEST_CASE("Buffer get line length", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foobar"};
+    buffer.set_lines({"foobar"});
     int length = buffer.get_line_length(0);
     REQUIRE(length == 6);
 }
 
 TEST_CASE("Buffer get first non blank in empty line", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {""};
+    buffer.set_lines({""});
     int index = buffer.get_first_non_blank(0);
     REQUIRE(index == 0);
 }
@@ -39,70 +45,307 @@ TEST_CASE("Buffer get first non blank in whitespace line", "[buffer]") {
     Buffer buffer;
     // If line only consists of whitespace characters the first non blank should
     // be equal to the length of the line
-    buffer.lines = {" \t\r\n"};
+    buffer.set_lines({" \t\r\n"});
     int index = buffer.get_first_non_blank(0);
     REQUIRE(index == 4);
 }
 
 TEST_CASE("Buffer get first non blank", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"    foo"};  // Four spaces + foo
+    buffer.set_lines({"    foo"});  // Four spaces + foo
     int index = buffer.get_first_non_blank(0);
     REQUIRE(index == 4);
 }
 
 TEST_CASE("Buffer set line", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foo"};
+    buffer.set_lines({"foo"});
     buffer.set_line("bar", 0);
-    std::string line = buffer.lines[0];
+    std::string line = buffer.get_lines()[0];
     REQUIRE(line == "bar");
 }
 
 TEST_CASE("Buffer push back line", "[buffer]") {
     Buffer buffer;
     buffer.push_back_line("foo");
-    std::string line = buffer.lines[0];
+    std::string line = buffer.get_lines()[0];
     REQUIRE(line == "foo");
 }
 
 TEST_CASE("Buffer insert line", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foo", "bar"};
+    buffer.set_lines({"foo", "bar"});
     buffer.insert_line("hello", 1);
-    std::string line = buffer.lines[1];
+    std::string line = buffer.get_lines()[1];
     REQUIRE(line == "hello");
 }
 
 TEST_CASE("Buffer add string to line", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foo"};
+    buffer.set_lines({"foo"});
     buffer.add_string_to_line("bar", 0);
-    std::string line = buffer.lines[0];
+    std::string line = buffer.get_lines()[0];
     REQUIRE(line == "foobar");
 }
 
 TEST_CASE("Buffer erase", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foobar"};
+    buffer.set_lines({"foobar"});
     buffer.erase(3, 3, 0);  // Erase bar
-    std::string line = buffer.lines[0];
+    std::string line = buffer.get_lines()[0];
     REQUIRE(line == "foo");
 }
 
 TEST_CASE("Buffer insert character", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foobar"};
+    buffer.set_lines({"foobar"});
     // File line 0 with ' ' 4 times from position 3
     buffer.insert_char(3, 4, ' ', 0);
-    std::string line = buffer.lines[0];
+    std::string line = buffer.get_lines()[0];
     REQUIRE(line == "foo    bar");  // foo + 4 spaces + bar
 }
 
 TEST_CASE("Buffer remove line", "[buffer]") {
     Buffer buffer;
-    buffer.lines = {"foo", "bar"};
+    buffer.set_lines({"foo", "bar"});
     buffer.remove_line(0);
-    std::string line = buffer.lines[0];
+    std::string line = buffer.get_lines()[0];
     REQUIRE(line == "bar");
 }
+
+TEST_CASE("Buffer insert string", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"foobar"});
+    SECTION("Single line") {
+        Position end = buffer.insert_string(3, "baz", 0);
+        Position expected_end = {0, 6};
+        CHECK(buffer.get_lines()[0] == "foobazbar");
+        CHECK(end == expected_end);
+    }
+    SECTION("Multiple lines") {
+        Position end = buffer.insert_string(3, "1\n2\n3", 0);
+        std::vector<std::string> expected{"foo1", "2", "3bar"};
+        Position expected_end = {2, 1};
+        CHECK(buffer.get_lines() == expected);
+        CHECK(end == expected_end);
+    }
+}
+
+TEST_CASE("Buffer remove lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"foo", "bar", "baz", "qux"});
+    buffer.remove_lines(1, 2);
+    std::vector<std::string> expected{"foo", "qux"};
+    REQUIRE(buffer.get_lines() == expected);
+}
+
+TEST_CASE("Buffer remove marked lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"a", "b", "c", "d", "e"});
+    buffer.remove_lines(std::vector<int>{0, 2, 3});
+    std::vector<std::string> expected{"b", "e"};
+    CHECK(buffer.get_lines() == expected);
+    buffer.remove_lines(std::vector<int>());
+    CHECK(buffer.get_lines() == expected);
+}
+
+TEST_CASE("Buffer insert lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"a", "d"});
+    buffer.insert_lines({"b", "c"}, 1);
+    buffer.insert_lines({"e"}, 4);
+    std::vector<std::string> expected{"a", "b", "c", "d", "e"};
+    REQUIRE(buffer.get_lines() == expected);
+}
+
+TEST_CASE("Buffer replace lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"a", "b", "c", "d"});
+    SECTION("Fewer lines") {
+        buffer.replace_lines(1, 3, {"x"});
+        std::vector<std::string> expected{"a", "x"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+    SECTION("More lines") {
+        buffer.replace_lines(0, 0, {"x", "y", "z"});
+        std::vector<std::string> expected{"x", "y", "z", "b", "c", "d"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+    SECTION("No lines") {
+        buffer.replace_lines(1, 2, {});
+        std::vector<std::string> expected{"a", "d"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+}
+
+TEST_CASE("Buffer replace range", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"foo", "bar", "baz"});
+    SECTION("Within a line") {
+        Position end = buffer.replace_range({1, 1}, {1, 2}, "xyz");
+        std::vector<std::string> expected{"foo", "bxyzr", "baz"};
+        Position expected_end = {1, 4};
+        CHECK(buffer.get_lines() == expected);
+        CHECK(end == expected_end);
+    }
+    SECTION("Across lines") {
+        Position end = buffer.replace_range({0, 2}, {2, 1}, "1\n2");
+        std::vector<std::string> expected{"fo1", "2az"};
+        Position expected_end = {1, 1};
+        CHECK(buffer.get_lines() == expected);
+        CHECK(end == expected_end);
+    }
+    SECTION("Join lines") {
+        Position end = buffer.replace_range({0, 3}, {1, 0}, "");
+        std::vector<std::string> expected{"foobar", "baz"};
+        Position expected_end = {0, 3};
+        CHECK(buffer.get_lines() == expected);
+        CHECK(end == expected_end);
+    }
+}
+
+TEST_CASE("Buffer reorder lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"a", "b", "c", "d", "e", "f"});
+    SECTION("Every line") {
+        buffer.reorder_lines(1, 4, {4, 1, 3, 2});
+        std::vector<std::string> expected{"a", "e", "b", "d", "c", "f"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+    SECTION("Lines that are not given are removed") {
+        buffer.reorder_lines(0, 5, {5, 0, 2});
+        std::vector<std::string> expected{"f", "a", "c"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+}
+
+TEST_CASE("Buffer move lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"a", "b", "c", "d", "e"});
+    SECTION("Down") {
+        buffer.move_lines(0, 1, 4);
+        std::vector<std::string> expected{"c", "d", "a", "b", "e"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+    SECTION("Up") {
+        buffer.move_lines(3, 4, 0);
+        std::vector<std::string> expected{"d", "e", "a", "b", "c"};
+        REQUIRE(buffer.get_lines() == expected);
+    }
+}
+
+TEST_CASE("Buffer version changes with lines", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines({"foo"});
+    std::uint64_t version = buffer.get_version();
+    buffer.insert_char(0, 1, 'x', 0);
+    CHECK(buffer.get_version() > version);
+    version = buffer.get_version();
+    buffer.insert_string(0, "a\nb", 0);
+    CHECK(buffer.get_version() > version);
+    version = buffer.get_version();
+    buffer.set_lines({"bar"});
+    CHECK(buffer.get_version() > version);
+    version = buffer.get_version();
+    buffer.change_lines([](std::vector<std::string> &lines) {
+        lines[0] = "baz";
+        return std::vector<int>{0};
+    });
+    CHECK(buffer.get_version() > version);
+    version = buffer.get_version();
+    buffer.change_lines(
+        [](std::vector<std::string> &) { return std::vector<int>(); });
+    CHECK(buffer.get_version() == version);
+}
+
+TEST_CASE("Buffer tells observers about changes", "[buffer]") {
+    // Records every change that it is told about
+    class Recorder : public BufferObserver {
+       public:
+        std::vector<BufferChange> changes;
+        std::vector<std::vector<int>> rows;
+
+        void on_change(const std::vector<std::string> &,
+                       const BufferChange &change) override {
+            changes.push_back(change);
+            rows.push_back(change.rows == nullptr ? std::vector<int>()
+                                                  : *change.rows);
+        }
+    };
+    auto check_change = [](const BufferChange &change, int first, int removed,
+                           int inserted) {
+        CHECK(change.first == first);
+        CHECK(change.removed == removed);
+        CHECK(change.inserted == inserted);
+    };
+    Buffer buffer;
+    buffer.set_lines({"a", "b", "c", "d", "e"});
+    Recorder recorder;
+    buffer.add_observer(&recorder);
+    buffer.insert_char(0, 1, 'x', 1);
+    buffer.insert_string(1, "1\n2\n", 2);
+    buffer.remove_lines(std::vector<int>{0, 3});
+    buffer.move_lines(0, 1, 4);
+    buffer.change_lines([](std::vector<std::string> &lines) {
+        lines[0] += "!";
+        lines[2] += "!";
+        return std::vector<int>{0, 2};
+    });
+    buffer.remove_observer(&recorder);
+    buffer.remove_line(0);
+    REQUIRE(recorder.changes.size() == 6);
+    check_change(recorder.changes[0], 1, 1, 1);
+    check_change(recorder.changes[1], 2, 1, 3);
+    check_change(recorder.changes[2], 0, 4, 2);
+    CHECK(recorder.rows[2] == std::vector<int>{0, 3});
+    check_change(recorder.changes[3], 0, 2, 0);
+    check_change(recorder.changes[4], 2, 0, 2);
+    check_change(recorder.changes[5], 0, 3, 3);
+    CHECK(recorder.rows[5] == std::vector<int>{0, 2});
+    for (std::size_t i = 1; i < recorder.changes.size(); ++i) {
+        CHECK(recorder.changes[i].version ==
+              recorder.changes[i - 1].version + 1);
+    }
+    CHECK(recorder.changes.back().version + 1 == buffer.get_version());
+}
+
+TEST_CASE("Buffer keeps its index up to date", "[buffer]") {
+    Buffer buffer;
+    buffer.set_lines(std::vector<std::string>(1000, "filler"));
+    TrigramIndex index;
+    index.reset(buffer.get_lines());
+    index.build(buffer.get_lines(), Job::Clock::time_point::max());
+    buffer.add_observer(&index);
+    buffer.insert_line("first needle", 500);
+    buffer.insert_string(0, "x\nsecond needle\n", 900);
+    buffer.remove_lines(10, 20);
+    buffer.remove_lines(std::vector<int>{40, 41, 600, 990});
+    buffer.add_string_to_line(" third needle", 0);
+    buffer.change_lines([](std::vector<std::string> &lines) {
+        lines[700] = "fourth needle";
+        return std::vector<int>{700};
+    });
+    buffer.insert_lines({"fifth needle", "filler"}, 300);
+    buffer.move_lines(295, 305, 800);
+    buffer.move_lines(850, 860, 2);
+    buffer.replace_lines(100, 110, {"sixth needle"});
+    buffer.replace_lines(200, 201, {"a", "seventh needle", "b", "c"});
+    buffer.replace_range({400, 2}, {402, 0}, "eighth\nneedle");
+    std::vector<int> rows;
+    for (int row = 999; row >= 0; row -= 2) {
+        rows.push_back(row);
+    }
+    buffer.reorder_lines(0, 999, rows);
+    TrigramQuery query = TrigramIndex::get_query({"needle"});
+    for (int line = 0; line < buffer.get_size(); ++line) {
+        int run = 0;
+        if (buffer.get_lines()[line].find("needle") != std::string::npos) {
+            CHECK(index.may_match(query, line, true, run));
+        }
+    }
+    int run = 0;
+    CHECK(index.may_match({}, 0, true, run));
+    CHECK(run == buffer.get_size());
+    buffer.set_lines({"new", "lines"});
+    CHECK_FALSE(index.is_complete());
+}
@@ -0,0 +1,35 @@
+#include "change.hpp"
+
+#include <catch2/catch.hpp>
+#include <string>
+
+#include "keymap.hpp"
+
+TEST_CASE("Change initial construction", "[change]") {
+    Change change;
+    CHECK_FALSE(change.is_repeatable());
+    CHECK_FALSE(change.is_insert());
+}
+
+TEST_CASE("Change is insert", "[change]") {
+    CHECK(Change(Action::APPEND_END_OF_LINE, 1).is_insert());
+    CHECK_FALSE(Change(Action::DELETE_LINE, 1).is_insert());
+}
+
+TEST_CASE("Change get insert text", "[change]") {
+    SECTION("Insert") {
+        Change change(Action::INSERT_MODE, 1);
+        change.text = "foo";
+        CHECK(change.get_insert_text(3) == "foofoofoo");
+    }
+    SECTION("Begin new line below") {
+        Change change(Action::BEGIN_NEW_LINE_BELOW, 1);
+        change.text = "foo";
+        CHECK(change.get_insert_text(2) == "\nfoo\nfoo");
+    }
+    SECTION("Begin new line above") {
+        Change change(Action::BEGIN_NEW_LINE_ABOVE, 1);
+        change.text = "foo";
+        CHECK(change.get_insert_text(2) == "foo\nfoo\n");
+    }
+}
@@ -97,3 +97,216 @@ TEST_CASE("Command multiple commands with quotes", "[command]") {
     bool equal = commands_equal(commands, expected);
     REQUIRE(equal);
 }
+
+TEST_CASE("Command map", "[command]") {
+    std::vector<Command> commands = get_command("nnoremap x dd<Bar>");
+    std::vector<Command> expected{{CommandType::MAP, "nnoremap", "x dd<Bar>"}};
+    bool equal = commands_equal(commands, expected);
+    REQUIRE(equal);
+}
+
+TEST_CASE("Command range", "[command]") {
+    SECTION("Single line") {
+        std::vector<Command> commands = get_command("3d");
+        REQUIRE(commands.size() == 1);
+        CHECK(commands[0].type == CommandType::DELETE);
+        CHECK(commands[0].range.start == 3);
+        CHECK(commands[0].range.end == 3);
+    }
+    SECTION("Backwards range is swapped") {
+        std::vector<Command> commands = get_command("$,2d");
+        REQUIRE(commands.size() == 1);
+        CHECK(commands[0].range.start == 2);
+        CHECK(commands[0].range.end == LineRange::LAST_LINE);
+    }
+    SECTION("Line numbers past 2^31") {
+        std::vector<Command> commands = get_command("3000000000,3000000001d");
+        REQUIRE(commands.size() == 1);
+        CHECK(commands[0].range.start == 3000000000LL);
+        CHECK(commands[0].range.end == 3000000001LL);
+    }
+    SECTION("Whole file") {
+        std::vector<Command> commands = get_command("%s/a b/c/g");
+        std::vector<Command> expected{
+            {CommandType::SUBSTITUTE, "s", "/a b/c/g"}};
+        REQUIRE(commands_equal(commands, expected));
+        CHECK(commands[0].range.start == 1);
+        CHECK(commands[0].range.end == LineRange::LAST_LINE);
+    }
+    SECTION("No range given") {
+        std::vector<Command> commands = get_command("a foo bar");
+        std::vector<Command> expected{{CommandType::APPEND, "a", "foo bar"}};
+        REQUIRE(commands_equal(commands, expected));
+        CHECK(commands[0].range.is_current_line());
+        CHECK_FALSE(commands[0].has_range);
+    }
+    SECTION("Current line given") {
+        std::vector<Command> commands = get_command(".w out");
+        REQUIRE(commands.size() == 1);
+        CHECK(commands[0].range.is_current_line());
+        CHECK(commands[0].has_range);
+    }
+    SECTION("Addresses with offsets") {
+        std::vector<Command> commands = get_command(".,.+2d | $-1y | 4+1d");
+        REQUIRE(commands.size() == 3);
+        CHECK(commands[0].range.start == LineRange::CURRENT_LINE);
+        CHECK(commands[0].range.end == LineRange::CURRENT_LINE);
+        CHECK(commands[0].range.end_offset == 2);
+        CHECK_FALSE(commands[0].range.is_current_line());
+        CHECK(commands[1].type == CommandType::YANK);
+        CHECK(commands[1].range.end == LineRange::LAST_LINE);
+        CHECK(commands[1].range.end_offset == -1);
+        CHECK_FALSE(commands[1].range.is_absolute());
+        // Offsets of line numbers are added while parsing
+        CHECK(commands[2].range.start == 5);
+        CHECK(commands[2].range.end_offset == 0);
+    }
+    SECTION("Visual selection") {
+        std::vector<Command> commands = get_command("'<,'>d");
+        REQUIRE(commands.size() == 1);
+        CHECK(commands[0].range.start == LineRange::VISUAL_START);
+        CHECK(commands[0].range.end == LineRange::VISUAL_END);
+    }
+    SECTION("Patterns") {
+        std::vector<Command> commands = get_command("/a\\/b/;?c?-1d");
+        REQUIRE(commands.size() == 1);
+        CHECK(commands[0].type == CommandType::DELETE);
+        CHECK(commands[0].range.start == LineRange::NEXT_MATCH);
+        CHECK(commands[0].range.start_pattern == "a/b");
+        CHECK(commands[0].range.end == LineRange::PREVIOUS_MATCH);
+        CHECK(commands[0].range.end_pattern == "c");
+        CHECK(commands[0].range.end_offset == -1);
+        CHECK(commands[0].range.end_from_start);
+    }
+    SECTION("Range without command") {
+        std::vector<Command> commands = get_command("/foo/ | $");
+        std::vector<Command> expected{{CommandType::JUMP_LINE, "", ""},
+                                      {CommandType::JUMP_LINE, "", ""}};
+        REQUIRE(commands_equal(commands, expected));
+        CHECK(commands[0].range.end == LineRange::NEXT_MATCH);
+        CHECK(commands[1].range.end == LineRange::LAST_LINE);
+    }
+    SECTION("No range allowed") {
+        std::vector<Command> commands = get_command("1,2set number");
+        std::vector<Command> expected{
+            {CommandType::ERROR_NO_RANGE_ALLOWED, "set", "number"}};
+        REQUIRE(commands_equal(commands, expected));
+    }
+}
+
+TEST_CASE("Command global", "[command]") {
+    SECTION("Command is the rest of the line") {
+        std::vector<Command> commands = get_command("g/a|b/s/x/y/ | d");
+        std::vector<Command> expected{
+            {CommandType::GLOBAL, "g", "/a|b/s/x/y/ | d"}};
+        REQUIRE(commands_equal(commands, expected));
+        CHECK(commands[0].range.is_current_line());
+    }
+    SECTION("Inverse") {
+        std::vector<Command> expected{{CommandType::GLOBAL, "v", "/foo/d"}};
+        CHECK(commands_equal(get_command("v/foo/d"), expected));
+        CHECK(commands_equal(get_command("g!/foo/d"), expected));
+        CHECK(commands_equal(get_command("vglobal/foo/d"), expected));
+    }
+    SECTION("Range") {
+        std::vector<Command> commands = get_command("set tabs | 2,$global#'#d");
+        std::vector<Command> expected{{CommandType::SET, "set", "tabs"},
+                                      {CommandType::GLOBAL, "g", "#'#d"}};
+        REQUIRE(commands_equal(commands, expected));
+        CHECK(commands[1].range.start == 2);
+        CHECK(commands[1].range.end == LineRange::LAST_LINE);
+    }
+}
+
+TEST_CASE("Command move and copy", "[command]") {
+    std::vector<Command> commands = get_command("2,3m0 | t. | co $ | move");
+    std::vector<Command> expected{{CommandType::MOVE, "m", "0"},
+                                  {CommandType::COPY, "t", "."},
+                                  {CommandType::COPY, "co", "$"},
+                                  {CommandType::ERROR_INVALID_COMMAND, "move",
+                                   ""}};
+    REQUIRE(commands_equal(commands, expected));
+    CHECK(commands[0].range.start == 2);
+    CHECK(commands[0].range.end == 3);
+}
+
+TEST_CASE("Command shift", "[command]") {
+    std::vector<Command> commands = get_command("%>> | <");
+    std::vector<Command> expected{{CommandType::SHIFT_RIGHT, ">>", ""},
+                                  {CommandType::SHIFT_LEFT, "<", ""}};
+    REQUIRE(commands_equal(commands, expected));
+    CHECK(commands[0].range.start == 1);
+    CHECK(commands[1].range.is_current_line());
+}
+
+TEST_CASE("Command sort", "[command]") {
+    std::vector<Command> commands = get_command("sort | 2,$sort! n u");
+    std::vector<Command> expected{{CommandType::SORT, "sort", ""},
+                                  {CommandType::SORT, "sort!", "n u"}};
+    REQUIRE(commands_equal(commands, expected));
+    CHECK(commands[0].range.is_current_line());
+    CHECK(commands[1].range.start == 2);
+}
+
+TEST_CASE("Command filter", "[command]") {
+    SECTION("Shell command is the rest of the line") {
+        std::vector<Command> commands =
+            get_command("set tabs | %!sort | uniq -c");
+        std::vector<Command> expected{
+            {CommandType::SET, "set", "tabs"},
+            {CommandType::FILTER, "!", "sort | uniq -c"}};
+        REQUIRE(commands_equal(commands, expected));
+        CHECK(commands[1].range.start == 1);
+        CHECK(commands[1].range.end == LineRange::LAST_LINE);
+    }
+    SECTION("Without a range") {
+        std::vector<Command> expected{{CommandType::SHELL, "!", "ls"}};
+        CHECK(commands_equal(get_command("! ls"), expected));
+    }
+    SECTION("Without a shell command") {
+        std::vector<Command> expected{
+            {CommandType::ERROR_INVALID_COMMAND, "!", ""}};
+        CHECK(commands_equal(get_command("2,3!"), expected));
+    }
+}
+
+TEST_CASE("Command write and read", "[command]") {
+    std::vector<Command> commands =
+        get_command("w! out.txt | 2,3w >> log.txt | 0r in.txt | %w");
+    std::vector<Command> expected{
+        {CommandType::WRITE, "w!", "out.txt"},
+        {CommandType::WRITE, "w", ">> log.txt"},
+        {CommandType::READ, "r", "in.txt"},
+        {CommandType::WRITE, "w", ""}};
+    REQUIRE(commands_equal(commands, expected));
+    CHECK(commands[1].range.start == 2);
+    CHECK(commands[2].range.end == 0);
+    CHECK(commands[3].range.end == LineRange::LAST_LINE);
+}
+
+TEST_CASE("Command latency", "[command]") {
+    std::vector<Command> commands = get_command("latency | latency insert");
+    std::vector<Command> expected{{CommandType::LATENCY, "latency", ""},
+                                  {CommandType::LATENCY, "latency", "insert"}};
+    REQUIRE(commands_equal(commands, expected));
+}
+
+TEST_CASE("Command search", "[command]") {
+    SECTION("Pattern is the rest of the line") {
+        std::vector<Command> commands = get_command("/\\vfoo|bar");
+        std::vector<Command> expected{
+            {CommandType::SEARCH_FORWARD, "/", "\\vfoo|bar"}};
+        REQUIRE(commands_equal(commands, expected));
+    }
+    SECTION("Backward") {
+        std::vector<Command> commands = get_command("?foo");
+        std::vector<Command> expected{
+            {CommandType::SEARCH_BACKWARD, "?", "foo"}};
+        REQUIRE(commands_equal(commands, expected));
+    }
+    SECTION("Closed pattern is an address") {
+        std::vector<Command> commands = get_command("/foo/");
+        std::vector<Command> expected{{CommandType::JUMP_LINE, "", ""}};
+        REQUIRE(commands_equal(commands, expected));
+    }
+}
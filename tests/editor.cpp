@@ -1,6 +1,12 @@
 #include "editor.hpp"
 
+#include <unistd.h>
+
 #include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -245,6 +251,19 @@ TEST_CASE("Editor normal delete line", "[editor]") {
         std::string result = get_result(buffer, input);
         REQUIRE(result == expected);
     }
+    SECTION("Delete last line") {
+        std::string buffer =
+            "line1\n"
+            "  line2\n"
+            "line3";
+        std::string input = "G3ddx";
+        std::string expected =
+            "line1\n"
+            "  ine2";
+
+        std::string result = get_result(buffer, input);
+        REQUIRE(result == expected);
+    }
 }
 
 TEST_CASE("Editor normal add count", "[editor]") {
@@ -577,4 +596,979 @@ TEST_CASE("Editor visual delete selection", "[editor]") {
         std::string result = get_result(buffer, input);
         CHECK(result == expected);
     }
+    SECTION("Whole buffer") {
+        std::string input = "VGdix\x1b";
+        CHECK(get_result(buffer, input) == "x");
+    }
+    SECTION("Large selection") {
+        std::string large_buffer;
+        for (int i = 0; i < 100000; ++i) {
+            large_buffer += "line\n";
+        }
+        large_buffer += "last";
+        std::string input = "jvG2ld";
+        std::string expected =
+            "line\n"
+            "t";
+        CHECK(get_result(large_buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor mode toggles keep the stack flat", "[editor]") {
+    // Toggling between normal and insert mode should not grow the stack
+    auto toggle = [](int toggles) {
+        std::vector<int> inputs;
+        inputs.reserve(static_cast<std::size_t>(toggles) * 2 + 4);
+        for (int i = 0; i < toggles; ++i) {
+            inputs.push_back('i');
+            inputs.push_back('\u001b');
+        }
+        for (char c : std::string(":q\n")) {
+            inputs.push_back(c);
+        }
+        std::stringstream file_stream("foo");
+        Editor editor("", file_stream);
+        editor.set_interface(inputs, 3, 50);
+        editor.start("");
+        return editor.get_input_stack_range();
+    };
+    std::uintptr_t short_stack_range = toggle(100000);
+    std::uintptr_t long_stack_range = toggle(1000000);
+    CHECK(long_stack_range == short_stack_range);
+    CHECK(long_stack_range < 4096);
+}
+
+TEST_CASE("Editor user mappings", "[editor]") {
+    std::string buffer =
+        "line1\n"
+        "line2\n"
+        "line3";
+    SECTION("Non-recursive mapping") {
+        std::string input = ":nnoremap x dd\nx";
+        std::string expected =
+            "line2\n"
+            "line3";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Recursive mapping uses other mappings") {
+        std::string input = ":nnoremap x dd | nmap Q jx\nQ";
+        std::string expected =
+            "line1\n"
+            "line3";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Mapping that is a prefix of a default binding") {
+        std::string input = ":nmap g x\ngjgg";
+        std::string expected =
+            "ine1\n"
+            "line2\n"
+            "line3";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Recursive mapping does not hang") {
+        std::string input = ":nmap x x\nx";
+        REQUIRE_NOTHROW(get_result(buffer, input));
+    }
+}
+
+TEST_CASE("Editor large counts", "[editor]") {
+    // Counted motions and deletes should be clamped in a single step
+    std::string buffer =
+        "line1\n"
+        "line2\n"
+        "line3\n"
+        "line4\n"
+        "line5";
+    SECTION("Move down") {
+        std::string input = "999999999jx";
+        std::string expected =
+            "line1\n"
+            "line2\n"
+            "line3\n"
+            "line4\n"
+            "ine5";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Move up") {
+        std::string input = "G999999999kx";
+        std::string expected =
+            "ine1\n"
+            "line2\n"
+            "line3\n"
+            "line4\n"
+            "line5";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Delete does not go past the end of the line") {
+        std::string input = "j3l50000x";
+        std::string expected =
+            "line1\n"
+            "lin\n"
+            "line3\n"
+            "line4\n"
+            "line5";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Page down") {
+        std::string input = "99999" + std::string(1, 'f' & 0x1f) + "x";
+        std::string expected =
+            "line1\n"
+            "line2\n"
+            "line3\n"
+            "line4\n"
+            "ine5";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+}
+
+TEST_CASE("Editor macros", "[editor]") {
+    std::string buffer =
+        "line1\n"
+        "line2\n"
+        "line3\n"
+        "line4";
+    SECTION("Record and execute") {
+        std::string input = "qaxjq@a";
+        std::string expected =
+            "ine1\n"
+            "ine2\n"
+            "line3\n"
+            "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Execute with count and repeat last macro") {
+        std::string input = "qaxjq2@a@@";
+        std::string expected =
+            "ine1\n"
+            "ine2\n"
+            "ine3\n"
+            "ine4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Insert mode keys are recorded") {
+        std::string input = "qbA!\u001bjq3@b";
+        std::string expected =
+            "line1!\n"
+            "line2!\n"
+            "line3!\n"
+            "line4!";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Recursive macro does not hang") {
+        std::string input = "qa@aq@a";
+        REQUIRE_NOTHROW(get_result(buffer, input));
+    }
+    SECTION("Count before recording is discarded") {
+        std::string input = "3qaxq";
+        std::string expected =
+            "ine1\n"
+            "line2\n"
+            "line3\n"
+            "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+}
+
+TEST_CASE("Editor macro replay draws one frame", "[editor]") {
+    // A frame is only drawn before waiting for a key from the interface, so
+    // replaying a macro any number of times should not draw any other frame
+    std::string full_input = "qaA!\u001bjq100@a:wq\n";
+    std::vector<int> inputs(full_input.begin(), full_input.end());
+    std::stringstream file_stream(std::string(200, '\n'));
+    Editor editor("", file_stream);
+    editor.set_interface(inputs, 3, 50);
+    editor.start("");
+    REQUIRE(editor.get_frame_count() == static_cast<int>(inputs.size()));
+}
+
+TEST_CASE("Editor repeat last change", "[editor]") {
+    std::string buffer =
+        "line1\n"
+        "line2\n"
+        "line3\n"
+        "line4";
+    SECTION("Delete") {
+        std::string input = "2xj.";
+        std::string expected =
+            "ne1\n"
+            "ne2\n"
+            "line3\n"
+            "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Delete line with new count") {
+        std::string input = "dd2.";
+        std::string expected = "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Append with count") {
+        std::string input = "A!?\u001bj3.";
+        std::string expected =
+            "line1!?\n"
+            "line2!?!?!?\n"
+            "line3\n"
+            "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Insert with backspace and enter") {
+        std::string input = "iab\u007fc\nd\u001bjj0.";
+        std::string expected =
+            "ac\n"
+            "dline1\n"
+            "line2\n"
+            "ac\n"
+            "dline3\n"
+            "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+    SECTION("Begin new line below") {
+        std::string input = "ofoo\u001b.";
+        std::string expected =
+            "line1\n"
+            "foo\n"
+            "foo\n"
+            "line2\n"
+            "line3\n"
+            "line4";
+
+        std::string result = get_result(buffer, input);
+        CHECK(result == expected);
+    }
+}
+
+TEST_CASE("Editor batch", "[editor]") {
+    std::string buffer =
+        "line1\n"
+        "line2\n"
+        "line3";
+    std::stringstream file_stream(buffer);
+    Options options;
+    Keymap keymap;
+    SECTION("Commands run before keys") {
+        std::string keys = "xifoo\u001bx";
+        std::vector<int> inputs(keys.begin(), keys.end());
+        Editor editor("", file_stream);
+        std::vector<std::string> errors =
+            editor.run_batch("2", inputs, options, keymap);
+        CHECK(errors.empty());
+        CHECK(editor.get_buffer_stream().str() ==
+              "line1\n"
+              "foine2\n"
+              "line3");
+    }
+    SECTION("Errors are collected") {
+        std::string keys = ":q\n";
+        std::vector<int> inputs(keys.begin(), keys.end());
+        Editor editor("", file_stream);
+        std::vector<std::string> errors =
+            editor.run_batch("foo", inputs, options, keymap);
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0] == "Not an editor command: foo");
+    }
+    SECTION("Shared mappings apply") {
+        keymap.map("nmap", "X dd");
+        std::string keys = "jX";
+        std::vector<int> inputs(keys.begin(), keys.end());
+        Editor editor("", file_stream);
+        std::vector<std::string> errors =
+            editor.run_batch("", inputs, options, keymap);
+        CHECK(errors.empty());
+        CHECK(editor.get_buffer_stream().str() ==
+              "line1\n"
+              "line3");
+    }
+    SECTION("Scripted input ends in a pending mode") {
+        std::string keys = "ddAbar";
+        std::vector<int> inputs(keys.begin(), keys.end());
+        Editor editor("", file_stream);
+        std::vector<std::string> errors =
+            editor.run_batch("", inputs, options, keymap);
+        CHECK(errors.empty());
+        CHECK(editor.get_buffer_stream().str() ==
+              "line2bar\n"
+              "line3");
+    }
+}
+
+TEST_CASE("Editor line range commands", "[editor]") {
+    std::string buffer =
+        "foo\n"
+        "bar\n"
+        "foo bar";
+    SECTION("Delete") {
+        std::string input = ":2,$d\n";
+        CHECK(get_result(buffer, input) == "foo");
+    }
+    SECTION("Substitute") {
+        std::string input = ":%s/foo/baz/\n";
+        std::string expected =
+            "baz\n"
+            "bar\n"
+            "baz bar";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Append") {
+        std::string input = ":1a new\n";
+        std::string expected =
+            "foo\n"
+            "new\n"
+            "bar\n"
+            "foo bar";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Delete moves to the line after the range") {
+        std::string input = ":1d\nx";
+        std::string expected =
+            "ar\n"
+            "foo bar";
+        CHECK(get_result(buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor range addresses", "[editor]") {
+    std::string buffer =
+        "a\n"
+        "b\n"
+        "c\n"
+        "d\n"
+        "e";
+    SECTION("Offsets") {
+        std::string input = "j:.,.+1d | $-1d\n";
+        std::string expected =
+            "a\n"
+            "e";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Patterns") {
+        std::string input = ":/c/;+1d\n";
+        std::string expected =
+            "a\n"
+            "b\n"
+            "e";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Pattern before the current line") {
+        std::string input = "G:?b?,.-1d\n";
+        std::string expected =
+            "a\n"
+            "e";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Range without command jumps to its end") {
+        std::string input = ":/d/\nx:1\nx";
+        std::string expected =
+            "\n"
+            "b\n"
+            "c\n"
+            "\n"
+            "e";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Visual selection") {
+        std::string input = "jVj:d\n";
+        std::string expected =
+            "a\n"
+            "d\n"
+            "e";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Last visual selection") {
+        std::string input = "jvj\x1bG:'<,'>d\n";
+        std::string expected =
+            "a\n"
+            "d\n"
+            "e";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Missing pattern leaves the buffer") {
+        std::string input = ":/z/d\n";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+}
+
+TEST_CASE("Editor yank and put", "[editor]") {
+    std::string buffer =
+        "a\n"
+        "b\n"
+        "c";
+    SECTION("Yank") {
+        std::string input = ":1,2y\nGp";
+        std::string expected =
+            "a\n"
+            "b\n"
+            "c\n"
+            "a\n"
+            "b";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Put above with a count") {
+        std::string input = ":3y\n2P";
+        std::string expected =
+            "c\n"
+            "c\n"
+            "a\n"
+            "b\n"
+            "c";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Delete keeps the lines") {
+        std::string input = ":%d\np";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+    SECTION("Nothing to put") {
+        std::string input = "p";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+}
+
+TEST_CASE("Editor move and copy", "[editor]") {
+    std::string buffer =
+        "a\n"
+        "b\n"
+        "c\n"
+        "d";
+    SECTION("Move to the top") {
+        std::string input = ":3,4m0\nx";
+        std::string expected =
+            "c\n"
+            "\n"
+            "a\n"
+            "b";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Move to the end") {
+        std::string input = ":1m$\nx";
+        std::string expected =
+            "b\n"
+            "c\n"
+            "d\n"
+            "";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Move into itself") {
+        std::string input = ":1,3m2\n";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+    SECTION("Copy below the current line") {
+        std::string input = "j:3,4t.\nx";
+        std::string expected =
+            "a\n"
+            "b\n"
+            "c\n"
+            "\n"
+            "c\n"
+            "d";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Copy to the top") {
+        std::string input = ":$co0\n";
+        std::string expected =
+            "d\n"
+            "a\n"
+            "b\n"
+            "c\n"
+            "d";
+        CHECK(get_result(buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor shift", "[editor]") {
+    std::string buffer =
+        "a\n"
+        "\n"
+        "      b\n"
+        "\tc";
+    SECTION("Right") {
+        std::string input = ":1,3>\n";
+        std::string expected =
+            "    a\n"
+            "\n"
+            "          b\n"
+            "\tc";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Right with tabs") {
+        std::string input = ":set tabs | 1>>\n";
+        std::string expected =
+            "\t\ta\n"
+            "\n"
+            "      b\n"
+            "\tc";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Left") {
+        std::string input = ":%<\n";
+        std::string expected =
+            "a\n"
+            "\n"
+            "  b\n"
+            "c";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Left twice") {
+        std::string input = ":3<<\n";
+        std::string expected =
+            "a\n"
+            "\n"
+            "b\n"
+            "\tc";
+        CHECK(get_result(buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor sort", "[editor]") {
+    std::string buffer =
+        "b 10\n"
+        "a 9\n"
+        "c 10\n"
+        "a 9";
+    SECTION("Every line") {
+        std::string input = "G:sort\nx";
+        std::string expected =
+            " 9\n"
+            "a 9\n"
+            "b 10\n"
+            "c 10";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Numeric unique") {
+        std::string input = ":sort nu\n";
+        std::string expected =
+            "a 9\n"
+            "b 10";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Current line") {
+        std::string input = "G:.sort\nx";
+        std::string expected =
+            "b 10\n"
+            "a 9\n"
+            "c 10\n"
+            " 9";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Reverse range") {
+        std::string input = ":2,$sort!\n";
+        std::string expected =
+            "b 10\n"
+            "c 10\n"
+            "a 9\n"
+            "a 9";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Invalid argument") {
+        std::string input = ":sort x\n";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+}
+
+TEST_CASE("Editor filter", "[editor]") {
+    std::string buffer =
+        "b\n"
+        "c\n"
+        "a";
+    SECTION("Every line") {
+        std::string input = ":%!sort\n";
+        std::string expected =
+            "a\n"
+            "b\n"
+            "c";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Range") {
+        std::string input = ":2,3!tr a-z A-Z\n";
+        std::string expected =
+            "b\n"
+            "C\n"
+            "A";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Output with more lines") {
+        std::string input = ":1!printf 'x\\ny'\n";
+        std::string expected =
+            "x\n"
+            "y\n"
+            "c\n"
+            "a";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("No output") {
+        std::string input = ":%!true\nix\x1b";
+        CHECK(get_result(buffer, input) == "x");
+    }
+    SECTION("Failed command keeps the lines") {
+        std::string input = ":%!sort; exit 1\n";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+}
+
+TEST_CASE("Editor write and read other files", "[editor]") {
+    char path_template[] = "/tmp/claditor_editor_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::string buffer =
+        "a\n"
+        "b\n"
+        "c";
+    std::string content;
+    SECTION("Write a range") {
+        get_result(buffer, ":2,3w! " + path + "\n");
+        std::ifstream file(path);
+        content.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+        CHECK(content == "b\nc\n");
+    }
+    SECTION("Write the current line") {
+        get_result(buffer, "j:.w! " + path + "\n");
+        std::ifstream file(path);
+        content.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+        CHECK(content == "b\n");
+    }
+    SECTION("Existing file is kept without !") {
+        get_result(buffer, ":w " + path + "\n");
+        std::ifstream file(path);
+        content.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+        CHECK(content.empty());
+    }
+    SECTION("Append") {
+        std::ofstream(path) << "x\n";
+        get_result(buffer, ":1w >>" + path + "\n");
+        std::ifstream file(path);
+        content.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+        CHECK(content == "x\na\n");
+    }
+    SECTION("Read below the cursor") {
+        std::ofstream(path) << "x\ny\n";
+        std::string expected =
+            "a\n"
+            "b\n"
+            "x\n"
+            "y\n"
+            "c";
+        CHECK(get_result(buffer, "j:r " + path + "\n") == expected);
+    }
+    SECTION("Read above the first line") {
+        std::ofstream(path) << "x";
+        std::string expected =
+            "x\n"
+            "a\n"
+            "b\n"
+            "c";
+        CHECK(get_result(buffer, ":0r " + path + "\n") == expected);
+    }
+    SECTION("Read into an empty buffer") {
+        std::ofstream(path) << "x\ny";
+        CHECK(get_result("", ":r " + path + "\n") == "x\ny");
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Editor substitute", "[editor]") {
+    std::string buffer =
+        "Foo foo\n"
+        "bar\n"
+        "foo bar";
+    SECTION("Regular expression") {
+        std::string input = ":%s/\\v[a-z]+$/<&>/\n";
+        std::string expected =
+            "Foo <foo>\n"
+            "<bar>\n"
+            "foo <bar>";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Ignore case") {
+        std::string input = ":1s/foo/x/gi\n";
+        std::string expected =
+            "x x\n"
+            "bar\n"
+            "foo bar";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Cursor is on the last substituted line") {
+        std::string input = ":%s/bar/x/\nx";
+        std::string expected =
+            "Foo foo\n"
+            "x\n"
+            "oo x";
+        CHECK(get_result(buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor substitute with confirmation", "[editor]") {
+    std::string buffer =
+        "foo foo\n"
+        "bar\n"
+        "foo";
+    SECTION("Answers") {
+        std::string input = ":%s/foo/x/gc\nyny";
+        std::string expected =
+            "x foo\n"
+            "bar\n"
+            "x";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Replace all") {
+        std::string input = ":%s/foo/x/gc\nna";
+        std::string expected =
+            "foo x\n"
+            "bar\n"
+            "x";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Replace last") {
+        std::string input = ":%s/foo/x/gc\nl";
+        std::string expected =
+            "x foo\n"
+            "bar\n"
+            "foo";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Quit") {
+        std::string input = ":%s/foo/x/c\nyq";
+        std::string expected =
+            "x foo\n"
+            "bar\n"
+            "foo";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Replacements are not matched again") {
+        std::string input = ":%s/o/oo/gc\nyyyq";
+        std::string expected =
+            "foooo fooo\n"
+            "bar\n"
+            "foo";
+        CHECK(get_result(buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor global", "[editor]") {
+    std::string buffer =
+        "DEBUG a\n"
+        "info b\n"
+        "DEBUG c\n"
+        "info d";
+    SECTION("Delete") {
+        std::string input = ":g/DEBUG/d\nx";
+        std::string expected =
+            "info b\n"
+            "nfo d";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Delete lines that do not match") {
+        std::string input = ":v/DEBUG/d\n";
+        std::string expected =
+            "DEBUG a\n"
+            "DEBUG c";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Delete every line") {
+        std::string input = ":g/\\v./d\nix\033";
+        CHECK(get_result(buffer, input) == "x");
+    }
+    SECTION("Range") {
+        std::string input = ":2,$g/DEBUG/s/\\v\\w+$/&&/\n";
+        std::string expected =
+            "DEBUG a\n"
+            "info b\n"
+            "DEBUG cc\n"
+            "info d";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Current line") {
+        std::string input = "jj:.g/DEBUG/d\n";
+        std::string expected =
+            "DEBUG a\n"
+            "info b\n"
+            "info d";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Marked lines follow inserted lines") {
+        std::string input = ":g/info/a new | s/new/added/\n";
+        std::string expected =
+            "DEBUG a\n"
+            "info b\n"
+            "added\n"
+            "DEBUG c\n"
+            "info d\n"
+            "added";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Marked lines follow removed lines") {
+        std::string input = ":g/DEBUG/d | s/info/x/\n";
+        std::string expected =
+            "x b\n"
+            "x d";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Range commands drop the marks of lines they remove") {
+        std::string range_buffer =
+            "x1\n"
+            "x2\n"
+            "y\n"
+            "x3\n"
+            "z";
+        std::string input = ":g/x/.,+1d\n";
+        CHECK(get_result(range_buffer, input) == "y");
+    }
+    SECTION("Errors leave the buffer unchanged") {
+        std::string input =
+            ":g/none/d\n:g/DEBUG\n:g/a/g/b/d\n:g/a/s/a/b/c\n:g/\\v(/d\n";
+        CHECK(get_result(buffer, input) == buffer);
+    }
+}
+
+TEST_CASE("Editor search", "[editor]") {
+    std::string buffer =
+        "foo bar\n"
+        "baz\n"
+        "bar foo\n"
+        "end";
+    SECTION("Forward") {
+        std::string input = "/bar\nx";
+        std::string expected =
+            "foo ar\n"
+            "baz\n"
+            "bar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Backward wraps around") {
+        std::string input = "?foo\nx";
+        std::string expected =
+            "foo bar\n"
+            "baz\n"
+            "bar oo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Next and previous") {
+        std::string input = "/ba\nnnNx";
+        std::string expected =
+            "foo bar\n"
+            "az\n"
+            "bar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Count") {
+        std::string input = "3/ba\nx";
+        std::string expected =
+            "foo bar\n"
+            "baz\n"
+            "ar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Empty pattern repeats the last search backward") {
+        std::string input = "/foo\n?\nx";
+        std::string expected =
+            "oo bar\n"
+            "baz\n"
+            "bar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Very magic pattern") {
+        std::string input = "/\\v^b\\a+ f\nx";
+        std::string expected =
+            "foo bar\n"
+            "baz\n"
+            "ar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Invalid pattern does not move") {
+        std::string input = "/\\v(bar\nx";
+        std::string expected =
+            "oo bar\n"
+            "baz\n"
+            "bar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Escape returns to the cursor before the preview") {
+        std::string input = "/baz\x1bx";
+        std::string expected =
+            "oo bar\n"
+            "baz\n"
+            "bar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Search starts from the cursor before the preview") {
+        std::string input = "/ba\x7f\x7f" "bar f\nx";
+        std::string expected =
+            "foo bar\n"
+            "baz\n"
+            "ar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+    SECTION("Pattern not found does not move") {
+        std::string input = "/qux\nx";
+        std::string expected =
+            "oo bar\n"
+            "baz\n"
+            "bar foo\n"
+            "end";
+        CHECK(get_result(buffer, input) == expected);
+    }
+}
+
+TEST_CASE("Editor search with a trigram index", "[editor]") {
+    std::string buffer;
+    for (int i = 0; i < 3000; ++i) {
+        buffer += "line " + std::to_string(i) + "\n";
+    }
+    SECTION("Finds lines of the index") {
+        std::string input = ":set trigramindex\n/line 2500\nx";
+        std::string result = get_result(buffer, input);
+        CHECK(result.find("\nine 2500\n") != std::string::npos);
+    }
+    SECTION("Finds lines edited after the index was built") {
+        std::string input =
+            ":set trigramindex\n/line 2999\nonew needle\033gg/needle\nx";
+        std::string result = get_result(buffer, input);
+        CHECK(result.find("\nnew eedle") != std::string::npos);
+    }
+    SECTION("Finds regular expressions") {
+        std::string input = ":set trigramindex\n/\\vline 1(23)+\nx";
+        std::string result = get_result(buffer, input);
+        CHECK(result.find("\nine 123\n") != std::string::npos);
+    }
 }
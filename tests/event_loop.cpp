@@ -0,0 +1,64 @@
+#include "event_loop.hpp"
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+TEST_CASE("EventLoop timeout without events", "[event_loop]") {
+    EventLoop event_loop;
+    REQUIRE_FALSE(event_loop.run_once(0));
+}
+
+TEST_CASE("EventLoop reader", "[event_loop]") {
+    EventLoop event_loop;
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    char received = 0;
+    event_loop.add_reader(fds[0], [&fds, &received] {
+        REQUIRE(read(fds[0], &received, 1) == 1);
+    });
+    REQUIRE_FALSE(event_loop.run_once(0));
+    REQUIRE(write(fds[1], "x", 1) == 1);
+    REQUIRE(event_loop.run_once(1000));
+    REQUIRE(received == 'x');
+    event_loop.remove_reader(fds[0]);
+    REQUIRE(write(fds[1], "y", 1) == 1);
+    REQUIRE_FALSE(event_loop.run_once(0));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("EventLoop timer", "[event_loop]") {
+    EventLoop event_loop;
+    int count = 0;
+    int timer = event_loop.add_timer(1, [&count] { ++count; });
+    REQUIRE(timer != -1);
+    REQUIRE(event_loop.run_once(1000));
+    REQUIRE(event_loop.run_once(1000));
+    REQUIRE(count == 2);
+    event_loop.remove_timer(timer);
+    REQUIRE_FALSE(event_loop.run_once(5));
+}
+
+TEST_CASE("EventLoop file watch", "[event_loop]") {
+    char directory_template[] = "/tmp/claditor_event_loop_XXXXXX";
+    REQUIRE(mkdtemp(directory_template) != nullptr);
+    std::string directory = directory_template;
+    std::string path = directory + "/file";
+    std::string other_path = directory + "/other";
+    EventLoop event_loop;
+    int count = 0;
+    REQUIRE(event_loop.watch_file(path, [&count] { ++count; }) != -1);
+    std::ofstream(other_path) << "other";
+    event_loop.run_once(50);
+    REQUIRE(count == 0);
+    std::ofstream(path) << "changed";
+    REQUIRE(event_loop.run_once(1000));
+    REQUIRE(count == 1);
+    std::remove(path.c_str());
+    std::remove(other_path.c_str());
+    rmdir(directory.c_str());
+}
@@ -0,0 +1,40 @@
+#include "file_reader.hpp"
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("Read lines of a file", "[file_reader]") {
+    char path_template[] = "/tmp/claditor_file_reader_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::vector<std::string> lines{"first"};
+    SECTION("Lines are appended") {
+        std::ofstream(path) << "a\n\nb\n";
+        REQUIRE(read_lines(path, lines));
+        CHECK(lines == std::vector<std::string>{"first", "a", "", "b"});
+    }
+    SECTION("Last line without a new line") {
+        std::ofstream(path) << "a\nb";
+        REQUIRE(read_lines(path, lines));
+        CHECK(lines == std::vector<std::string>{"first", "a", "b"});
+    }
+    SECTION("Empty file") {
+        REQUIRE(read_lines(path, lines));
+        CHECK(lines == std::vector<std::string>{"first"});
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Read lines fails without a regular file", "[file_reader]") {
+    std::vector<std::string> lines;
+    CHECK_FALSE(read_lines("/tmp/claditor_file_reader_missing", lines));
+    CHECK_FALSE(read_lines("/tmp", lines));
+    CHECK(lines.empty());
+}
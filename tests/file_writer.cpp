@@ -0,0 +1,126 @@
+#include "file_writer.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+std::string read_file_content(const std::string &path) {
+    std::ifstream file(path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+TEST_CASE("FileWriter writes in slices", "[file_writer]") {
+    char path_template[] = "/tmp/claditor_file_writer_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    chmod(path.c_str(), 0640);
+    std::vector<std::string> lines(10000, "line");
+    SECTION("Complete") {
+        FileWriter file_writer(path, lines);
+        int slices = 1;
+        // A deadline in the past writes a single chunk of lines per slice
+        while (!file_writer.run_slice(Job::Clock::now())) {
+            CHECK(file_writer.get_progress() < 1.0);
+            ++slices;
+        }
+        CHECK(slices > 1);
+        CHECK_FALSE(file_writer.has_failed());
+        CHECK(file_writer.get_progress() == 1.0);
+        std::string content = read_file_content(path);
+        CHECK(content.length() == 50000);
+        struct stat file_stat;
+        REQUIRE(stat(path.c_str(), &file_stat) == 0);
+        CHECK((file_stat.st_mode & 0777) == 0640);
+    }
+    SECTION("Cancelled") {
+        std::ofstream(path) << "original\n";
+        {
+            FileWriter file_writer(path, lines);
+            REQUIRE_FALSE(file_writer.run_slice(Job::Clock::now()));
+            file_writer.cancel();
+        }
+        CHECK(read_file_content(path) == "original\n");
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("FileWriter writes a range", "[file_writer]") {
+    char path_template[] = "/tmp/claditor_file_writer_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::ofstream(path) << "original\n";
+    std::vector<std::string> lines{"a", "b", "c", "d"};
+    SECTION("Replaced") {
+        FileWriter file_writer(path, lines, 1, 3, false);
+        REQUIRE(file_writer.run_slice(Job::Clock::now()));
+        CHECK_FALSE(file_writer.has_failed());
+        CHECK(read_file_content(path) == "b\nc\n");
+    }
+    SECTION("Appended") {
+        FileWriter file_writer(path, lines, 3, 4, true);
+        REQUIRE(file_writer.run_slice(Job::Clock::now()));
+        CHECK_FALSE(file_writer.has_failed());
+        CHECK(read_file_content(path) == "original\nd\n");
+    }
+    SECTION("Cancelled append") {
+        std::vector<std::string> many_lines(10000, "line");
+        {
+            FileWriter file_writer(path, many_lines, 0, 10000, true);
+            REQUIRE_FALSE(file_writer.run_slice(Job::Clock::now()));
+            file_writer.cancel();
+        }
+        CHECK(read_file_content(path) == "original\n");
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("FileWriter keeps links", "[file_writer]") {
+    char path_template[] = "/tmp/claditor_file_writer_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::string link_path = path + "_link";
+    std::ofstream(path) << "original\n";
+    std::vector<std::string> lines{"a", "b"};
+    SECTION("Symlink") {
+        REQUIRE(symlink(path.c_str(), link_path.c_str()) == 0);
+        FileWriter file_writer(link_path, lines);
+        REQUIRE(file_writer.run_slice(Job::Clock::now()));
+        CHECK_FALSE(file_writer.has_failed());
+        struct stat link_stat;
+        REQUIRE(lstat(link_path.c_str(), &link_stat) == 0);
+        CHECK(S_ISLNK(link_stat.st_mode));
+        CHECK(read_file_content(path) == "a\nb\n");
+    }
+    SECTION("Hard link") {
+        REQUIRE(link(path.c_str(), link_path.c_str()) == 0);
+        FileWriter file_writer(link_path, lines);
+        REQUIRE(file_writer.run_slice(Job::Clock::now()));
+        CHECK_FALSE(file_writer.has_failed());
+        CHECK(read_file_content(path) == "a\nb\n");
+    }
+    std::remove(link_path.c_str());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("FileWriter fails without a path", "[file_writer]") {
+    std::vector<std::string> lines{"line"};
+    FileWriter file_writer("", lines);
+    REQUIRE(file_writer.run_slice(Job::Clock::now()));
+    REQUIRE(file_writer.has_failed());
+}
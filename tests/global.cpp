@@ -0,0 +1,92 @@
+#include "global.hpp"
+
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+TEST_CASE("Global parse", "[global]") {
+    Global global;
+    SECTION("Pattern and command") {
+        REQUIRE(parse_global("/foo/s/a/b/", false, global));
+        CHECK(global.pattern == "foo");
+        CHECK(global.command == "s/a/b/");
+        CHECK_FALSE(global.inverse);
+    }
+    SECTION("Escaped delimiter") {
+        REQUIRE(parse_global("#a\\#b#d", true, global));
+        CHECK(global.pattern == "a#b");
+        CHECK(global.command == "d");
+        CHECK(global.inverse);
+    }
+    SECTION("Missing command") {
+        REQUIRE(parse_global("/foo", false, global));
+        CHECK(global.command.empty());
+    }
+    SECTION("Invalid") {
+        CHECK_FALSE(parse_global("", false, global));
+        CHECK_FALSE(parse_global("//d", false, global));
+        CHECK_FALSE(parse_global("/\\v(a/d", false, global));
+        CHECK_FALSE(global.search_pattern.is_valid());
+    }
+}
+
+TEST_CASE("Global mark lines", "[global]") {
+    std::vector<std::string> lines;
+    for (int i = 0; i < 100000; ++i) {
+        lines.push_back(i % 7 == 0 ? "DEBUG " + std::to_string(i) : "info");
+    }
+    Global global;
+    REQUIRE(parse_global("/DEBUG/d", false, global));
+    std::vector<int> marked = mark_lines(lines, 1, 99999, global, nullptr);
+    REQUIRE(marked.size() == 14285);
+    CHECK(marked.front() == 7);
+    CHECK(marked.back() == 99995);
+    ThreadPool pool(4);
+    CHECK(mark_lines(lines, 1, 99999, global, &pool) == marked);
+
+    SECTION("Inverse") {
+        REQUIRE(parse_global("/DEBUG/d", true, global));
+        std::vector<int> inverse = mark_lines(lines, 0, 99999, global, &pool);
+        CHECK(inverse.size() == 100000 - 14286);
+        CHECK(inverse.front() == 1);
+        CHECK(mark_lines(lines, 0, 99999, global, nullptr) == inverse);
+    }
+    SECTION("Filtered lines are not searched") {
+        // Lines from 50000 on are known not to match
+        LineFilter filter = [](int line, SearchDirection, int &run) {
+            run = line < 50000 ? 50000 - line : 100000 - line;
+            return line < 50000;
+        };
+        std::vector<int> filtered =
+            mark_lines(lines, 0, 99999, global, &pool, filter);
+        CHECK(filtered.back() == 49994);
+        REQUIRE(parse_global("/DEBUG/d", true, global));
+        filtered = mark_lines(lines, 0, 99999, global, nullptr, filter);
+        CHECK(filtered.back() == 99999);
+        CHECK(filtered.size() == 100000 - 7143);
+    }
+}
+
+TEST_CASE("Global marks follow changes", "[global]") {
+    std::vector<std::string> lines;
+    GlobalMarks marks({1, 3, 5, 7, 9});
+    int line = 0;
+    REQUIRE(marks.next(line));
+    CHECK(line == 1);
+    // Lines 2 and 3 are removed, which leaves marks 3, 5 and 7. Line 4 is
+    // changed in place and a line is inserted at 5, which leaves 3, 6 and 8
+    marks.on_change(lines, {2, 2, 0, 1, nullptr});
+    marks.on_change(lines, {4, 1, 1, 2, nullptr});
+    marks.on_change(lines, {5, 0, 1, 3, nullptr});
+    // Rows 4 and 6 of lines 4 to 6 are removed
+    std::vector<int> rows{4, 6};
+    marks.on_change(lines, {4, 3, 1, 4, &rows});
+    REQUIRE(marks.next(line));
+    CHECK(line == 3);
+    REQUIRE(marks.next(line));
+    CHECK(line == 6);
+    CHECK_FALSE(marks.next(line));
+}
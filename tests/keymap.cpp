@@ -0,0 +1,92 @@
+#include "keymap.hpp"
+
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+int get_node(const KeyTrie &trie, const std::vector<int> &keys) {
+    // Walk trie from the root and return the node reached by keys
+    int node = KeyTrie::ROOT;
+    for (int key : keys) {
+        node = trie.get_child(node, key);
+        if (node == -1) {
+            break;
+        }
+    }
+    return node;
+}
+
+TEST_CASE("Keymap parse keys", "[keymap]") {
+    SECTION("Plain characters") {
+        std::vector<int> expected{'d', 'd'};
+        REQUIRE(parse_keys("dd") == expected);
+    }
+    SECTION("Special keys") {
+        std::vector<int> expected{27, 10, ' ', '<', '|', 9};
+        REQUIRE(parse_keys("<Esc><CR><space><lt><Bar><Tab>") == expected);
+    }
+    SECTION("Control keys") {
+        std::vector<int> expected{'f' & 0x1f, 'x'};
+        REQUIRE(parse_keys("<C-f>x") == expected);
+    }
+    SECTION("Unknown notation is kept literally") {
+        std::vector<int> expected{'<', 'f', 'o', 'o', '>'};
+        REQUIRE(parse_keys("<foo>") == expected);
+    }
+}
+
+TEST_CASE("Keymap trie step", "[keymap]") {
+    KeyTrie trie;
+    trie.insert({'g', 'g'}, Binding(Action::FIRST_LINE));
+    int prefix = get_node(trie, {'g'});
+    int node = get_node(trie, {'g', 'g'});
+    REQUIRE(prefix != -1);
+    REQUIRE(node != -1);
+    CHECK(trie.has_children(prefix));
+    CHECK_FALSE(trie.has_children(node));
+    CHECK(trie.get_binding(prefix).action == Action::NONE);
+    CHECK(trie.get_binding(node).action == Action::FIRST_LINE);
+    CHECK(trie.get_child(node, 'g') == -1);
+    CHECK(trie.get_child(KeyTrie::ROOT, 1000) == -1);
+}
+
+TEST_CASE("Keymap default bindings", "[keymap]") {
+    Keymap keymap;
+    const KeyTrie &normal = keymap.get_trie(KeymapMode::NORMAL, false);
+    const KeyTrie &visual = keymap.get_trie(KeymapMode::VISUAL, false);
+    CHECK(normal.get_binding(get_node(normal, {'d', 'd'})).action ==
+          Action::DELETE_LINE);
+    CHECK(visual.get_binding(get_node(visual, {'d'})).action ==
+          Action::DELETE_SELECTION);
+}
+
+TEST_CASE("Keymap map", "[keymap]") {
+    Keymap keymap;
+    SECTION("Recursive mapping in normal mode") {
+        REQUIRE(keymap.map("nmap", "Q <C-f>dd"));
+        const KeyTrie &trie = keymap.get_trie(KeymapMode::NORMAL, false);
+        const Binding &binding = trie.get_binding(get_node(trie, {'Q'}));
+        std::vector<int> expected{'f' & 0x1f, 'd', 'd'};
+        CHECK(binding.action == Action::MAPPING);
+        CHECK(binding.keys == expected);
+        CHECK_FALSE(binding.noremap);
+        // Mapping should not apply to visual mode
+        const KeyTrie &visual = keymap.get_trie(KeymapMode::VISUAL, false);
+        CHECK(get_node(visual, {'Q'}) == -1);
+    }
+    SECTION("Non-recursive mapping leaves default bindings intact") {
+        REQUIRE(keymap.map("noremap", "x dd"));
+        for (KeymapMode mode : {KeymapMode::NORMAL, KeymapMode::VISUAL}) {
+            const KeyTrie &user = keymap.get_trie(mode, false);
+            const KeyTrie &defaults = keymap.get_trie(mode, true);
+            CHECK(user.get_binding(get_node(user, {'x'})).noremap);
+            CHECK(defaults.get_binding(get_node(defaults, {'x'})).action ==
+                  Action::DELETE);
+        }
+    }
+    SECTION("Invalid mappings") {
+        CHECK_FALSE(keymap.map("map", ""));
+        CHECK_FALSE(keymap.map("map", "x"));
+        CHECK_FALSE(keymap.map("map", "x   "));
+    }
+}
@@ -0,0 +1,95 @@
+#include "latency.hpp"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <string>
+
+#include "mode.hpp"
+
+TEST_CASE("LatencyHistogram empty", "[latency]") {
+    LatencyHistogram histogram;
+    CHECK(histogram.get_count() == 0);
+    CHECK(histogram.get_percentile(99) == 0);
+    CHECK(histogram.get_mean() == 0);
+}
+
+TEST_CASE("LatencyHistogram percentiles", "[latency]") {
+    LatencyHistogram histogram;
+    for (long long i = 1; i <= 1000; ++i) {
+        histogram.record(i * 1000);
+    }
+    CHECK(histogram.get_count() == 1000);
+    CHECK(histogram.get_max() == 1000000);
+    CHECK(histogram.get_mean() == 500500);
+    // Values are within the relative error of the buckets
+    long long p50 = histogram.get_percentile(50);
+    CHECK(p50 >= 500000);
+    CHECK(p50 <= 500000 * 1.04);
+    long long p99 = histogram.get_percentile(99);
+    CHECK(p99 >= 990000);
+    CHECK(p99 <= 1000000);
+    CHECK(histogram.get_percentile(100) == 1000000);
+}
+
+TEST_CASE("LatencyHistogram small values are exact", "[latency]") {
+    LatencyHistogram histogram;
+    histogram.record(3);
+    histogram.record(7);
+    CHECK(histogram.get_percentile(50) == 3);
+    CHECK(histogram.get_percentile(100) == 7);
+}
+
+TEST_CASE("LatencyHistogram json", "[latency]") {
+    LatencyHistogram histogram;
+    histogram.record(5);
+    histogram.record(5);
+    CHECK(histogram.to_json() ==
+          "{\"count\":2,\"min_ns\":5,\"max_ns\":5,\"mean_ns\":5,\"p50_ns\":5,"
+          "\"p90_ns\":5,\"p99_ns\":5,\"p999_ns\":5,\"buckets\":[[5,2]]}");
+}
+
+TEST_CASE("Latency key class", "[latency]") {
+    CHECK(get_key_class('a') == KeyClass::CHARACTER);
+    CHECK(get_key_class(6) == KeyClass::CONTROL);
+    CHECK(get_key_class(27) == KeyClass::ESCAPE);
+    CHECK(get_key_class(10) == KeyClass::ENTER);
+    CHECK(get_key_class(127) == KeyClass::BACKSPACE);
+    CHECK(get_key_class(260) == KeyClass::SPECIAL);
+}
+
+TEST_CASE("LatencyRecorder records inputs at the next frame", "[latency]") {
+    LatencyRecorder recorder;
+    LatencyRecorder::Clock::time_point now = LatencyRecorder::Clock::now();
+    recorder.record_input('i', ModeType::NORMAL, now);
+    recorder.record_input('a', ModeType::INSERT, now);
+    recorder.record_frame();
+    recorder.record_frame();
+    recorder.record_update(std::chrono::microseconds(10));
+    std::string summary;
+    REQUIRE(recorder.get_summary("normal", summary));
+    CHECK(summary.substr(0, 9) == "normal 1 ");
+    REQUIRE(recorder.get_summary("character", summary));
+    CHECK(summary.substr(0, 12) == "character 2 ");
+    REQUIRE(recorder.get_summary("update", summary));
+    CHECK(summary.substr(0, 9) == "update 1 ");
+    REQUIRE(recorder.get_summary("", summary));
+    CHECK(summary.substr(0, 7) == "keys 2 ");
+    CHECK_FALSE(recorder.get_summary("unknown", summary));
+    std::string json = recorder.to_json();
+    CHECK(json.find("\"insert\":{\"count\":1,") != std::string::npos);
+    CHECK(json.find("\"visual\":{\"count\":0,") != std::string::npos);
+}
+
+TEST_CASE("LatencyRecorder measures from the time a key was read",
+          "[latency]") {
+    // A key that waited behind other work counts the time it waited
+    LatencyRecorder recorder;
+    recorder.record_input(
+        'x', ModeType::NORMAL,
+        LatencyRecorder::Clock::now() - std::chrono::milliseconds(50));
+    recorder.record_frame();
+    std::string json = recorder.to_json();
+    std::string::size_type max = json.find("\"max_ns\":");
+    REQUIRE(max != std::string::npos);
+    CHECK(std::stoll(json.substr(max + 9)) >= 50000000);
+}
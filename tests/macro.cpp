@@ -0,0 +1,45 @@
+#include "macro.hpp"
+
+#include <catch2/catch.hpp>
+#include <vector>
+
+TEST_CASE("Macro recorder initial construction", "[macro]") {
+    MacroRecorder macro_recorder;
+    CHECK_FALSE(macro_recorder.is_recording());
+    CHECK(macro_recorder.get_last_register() == 0);
+    CHECK(macro_recorder.get_keys('a').empty());
+}
+
+TEST_CASE("Macro recorder invalid register", "[macro]") {
+    MacroRecorder macro_recorder;
+    CHECK_FALSE(macro_recorder.start_recording('!'));
+    CHECK_FALSE(macro_recorder.is_recording());
+    CHECK_FALSE(macro_recorder.set_last_register(27));
+}
+
+TEST_CASE("Macro recorder record", "[macro]") {
+    MacroRecorder macro_recorder;
+    REQUIRE(macro_recorder.start_recording('a'));
+    macro_recorder.record('x');
+    macro_recorder.record('j');
+    macro_recorder.record('q');
+    macro_recorder.drop_last_key();
+    macro_recorder.stop_recording();
+    // Keys should not be recorded after recording has stopped
+    macro_recorder.record('k');
+    std::vector<int> expected{'x', 'j'};
+    REQUIRE(macro_recorder.get_keys('a') == expected);
+}
+
+TEST_CASE("Macro recorder uppercase register appends", "[macro]") {
+    MacroRecorder macro_recorder;
+    macro_recorder.start_recording('a');
+    macro_recorder.record('x');
+    macro_recorder.stop_recording();
+    macro_recorder.start_recording('A');
+    CHECK(macro_recorder.get_recording_register() == 'a');
+    macro_recorder.record('j');
+    macro_recorder.stop_recording();
+    std::vector<int> expected{'x', 'j'};
+    REQUIRE(macro_recorder.get_keys('a') == expected);
+}
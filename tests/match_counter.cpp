@@ -0,0 +1,39 @@
+#include "match_counter.hpp"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+#include "position.hpp"
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+TEST_CASE("Match counter counts matches before the position",
+          "[match_counter]") {
+    std::vector<std::string> lines = {"foo foo", "bar", "foo", "foofoo"};
+    SearchPattern pattern;
+    REQUIRE(pattern.set("foo"));
+    MatchCounter counter(lines, pattern, {2, 0}, nullptr);
+    REQUIRE(counter.run_slice(Job::Clock::now() + std::chrono::seconds(1)));
+    CHECK(counter.get_count() == 5);
+    CHECK(counter.get_index() == 3);
+    CHECK(counter.get_progress() == 1.0);
+}
+
+TEST_CASE("Match counter runs in slices on a pool", "[match_counter]") {
+    std::vector<std::string> lines(100000, "a b a");
+    SearchPattern pattern;
+    REQUIRE(pattern.set("\\va|b"));
+    ThreadPool pool(4);
+    MatchCounter counter(lines, pattern, {50000, 2}, &pool);
+    // A deadline in the past still counts one chunk of lines per slice
+    REQUIRE_FALSE(counter.run_slice(Job::Clock::now()));
+    CHECK(counter.get_progress() > 0.0);
+    CHECK(counter.get_progress() < 1.0);
+    while (!counter.run_slice(Job::Clock::now())) {
+    }
+    CHECK(counter.get_count() == 300000);
+    CHECK(counter.get_index() == 150002);
+}
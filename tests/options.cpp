@@ -93,3 +93,18 @@ TEST_CASE("Options set valid string option", "[options]") {
     std::string value = options.get_string_option("colorscheme");
     REQUIRE(value == expected);
 }
+
+TEST_CASE("Options autosave is disabled by default", "[options]") {
+    Options options;
+    REQUIRE(options.get_int_option("autosave") == 0);
+}
+
+TEST_CASE("Options hlsearch is disabled by default", "[options]") {
+    Options options;
+    REQUIRE_FALSE(options.get_bool_option("hlsearch"));
+}
+
+TEST_CASE("Options trigramindex is disabled by default", "[options]") {
+    Options options;
+    REQUIRE_FALSE(options.get_bool_option("trigramindex"));
+}
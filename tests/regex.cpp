@@ -0,0 +1,242 @@
+#include "regex.hpp"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct Match {
+    bool found;
+    std::size_t start;
+    std::size_t end;
+};
+
+Match find(Regex &regex, const std::string &text, std::size_t start = 0) {
+    Match match{false, 0, 0};
+    match.found = regex.find(text, start, match.start, match.end);
+    return match;
+}
+
+Match rfind(Regex &regex, const std::string &text,
+            std::size_t end = std::string::npos) {
+    Match match{false, 0, 0};
+    match.found = regex.rfind(text, end, match.start, match.end);
+    return match;
+}
+
+bool matches_at(Regex &regex, const std::string &text, std::size_t start,
+                std::size_t end) {
+    Match match = find(regex, text);
+    return match.found && match.start == start && match.end == end;
+}
+
+TEST_CASE("Regex syntax", "[regex]") {
+    Regex regex;
+    SECTION("Literal") {
+        REQUIRE(regex.compile("bar"));
+        CHECK(matches_at(regex, "foo bar", 4, 7));
+        CHECK_FALSE(find(regex, "foo baz").found);
+    }
+    SECTION("Alternation") {
+        REQUIRE(regex.compile("cat|dog"));
+        CHECK(matches_at(regex, "hotdog", 3, 6));
+    }
+    SECTION("Repetition is longest") {
+        REQUIRE(regex.compile("a+"));
+        CHECK(matches_at(regex, "baaab", 1, 4));
+        REQUIRE(regex.compile("ab?c"));
+        CHECK(matches_at(regex, "xac", 1, 3));
+        REQUIRE(regex.compile("ab=c"));
+        CHECK(matches_at(regex, "xabc", 1, 4));
+        REQUIRE(regex.compile("(ab)*c"));
+        CHECK(matches_at(regex, "xababc", 1, 6));
+    }
+    SECTION("Counted repetition") {
+        REQUIRE(regex.compile("a{2}"));
+        CHECK(matches_at(regex, "aaaa", 0, 2));
+        REQUIRE(regex.compile("a{2,3}"));
+        CHECK(matches_at(regex, "baaaa", 1, 4));
+        REQUIRE(regex.compile("ba{,2}"));
+        CHECK(matches_at(regex, "baaa", 0, 3));
+        REQUIRE(regex.compile("a{2,}"));
+        CHECK(matches_at(regex, "aaaaa", 0, 5));
+        CHECK_FALSE(find(regex, "a").found);
+    }
+    SECTION("Classes") {
+        REQUIRE(regex.compile("[a-c]+"));
+        CHECK(matches_at(regex, "xxcab", 2, 5));
+        REQUIRE(regex.compile("[^a-c ]+"));
+        CHECK(matches_at(regex, "ab xyz", 3, 6));
+        REQUIRE(regex.compile("[]]"));
+        CHECK(matches_at(regex, "a]", 1, 2));
+        REQUIRE(regex.compile("\\d+"));
+        CHECK(matches_at(regex, "id 042", 3, 6));
+        REQUIRE(regex.compile("\\w+\\s\\S"));
+        CHECK(matches_at(regex, "-foo_1 x", 1, 8));
+        REQUIRE(regex.compile("[\\d.]+"));
+        CHECK(matches_at(regex, "v1.25", 1, 5));
+    }
+    SECTION("Escaped operators are literal") {
+        REQUIRE(regex.compile("a\\.b\\*"));
+        CHECK(matches_at(regex, "axb a.b*", 4, 8));
+    }
+    SECTION("Anchors") {
+        REQUIRE(regex.compile("^foo"));
+        CHECK(matches_at(regex, "foo foo", 0, 3));
+        CHECK_FALSE(find(regex, "foo foo", 1).found);
+        REQUIRE(regex.compile("foo$"));
+        CHECK(matches_at(regex, "foo foo", 4, 7));
+        REQUIRE(regex.compile("^$"));
+        CHECK(matches_at(regex, "", 0, 0));
+        CHECK_FALSE(find(regex, "a").found);
+    }
+    SECTION("Empty match") {
+        REQUIRE(regex.compile("x*"));
+        CHECK(matches_at(regex, "abc", 0, 0));
+        CHECK(find(regex, "abc", 3).found);
+    }
+}
+
+TEST_CASE("Regex errors", "[regex]") {
+    Regex regex;
+    CHECK_FALSE(regex.compile("(ab"));
+    CHECK(regex.get_error() == "Unmatched (");
+    CHECK_FALSE(regex.compile("ab)"));
+    CHECK(regex.get_error() == "Unmatched )");
+    CHECK_FALSE(regex.compile("[ab"));
+    CHECK(regex.get_error() == "Unmatched [");
+    CHECK_FALSE(regex.compile("*a"));
+    CHECK(regex.get_error() == "Nothing to repeat");
+    CHECK_FALSE(regex.compile("a{3,2}"));
+    CHECK(regex.get_error() == "Invalid repeat count");
+    CHECK(regex.compile("\\<a"));
+    CHECK_FALSE(regex.compile("<a"));
+    CHECK(regex.get_error() == "Unsupported operator: <");
+    CHECK_FALSE(regex.compile("(a{1000}){1000}"));
+    CHECK(regex.get_error() == "Pattern is too large");
+    CHECK_FALSE(regex.compile(std::string(5000, '(')));
+    CHECK_FALSE(find(regex, "a").found);
+}
+
+TEST_CASE("Regex find from a position", "[regex]") {
+    Regex regex;
+    REQUIRE(regex.compile("o+"));
+    std::string text = "foo boo";
+    Match match = find(regex, text, 2);
+    CHECK(match.found);
+    CHECK(match.start == 2);
+    CHECK(match.end == 3);
+    match = find(regex, text, 3);
+    CHECK(match.start == 5);
+    match = rfind(regex, text);
+    CHECK(match.start == 6);
+    CHECK(match.end == 7);
+    match = rfind(regex, text, 5);
+    CHECK(match.start == 2);
+    CHECK(match.end == 3);
+    CHECK_FALSE(rfind(regex, text, 1).found);
+}
+
+TEST_CASE("Regex states are cached", "[regex]") {
+    Regex regex;
+    REQUIRE(regex.compile("[a-z]+[0-9]"));
+    std::string text(1000, 'a');
+    text += '1';
+    REQUIRE(find(regex, text).found);
+    std::size_t state_count = regex.get_state_count();
+    REQUIRE(find(regex, text).found);
+    CHECK(regex.get_state_count() == state_count);
+    // Long lines do not need more states than the pattern
+    CHECK(state_count < 10);
+}
+
+TEST_CASE("Regex matches the longest match at the first start",
+          "[regex]") {
+    // Patterns from a small grammar are checked against std::regex, which
+    // finds the same start but prefers the first alternative over the
+    // longest
+    std::mt19937 generator(0);
+    const std::string ATOMS[] = {"a", "b", ".", "[ab]", "(a|b)", "(ab|a)",
+                                 "(a|ba)"};
+    const std::string OPERATORS[] = {"", "", "*", "+", "?"};
+    for (int i = 0; i < 300; ++i) {
+        std::string pattern;
+        int atom_count = 1 + static_cast<int>(generator() % 4);
+        for (int j = 0; j < atom_count; ++j) {
+            pattern += ATOMS[generator() % 7];
+            pattern += OPERATORS[generator() % 5];
+        }
+        std::string text(generator() % 12, 'a');
+        for (char &c : text) {
+            c = "abc"[generator() % 3];
+        }
+        Regex regex;
+        REQUIRE(regex.compile(pattern));
+        std::regex expected_regex(pattern);
+        std::smatch expected;
+        bool expected_found = std::regex_search(text, expected, expected_regex);
+        Match match = find(regex, text);
+        INFO(pattern << " " << text);
+        REQUIRE(match.found == expected_found);
+        if (!match.found) {
+            continue;
+        }
+        std::size_t start = static_cast<std::size_t>(expected.position(0));
+        CHECK(match.start == start);
+        // The end is the furthest that still matches
+        CHECK(std::regex_match(text.substr(start, match.end - start),
+                               expected_regex));
+        for (std::size_t end = match.end + 1; end <= text.length(); ++end) {
+            CHECK_FALSE(std::regex_match(text.substr(start, end - start),
+                                         expected_regex));
+        }
+    }
+}
+
+TEST_CASE("Regex find all", "[regex]") {
+    Regex regex;
+    std::vector<MatchRange> matches;
+    SECTION("Matches do not overlap") {
+        REQUIRE(regex.compile("aa"));
+        regex.find_all("aaaaa", std::string::npos, matches);
+        std::vector<MatchRange> expected{{0, 2}, {2, 4}};
+        CHECK(matches == expected);
+    }
+    SECTION("Empty matches") {
+        REQUIRE(regex.compile("b*"));
+        regex.find_all("abba", std::string::npos, matches);
+        std::vector<MatchRange> expected{{0, 0}, {1, 3}, {3, 3}, {4, 4}};
+        CHECK(matches == expected);
+    }
+    SECTION("Limit") {
+        REQUIRE(regex.compile("\\d"));
+        regex.find_all("1a2b3", 3, matches);
+        std::vector<MatchRange> expected{{0, 1}, {2, 3}};
+        CHECK(matches == expected);
+    }
+}
+
+TEST_CASE("Regex ignores case", "[regex]") {
+    Regex regex;
+    REQUIRE(regex.compile("a[b-c]\\w", true));
+    CHECK(matches_at(regex, "xAbZ", 1, 4));
+    CHECK(matches_at(regex, "ACc", 0, 3));
+    CHECK_FALSE(find(regex, "ad1").found);
+    REQUIRE(regex.compile("ab"));
+    CHECK_FALSE(find(regex, "AB").found);
+}
+
+TEST_CASE("Regex required literals", "[regex]") {
+    Regex regex;
+    using Literals = std::vector<std::string>;
+    REQUIRE(regex.compile("foo\\d+bar"));
+    CHECK(regex.get_required_literals() == Literals{"foo", "bar"});
+    REQUIRE(regex.compile("^(abc)+x?yz$"));
+    CHECK(regex.get_required_literals() == Literals{"abc", "yz"});
+    REQUIRE(regex.compile("a|b"));
+    CHECK(regex.get_required_literals().empty());
+    REQUIRE(regex.compile("(ab){2}c*d"));
+    CHECK(regex.get_required_literals() == Literals{"ab", "d"});
+}
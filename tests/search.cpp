@@ -0,0 +1,299 @@
+#include "search.hpp"
+
+#include <catch2/catch.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer_observer.hpp"
+#include "position.hpp"
+
+TEST_CASE("Search find literal", "[search]") {
+    std::string haystack = "abcabcabd";
+    SECTION("First occurrence from start") {
+        CHECK(find_literal(haystack, "abc", 0) == 0);
+        CHECK(find_literal(haystack, "abc", 1) == 3);
+        CHECK(find_literal(haystack, "abd", 0) == 6);
+        CHECK(find_literal(haystack, "abc", 4) == std::string::npos);
+    }
+    SECTION("Needle longer than haystack") {
+        CHECK(find_literal("ab", "abc", 0) == std::string::npos);
+    }
+    SECTION("Start past the end") {
+        CHECK(find_literal(haystack, "a", 100) == std::string::npos);
+    }
+    SECTION("Match in the tail of a long haystack") {
+        std::string long_haystack(100, 'x');
+        long_haystack += "needle";
+        CHECK(find_literal(long_haystack, "needle", 0) == 100);
+        CHECK(find_literal(long_haystack, "x", 99) == 99);
+    }
+}
+
+TEST_CASE("Search rfind literal", "[search]") {
+    std::string haystack = "abcabcabd";
+    SECTION("Last occurrence starting before end") {
+        CHECK(rfind_literal(haystack, "abc", std::string::npos) == 3);
+        CHECK(rfind_literal(haystack, "abc", 3) == 0);
+        CHECK(rfind_literal(haystack, "abc", 4) == 3);
+        CHECK(rfind_literal(haystack, "abc", 0) == std::string::npos);
+    }
+    SECTION("Match can extend past end") {
+        CHECK(rfind_literal(haystack, "abd", 7) == 6);
+    }
+    SECTION("Match in the head of a long haystack") {
+        std::string long_haystack = "needle" + std::string(100, 'x');
+        CHECK(rfind_literal(long_haystack, "needle", std::string::npos) == 0);
+    }
+}
+
+TEST_CASE("Search agrees with std::string", "[search]") {
+    // Small alphabet makes partial matches common
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<int> character('a', 'c');
+    for (int i = 0; i < 200; ++i) {
+        std::string haystack(generator() % 200, ' ');
+        for (char &c : haystack) {
+            c = static_cast<char>(character(generator));
+        }
+        std::string needle(1 + generator() % 5, ' ');
+        for (char &c : needle) {
+            c = static_cast<char>(character(generator));
+        }
+        std::size_t position = generator() % (haystack.length() + 1);
+        CHECK(find_literal(haystack, needle, position) ==
+              haystack.find(needle, position));
+        std::size_t expected =
+            position == 0 ? std::string::npos
+                          : haystack.rfind(needle, position - 1);
+        CHECK(rfind_literal(haystack, needle, position) == expected);
+    }
+}
+
+TEST_CASE("Search lines", "[search]") {
+    std::vector<std::string> lines = {"foo bar", "baz", "bar foo"};
+    Position match;
+    bool wrapped = false;
+    SECTION("Forward skips the cursor") {
+        REQUIRE(search_lines(lines, "foo", {0, 0}, SearchDirection::FORWARD,
+                             match, wrapped));
+        CHECK(match == Position(2, 4));
+        CHECK_FALSE(wrapped);
+    }
+    SECTION("Forward wraps around") {
+        REQUIRE(search_lines(lines, "foo", {2, 4}, SearchDirection::FORWARD,
+                             match, wrapped));
+        CHECK(match == Position(0, 0));
+        CHECK(wrapped);
+    }
+    SECTION("Backward") {
+        REQUIRE(search_lines(lines, "ba", {2, 0}, SearchDirection::BACKWARD,
+                             match, wrapped));
+        CHECK(match == Position(1, 0));
+        CHECK_FALSE(wrapped);
+    }
+    SECTION("Backward wraps around") {
+        REQUIRE(search_lines(lines, "bar", {0, 4}, SearchDirection::BACKWARD,
+                             match, wrapped));
+        CHECK(match == Position(2, 0));
+        CHECK(wrapped);
+    }
+    SECTION("Only match is under the cursor") {
+        REQUIRE(search_lines(lines, "baz", {1, 0}, SearchDirection::FORWARD,
+                             match, wrapped));
+        CHECK(match == Position(1, 0));
+        CHECK(wrapped);
+    }
+    SECTION("Not found") {
+        CHECK_FALSE(search_lines(lines, "qux", {0, 0},
+                                 SearchDirection::FORWARD, match, wrapped));
+    }
+}
+
+TEST_CASE("Search line count", "[search]") {
+    std::vector<std::string> lines = {"a", "b", "c", "target"};
+    Position match;
+    bool wrapped = false;
+    CHECK_FALSE(search_lines(lines, "target", {0, 0}, SearchDirection::FORWARD,
+                             match, wrapped, 2));
+    CHECK(search_lines(lines, "target", {0, 0}, SearchDirection::FORWARD,
+                       match, wrapped, 3));
+}
+
+TEST_CASE("Search pattern", "[search]") {
+    SearchPattern pattern;
+    std::size_t start = 0;
+    std::size_t end = 0;
+    SECTION("Literal") {
+        REQUIRE(pattern.set("a.c"));
+        CHECK_FALSE(pattern.find("abc", 0, start, end));
+        REQUIRE(pattern.find("xa.c", 0, start, end));
+        CHECK(start == 1);
+        CHECK(end == 4);
+    }
+    SECTION("Regular expression") {
+        REQUIRE(pattern.set("\\va.c"));
+        REQUIRE(pattern.find("xabc", 0, start, end));
+        CHECK(start == 1);
+        REQUIRE(pattern.rfind("abc adc", std::string::npos, start, end));
+        CHECK(start == 4);
+    }
+    SECTION("Invalid regular expression") {
+        CHECK_FALSE(pattern.set("\\v(a"));
+        CHECK_FALSE(pattern.is_valid());
+        CHECK(pattern.get_error() == "Unmatched (");
+        CHECK_FALSE(pattern.find("a", 0, start, end));
+        REQUIRE(pattern.set("a"));
+        CHECK(pattern.is_valid());
+    }
+    SECTION("Find all") {
+        std::vector<MatchRange> matches;
+        REQUIRE(pattern.set("ab"));
+        pattern.find_all("abab ab", std::string::npos, matches);
+        std::vector<MatchRange> expected{{0, 2}, {2, 4}, {5, 7}};
+        CHECK(matches == expected);
+    }
+}
+
+TEST_CASE("Search match cache", "[search]") {
+    std::vector<std::string> lines = {"foo", "bar foo"};
+    SearchPattern pattern;
+    REQUIRE(pattern.set("foo"));
+    MatchCache cache;
+    std::vector<MatchRange> expected{{4, 7}};
+    CHECK(cache.get_matches(pattern, lines, 0, 1, 10) == expected);
+    SECTION("Kept while the version is the same") {
+        lines[1] = "foo";
+        CHECK(cache.get_matches(pattern, lines, 0, 1, 10) == expected);
+    }
+    SECTION("Dropped when the version changes") {
+        lines[1] = "foo";
+        expected = {{0, 3}};
+        CHECK(cache.get_matches(pattern, lines, 1, 1, 10) == expected);
+    }
+    SECTION("Dropped when the pattern changes") {
+        REQUIRE(pattern.set("bar"));
+        expected = {{0, 3}};
+        CHECK(cache.get_matches(pattern, lines, 0, 1, 10) == expected);
+    }
+    SECTION("Found again for a larger limit") {
+        MatchCache limited_cache;
+        CHECK(limited_cache.get_matches(pattern, lines, 0, 1, 2).empty());
+        CHECK(limited_cache.get_matches(pattern, lines, 0, 1, 10) == expected);
+    }
+    SECTION("Moved when lines are inserted before it") {
+        lines.insert(lines.begin(), "foo foo");
+        cache.on_change(lines, {0, 0, 1, 1, nullptr});
+        // The new line would not match the cached matches of the old line
+        CHECK(cache.get_matches(pattern, lines, 1, 2, 10) == expected);
+        expected = {{0, 3}, {4, 7}};
+        CHECK(cache.get_matches(pattern, lines, 1, 0, 10) == expected);
+    }
+    SECTION("Dropped for a changed line") {
+        lines[1] = "foo";
+        cache.on_change(lines, {1, 1, 1, 1, nullptr});
+        expected = {{0, 3}};
+        CHECK(cache.get_matches(pattern, lines, 1, 1, 10) == expected);
+    }
+    SECTION("Dropped when a change was missed") {
+        lines[1] = "foo";
+        cache.on_change(lines, {0, 1, 1, 2, nullptr});
+        expected = {{0, 3}};
+        CHECK(cache.get_matches(pattern, lines, 2, 1, 10) == expected);
+    }
+}
+
+TEST_CASE("Search lines in parallel", "[search]") {
+    std::vector<std::string> lines(100000, "filler");
+    lines[10] = "needle early";
+    lines[70000] = "late needle";
+    lines[90000] = "needle";
+    SearchPattern pattern;
+    REQUIRE(pattern.set("needle"));
+    ThreadPool pool(4);
+    Position match;
+    bool wrapped = false;
+    SECTION("Forward finds the nearest match") {
+        REQUIRE(search_lines(pool, lines, pattern, {20, 0},
+                             SearchDirection::FORWARD, match, wrapped));
+        CHECK(match == Position(70000, 5));
+        CHECK_FALSE(wrapped);
+    }
+    SECTION("Forward wraps around") {
+        REQUIRE(search_lines(pool, lines, pattern, {95000, 0},
+                             SearchDirection::FORWARD, match, wrapped));
+        CHECK(match == Position(10, 0));
+        CHECK(wrapped);
+    }
+    SECTION("Backward") {
+        REQUIRE(search_lines(pool, lines, pattern, {80000, 0},
+                             SearchDirection::BACKWARD, match, wrapped));
+        CHECK(match == Position(70000, 5));
+        CHECK_FALSE(wrapped);
+    }
+    SECTION("Agrees with the serial search") {
+        Position expected;
+        bool expected_wrapped = false;
+        for (int y : {0, 10, 50000, 70000, 99999}) {
+            for (SearchDirection direction :
+                 {SearchDirection::FORWARD, SearchDirection::BACKWARD}) {
+                REQUIRE(search_lines(lines, pattern, {y, 0}, direction,
+                                     expected, expected_wrapped));
+                REQUIRE(search_lines(pool, lines, pattern, {y, 0}, direction,
+                                     match, wrapped));
+                CHECK(match == expected);
+                CHECK(wrapped == expected_wrapped);
+            }
+        }
+    }
+    SECTION("Not found") {
+        REQUIRE(pattern.set("missing"));
+        CHECK_FALSE(search_lines(pool, lines, pattern, {0, 0},
+                                 SearchDirection::FORWARD, match, wrapped));
+    }
+}
+
+TEST_CASE("Search lines skips filtered lines", "[search]") {
+    std::vector<std::string> lines(100, "needle");
+    SearchPattern pattern;
+    REQUIRE(pattern.set("needle"));
+    // Blocks of ten lines, only lines from 50 to 59 may match
+    int calls = 0;
+    LineFilter filter = [&calls](int line, SearchDirection direction,
+                                 int &run) {
+        ++calls;
+        run = direction == SearchDirection::FORWARD ? 10 - line % 10
+                                                    : line % 10 + 1;
+        return line / 10 == 5;
+    };
+    Position match;
+    bool wrapped = false;
+    SECTION("Forward") {
+        REQUIRE(search_lines(lines, pattern, {12, 0}, SearchDirection::FORWARD,
+                             match, wrapped, -1, filter));
+        CHECK(match == Position(50, 0));
+        CHECK(calls == 5);
+    }
+    SECTION("Backward wraps around") {
+        REQUIRE(search_lines(lines, pattern, {42, 0},
+                             SearchDirection::BACKWARD, match, wrapped, -1,
+                             filter));
+        CHECK(match == Position(59, 0));
+        CHECK(wrapped);
+    }
+    SECTION("In parallel") {
+        ThreadPool pool(4);
+        REQUIRE(search_lines(pool, lines, pattern, {77, 0},
+                             SearchDirection::FORWARD, match, wrapped,
+                             filter));
+        CHECK(match == Position(50, 0));
+        CHECK(wrapped);
+    }
+    SECTION("Pattern literals") {
+        CHECK(pattern.get_required_literals() ==
+              std::vector<std::string>{"needle"});
+        REQUIRE(pattern.set("\\vne+dle"));
+        CHECK(pattern.get_required_literals() ==
+              std::vector<std::string>{"n", "e", "dle"});
+    }
+}
@@ -0,0 +1,122 @@
+#include "shell_filter.hpp"
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+namespace {
+void run_filter(ShellFilter &filter) {
+    while (!filter.run_slice(Job::Clock::now())) {
+    }
+}
+}  // namespace
+
+TEST_CASE("ShellFilter filters lines", "[shell_filter]") {
+    std::vector<std::string> lines{"b", "c", "a", "d"};
+    SECTION("Range") {
+        ShellFilter filter("sort", lines, 0, 2);
+        run_filter(filter);
+        REQUIRE_FALSE(filter.has_failed());
+        CHECK(filter.get_output() == std::vector<std::string>{"a", "b", "c"});
+        CHECK(filter.get_progress() == 1.0);
+    }
+    SECTION("Without input") {
+        ShellFilter filter("printf 'x\\ny'", lines, 0, -1);
+        run_filter(filter);
+        REQUIRE_FALSE(filter.has_failed());
+        CHECK(filter.get_output() == std::vector<std::string>{"x", "y"});
+    }
+    SECTION("Empty lines") {
+        std::vector<std::string> empty_lines{"", "a", ""};
+        ShellFilter filter("cat", empty_lines, 0, 2);
+        run_filter(filter);
+        CHECK(filter.get_output() == empty_lines);
+    }
+    SECTION("Empty lines among many lines") {
+        // Empty lines take a single vector of a write and other lines two
+        std::vector<std::string> many_lines(2000, "line");
+        many_lines[0] = "";
+        many_lines[1500] = "";
+        ShellFilter filter("cat", many_lines, 0, 1999);
+        run_filter(filter);
+        REQUIRE_FALSE(filter.has_failed());
+        CHECK(filter.get_output() == many_lines);
+    }
+    SECTION("Command that does not read its input") {
+        std::vector<std::string> many_lines(100000, "line");
+        ShellFilter filter("echo done", many_lines, 0, 99999);
+        run_filter(filter);
+        REQUIRE_FALSE(filter.has_failed());
+        CHECK(filter.get_output() == std::vector<std::string>{"done"});
+    }
+}
+
+TEST_CASE("ShellFilter does not wait on a full pipe", "[shell_filter]") {
+    // Input and output are both larger than a pipe, so they must be handled
+    // at the same time
+    std::vector<std::string> lines(200000, std::string(50, 'x'));
+    lines[1000] = "y";
+    ShellFilter filter("cat", lines, 0, 199999);
+    run_filter(filter);
+    REQUIRE_FALSE(filter.has_failed());
+    CHECK(filter.get_output() == lines);
+}
+
+TEST_CASE("ShellFilter writes input after the output is closed",
+          "[shell_filter]") {
+    char path_template[] = "/tmp/claditor_shell_filter_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::vector<std::string> lines(200000, "line");
+    ShellFilter filter("exec >/dev/null 2>&1; cat > " + path, lines, 0,
+                       199999);
+    run_filter(filter);
+    REQUIRE_FALSE(filter.has_failed());
+    CHECK(filter.get_output().empty());
+    std::ifstream file(path);
+    std::size_t count = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        ++count;
+    }
+    CHECK(count == lines.size());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("ShellFilter errors", "[shell_filter]") {
+    std::vector<std::string> lines{"a"};
+    SECTION("Exit status") {
+        ShellFilter filter("echo error; exit 3", lines, 0, 0);
+        run_filter(filter);
+        CHECK(filter.has_failed());
+        CHECK(filter.get_error() == "Shell returned 3");
+        CHECK(filter.get_output() == std::vector<std::string>{"error"});
+    }
+    SECTION("Cancelled") {
+        ShellFilter filter("sleep 10", lines, 0, 0);
+        REQUIRE_FALSE(filter.run_slice(Job::Clock::now()));
+        filter.cancel();
+        CHECK(filter.run_slice(Job::Clock::now()));
+    }
+    SECTION("Cancelled after the output is closed") {
+        // The command is not waited on past the deadline
+        ShellFilter filter("exec >/dev/null 2>&1; sleep 10", lines, 0, 0);
+        Job::Clock::time_point start = Job::Clock::now();
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE_FALSE(filter.run_slice(Job::Clock::now() +
+                                           std::chrono::milliseconds(10)));
+        }
+        filter.cancel();
+        CHECK(Job::Clock::now() - start < std::chrono::seconds(5));
+    }
+}
@@ -0,0 +1,130 @@
+#include "sort.hpp"
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+std::vector<std::string> get_sorted(const std::vector<std::string> &lines,
+                                    const std::string &flags) {
+    Sort sort;
+    REQUIRE(parse_sort(flags, sort));
+    std::vector<std::string> sorted;
+    for (int row : sort_lines(lines, 0, static_cast<int>(lines.size()) - 1,
+                              sort, nullptr)) {
+        sorted.push_back(lines[row]);
+    }
+    return sorted;
+}
+}  // namespace
+
+TEST_CASE("Sort parse", "[sort]") {
+    Sort sort;
+    REQUIRE(parse_sort("n u", sort));
+    CHECK(sort.numeric);
+    CHECK(sort.unique);
+    CHECK_FALSE(sort.reverse);
+    CHECK_FALSE(sort.ignore_case);
+    REQUIRE(parse_sort("ri", sort));
+    CHECK(sort.reverse);
+    CHECK(sort.ignore_case);
+    CHECK_FALSE(sort.numeric);
+    REQUIRE(parse_sort("", sort));
+    CHECK_FALSE(parse_sort("x", sort));
+}
+
+TEST_CASE("Sort lines", "[sort]") {
+    std::vector<std::string> lines{"b", "B", "a", "c", "a", "A"};
+    SECTION("Bytes") {
+        std::vector<std::string> expected{"A", "B", "a", "a", "b", "c"};
+        CHECK(get_sorted(lines, "") == expected);
+    }
+    SECTION("Ignore case keeps the order of equal lines") {
+        std::vector<std::string> expected{"a", "a", "A", "b", "B", "c"};
+        CHECK(get_sorted(lines, "i") == expected);
+    }
+    SECTION("Reverse") {
+        std::vector<std::string> expected{"c", "b", "a", "a", "B", "A"};
+        CHECK(get_sorted(lines, "r") == expected);
+    }
+    SECTION("Unique") {
+        std::vector<std::string> expected{"A", "B", "a", "b", "c"};
+        CHECK(get_sorted(lines, "u") == expected);
+        expected = {"a", "b", "c"};
+        CHECK(get_sorted(lines, "ui") == expected);
+    }
+    SECTION("Range") {
+        Sort sort;
+        std::vector<int> expected{5, 4, 3};
+        CHECK(sort_lines(lines, 3, 5, sort, nullptr) == expected);
+    }
+}
+
+TEST_CASE("Sort numbers", "[sort]") {
+    std::vector<std::string> lines{"x10", "none", "-3 y", "x2",
+                                   "z", "a-1b", "2 again"};
+    SECTION("Lines without a number come first") {
+        std::vector<std::string> expected{"none", "z", "-3 y", "a-1b",
+                                          "x2", "2 again", "x10"};
+        CHECK(get_sorted(lines, "n") == expected);
+    }
+    SECTION("Unique numbers") {
+        std::vector<std::string> expected{"none", "-3 y", "a-1b", "x2", "x10"};
+        CHECK(get_sorted(lines, "nu") == expected);
+    }
+    SECTION("Reverse") {
+        std::vector<std::string> expected{"x10", "x2", "2 again", "a-1b",
+                                          "-3 y", "none", "z"};
+        CHECK(get_sorted(lines, "nr") == expected);
+    }
+}
+
+TEST_CASE("Sort lines in parallel", "[sort]") {
+    // Results of the pool are the same as a stable sort of the lines
+    std::vector<std::string> lines;
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> distribution(0, 50000);
+    for (int i = 0; i < 300000; ++i) {
+        lines.push_back("id " + std::to_string(distribution(generator)));
+    }
+    ThreadPool pool(4);
+    for (const char *flags : {"", "n", "nu", "r"}) {
+        Sort sort;
+        REQUIRE(parse_sort(flags, sort));
+        int last = static_cast<int>(lines.size()) - 1;
+        CHECK(sort_lines(lines, 5, last, sort, &pool) ==
+              sort_lines(lines, 5, last, sort, nullptr));
+    }
+    Sort sort;
+    std::vector<int> rows =
+        sort_lines(lines, 0, static_cast<int>(lines.size()) - 1, sort, &pool);
+    CHECK(std::is_sorted(rows.begin(), rows.end(), [&lines](int a, int b) {
+        return lines[a] < lines[b] || (lines[a] == lines[b] && a < b);
+    }));
+}
+
+TEST_CASE("Sort job runs in slices", "[sort]") {
+    std::vector<std::string> lines;
+    for (int i = 300000; i > 0; --i) {
+        lines.push_back(std::to_string(i));
+    }
+    Sort sort;
+    REQUIRE(parse_sort("n", sort));
+    int last = static_cast<int>(lines.size()) - 1;
+    SortJob job(lines, 0, last, sort, nullptr);
+    int slices = 1;
+    // A deadline in the past handles a single chunk per slice
+    while (!job.run_slice(Job::Clock::now())) {
+        CHECK(job.get_progress() < 1.0);
+        ++slices;
+    }
+    CHECK(slices > 1);
+    CHECK(job.get_progress() == 1.0);
+    CHECK(job.get_rows() == sort_lines(lines, 0, last, sort, nullptr));
+    CHECK(job.get_rows().front() == last);
+}
@@ -0,0 +1,113 @@
+#include "stream_editor.hpp"
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+std::string get_stream_result(const std::string &commands,
+                              const std::string &input) {
+    StreamEditor stream_editor;
+    REQUIRE(stream_editor.set_commands(commands));
+    std::stringstream input_stream(input);
+    std::stringstream output_stream;
+    stream_editor.run(input_stream, output_stream);
+    return output_stream.str();
+}
+
+TEST_CASE("StreamEditor delete", "[stream_editor]") {
+    std::string input = "a\nb\nc\nd\n";
+    CHECK(get_stream_result("2d", input) == "a\nc\nd\n");
+    CHECK(get_stream_result("2,3d", input) == "a\nd\n");
+    CHECK(get_stream_result("3,$d", input) == "a\nb\n");
+    CHECK(get_stream_result("$d", input) == "a\nb\nc\n");
+    CHECK(get_stream_result("%d", input).empty());
+}
+
+TEST_CASE("StreamEditor substitute", "[stream_editor]") {
+    std::string input = "foo foo\nbar\nfoo\n";
+    CHECK(get_stream_result("%s/foo/x/", input) == "x foo\nbar\nx\n");
+    CHECK(get_stream_result("1s/foo/x/g", input) == "x x\nbar\nfoo\n");
+    CHECK(get_stream_result("$s/foo/x/", input) == "foo foo\nbar\nx\n");
+}
+
+TEST_CASE("StreamEditor append", "[stream_editor]") {
+    std::string input = "a\nb\n";
+    CHECK(get_stream_result("1a x", input) == "a\nx\nb\n");
+    CHECK(get_stream_result("$a x", input) == "a\nb\nx\n");
+    CHECK(get_stream_result("0a x", input) == "x\na\nb\n");
+    CHECK(get_stream_result("$a x", "") == "x\n");
+}
+
+TEST_CASE("StreamEditor commands run one after another", "[stream_editor]") {
+    // Line numbers of later commands refer to the result of earlier commands
+    std::string input = "a\nb\nc\nd\n";
+    CHECK(get_stream_result("1d | 1d", input) == "c\nd\n");
+    CHECK(get_stream_result("$a e | $d | 1s/a/x/", input) ==
+          "x\nb\nc\nd\n");
+}
+
+TEST_CASE("StreamEditor keeps a missing trailing newline",
+          "[stream_editor]") {
+    CHECK(get_stream_result("1s/a/x/", "a\nb") == "x\nb");
+    CHECK(get_stream_result("$s/b/x/", "a\nb") == "a\nx");
+    CHECK(get_stream_result("$d", "a\nb") == "a");
+    CHECK(get_stream_result("$a x", "a") == "a\nx");
+    CHECK(get_stream_result("1s/a/x/", "a\n\n") == "x\n\n");
+}
+
+TEST_CASE("StreamEditor errors", "[stream_editor]") {
+    StreamEditor stream_editor;
+    CHECK_FALSE(stream_editor.set_commands("d"));
+    CHECK_FALSE(stream_editor.set_commands("w"));
+    CHECK_FALSE(stream_editor.set_commands("0d"));
+    CHECK_FALSE(stream_editor.set_commands("foo"));
+    CHECK_FALSE(stream_editor.set_commands("/a/,$d"));
+    CHECK(stream_editor.get_error() == "Cannot stream range: d");
+    CHECK_FALSE(stream_editor.set_commands("1,$m0"));
+    CHECK_FALSE(stream_editor.set_commands("%!sort"));
+    CHECK(stream_editor.get_error() == "Cannot stream command: !");
+    CHECK_FALSE(stream_editor.set_commands("%s/a/b/c"));
+    CHECK(stream_editor.get_error() ==
+          "Cannot confirm substitutions when streaming");
+    REQUIRE(stream_editor.set_commands("5d"));
+    std::stringstream input_stream("a\n");
+    std::stringstream output_stream;
+    CHECK_FALSE(stream_editor.run(input_stream, output_stream));
+    CHECK(stream_editor.get_error() == "Invalid range");
+    REQUIRE(stream_editor.set_commands("1s/z/y/"));
+    input_stream.clear();
+    input_stream.str("a\n");
+    CHECK_FALSE(stream_editor.run(input_stream, output_stream));
+    CHECK(stream_editor.get_error() == "Pattern not found: z");
+}
+
+TEST_CASE("StreamEditor edit file", "[stream_editor]") {
+    char path_template[] = "/tmp/claditor_stream_editor_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::ofstream(path) << "a\nb\nc\n";
+    StreamEditor stream_editor;
+    SECTION("Result replaces the file") {
+        REQUIRE(stream_editor.set_commands("2d"));
+        CHECK(stream_editor.edit_file(path));
+        std::ifstream file(path);
+        CHECK(std::string(std::istreambuf_iterator<char>(file), {}) ==
+              "a\nc\n");
+    }
+    SECTION("File is left untouched when a command fails") {
+        REQUIRE(stream_editor.set_commands("2,5d"));
+        CHECK_FALSE(stream_editor.edit_file(path));
+        CHECK(stream_editor.get_error() == "Invalid range");
+        std::ifstream file(path);
+        CHECK(std::string(std::istreambuf_iterator<char>(file), {}) ==
+              "a\nb\nc\n");
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,141 @@
+#include "substitution.hpp"
+
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+TEST_CASE("Substitution parse", "[substitution]") {
+    Substitution substitution;
+    SECTION("Pattern and replacement") {
+        REQUIRE(parse_substitution("/foo/bar/", substitution));
+        CHECK(substitution.pattern == "foo");
+        CHECK(substitution.replacement == "bar");
+        CHECK_FALSE(substitution.global);
+    }
+    SECTION("Global flag without trailing delimiter") {
+        REQUIRE(parse_substitution("#a#b#g", substitution));
+        CHECK(substitution.global);
+        REQUIRE(parse_substitution("#a#b", substitution));
+        CHECK_FALSE(substitution.global);
+    }
+    SECTION("Escaped delimiter") {
+        REQUIRE(parse_substitution("/a\\/b/c\\/d/", substitution));
+        CHECK(substitution.pattern == "a/b");
+        CHECK(substitution.replacement == "c/d");
+    }
+    SECTION("Empty replacement") {
+        REQUIRE(parse_substitution("/foo", substitution));
+        CHECK(substitution.replacement.empty());
+    }
+    SECTION("Flags") {
+        REQUIRE(parse_substitution("/a/b/gci", substitution));
+        CHECK(substitution.global);
+        CHECK(substitution.confirm);
+        CHECK(substitution.ignore_case);
+    }
+    SECTION("Invalid") {
+        CHECK_FALSE(parse_substitution("", substitution));
+        CHECK_FALSE(parse_substitution("/\\v(a/b/", substitution));
+        CHECK_FALSE(substitution.search_pattern.is_valid());
+        CHECK_FALSE(parse_substitution("//bar/", substitution));
+        CHECK_FALSE(parse_substitution("/foo/bar/x", substitution));
+    }
+}
+
+TEST_CASE("Substitution substitute", "[substitution]") {
+    Substitution substitution;
+    substitution.pattern = "ab";
+    substitution.replacement = "x";
+    std::string line = "abcabab";
+    SECTION("First match") {
+        CHECK(substitute(line, substitution) == 1);
+        CHECK(line == "xcabab");
+    }
+    SECTION("Every match") {
+        substitution.global = true;
+        CHECK(substitute(line, substitution) == 3);
+        CHECK(line == "xcxx");
+    }
+    SECTION("No match") {
+        substitution.pattern = "z";
+        CHECK(substitute(line, substitution) == 0);
+        CHECK(line == "abcabab");
+    }
+}
+
+TEST_CASE("Substitution replacement", "[substitution]") {
+    Substitution substitution;
+    std::string line = "foo bar";
+    SECTION("Match is inserted") {
+        REQUIRE(parse_substitution("/bar/[&|\\0]/", substitution));
+        CHECK(substitute(line, substitution) == 1);
+        CHECK(line == "foo [bar|bar]");
+    }
+    SECTION("Escaped characters are inserted") {
+        REQUIRE(parse_substitution("/bar/\\&\\\\", substitution));
+        CHECK(substitute(line, substitution) == 1);
+        CHECK(line == "foo &\\");
+    }
+    SECTION("Regular expression") {
+        REQUIRE(parse_substitution("/\\v[a-z]+/<&>/g", substitution));
+        CHECK(substitute(line, substitution) == 2);
+        CHECK(line == "<foo> <bar>");
+    }
+    SECTION("Ignore case") {
+        line = "Foo FOO foo";
+        REQUIRE(parse_substitution("/foo/x/gi", substitution));
+        CHECK(substitute(line, substitution) == 3);
+        CHECK(line == "x x x");
+        line = "a.b aXb";
+        REQUIRE(parse_substitution("/A.B/x/gi", substitution));
+        CHECK(substitute(line, substitution) == 1);
+        CHECK(line == "x aXb");
+    }
+    SECTION("Empty matches") {
+        REQUIRE(parse_substitution("/\\vx*/-/g", substitution));
+        CHECK(substitute(line, substitution) == 8);
+        CHECK(line == "-f-o-o- -b-a-r-");
+        line = "axxb";
+        CHECK(substitute(line, substitution) == 3);
+        CHECK(line == "-a-b-");
+    }
+    SECTION("Many matches in a long line") {
+        // Matches are found by one scan of the line instead of one per match
+        line.clear();
+        std::string expected;
+        for (int i = 0; i < 20000; ++i) {
+            line += "ab ";
+            expected += "x ";
+        }
+        REQUIRE(parse_substitution("/\\v[ab]+/x/g", substitution));
+        CHECK(substitute(line, substitution) == 20000);
+        CHECK(line == expected);
+    }
+}
+
+TEST_CASE("Substitution of lines", "[substitution]") {
+    std::vector<std::string> lines;
+    for (int i = 0; i < 100000; ++i) {
+        lines.push_back(i % 3 == 0 ? "foo " + std::to_string(i) : "bar");
+    }
+    Substitution substitution;
+    REQUIRE(parse_substitution("/\\vfoo (\\d+)/&&/", substitution));
+    std::vector<std::string> pool_lines = lines;
+    int match_count = 0;
+    std::vector<int> changed =
+        substitute_lines(lines, 1, 99999, substitution, nullptr, match_count);
+    REQUIRE(changed.size() == 33333);
+    CHECK(match_count == 33333);
+    CHECK(changed.front() == 3);
+    CHECK(changed.back() == 99999);
+    CHECK(lines[0] == "foo 0");
+    CHECK(lines[3] == "foo 3foo 3");
+    ThreadPool pool(4);
+    int pool_match_count = 0;
+    CHECK(substitute_lines(pool_lines, 1, 99999, substitution, &pool,
+                           pool_match_count) == changed);
+    CHECK(pool_match_count == match_count);
+    CHECK(pool_lines == lines);
+}
@@ -0,0 +1,52 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <vector>
+
+TEST_CASE("ThreadPool runs every task", "[thread_pool]") {
+    ThreadPool thread_pool(4);
+    std::vector<int> results(1000, 0);
+    for (int i = 0; i < static_cast<int>(results.size()); ++i) {
+        thread_pool.submit([&results, i] { results[i] = i; });
+    }
+    thread_pool.wait();
+    for (int i = 0; i < static_cast<int>(results.size()); ++i) {
+        REQUIRE(results[i] == i);
+    }
+}
+
+TEST_CASE("ThreadPool runs tasks submitted by tasks", "[thread_pool]") {
+    ThreadPool thread_pool(3);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 10; ++i) {
+        thread_pool.submit([&thread_pool, &count] {
+            for (int j = 0; j < 10; ++j) {
+                thread_pool.submit([&count] { ++count; });
+            }
+            ++count;
+        });
+    }
+    thread_pool.wait();
+    REQUIRE(count == 110);
+}
+
+TEST_CASE("ThreadPool can be reused after waiting", "[thread_pool]") {
+    ThreadPool thread_pool(1);
+    REQUIRE(thread_pool.get_thread_count() == 1);
+    std::atomic<int> count(0);
+    thread_pool.wait();
+    for (int round = 1; round <= 3; ++round) {
+        for (int i = 0; i < 5; ++i) {
+            thread_pool.submit([&count] { ++count; });
+        }
+        thread_pool.wait();
+        REQUIRE(count == round * 5);
+    }
+}
+
+TEST_CASE("ThreadPool has at least one thread", "[thread_pool]") {
+    ThreadPool thread_pool(0);
+    REQUIRE(thread_pool.get_thread_count() == 1);
+    REQUIRE(ThreadPool::get_default_thread_count() >= 1);
+}
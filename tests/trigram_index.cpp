@@ -0,0 +1,252 @@
+#include "trigram_index.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "job.hpp"
+
+namespace {
+std::vector<std::string> get_numbered_lines(int count) {
+    std::vector<std::string> lines;
+    for (int i = 0; i < count; ++i) {
+        lines.push_back("line " + std::to_string(i) + " lorem ipsum");
+    }
+    return lines;
+}
+
+void check_no_missed_lines(const TrigramIndex &index,
+                           const std::vector<std::string> &lines,
+                           const std::string &literal) {
+    // Every line that contains the literal must be in a block that may match
+    TrigramQuery query = TrigramIndex::get_query({literal});
+    int missed = 0;
+    for (int line = 0; line < static_cast<int>(lines.size()); ++line) {
+        int run = 0;
+        bool may_match = index.may_match(query, line, true, run);
+        if ((!may_match &&
+             lines[line].find(literal) != std::string::npos) ||
+            run < 1) {
+            ++missed;
+        }
+    }
+    CHECK(missed == 0);
+}
+}  // namespace
+
+TEST_CASE("Trigram index skips blocks without the literal",
+          "[trigram_index]") {
+    std::vector<std::string> lines = get_numbered_lines(10000);
+    TrigramIndex index;
+    index.reset(lines);
+    // A deadline in the past indexes a single block per call
+    REQUIRE_FALSE(index.build(lines, Job::Clock::now()));
+    CHECK(index.get_progress() > 0.0);
+    CHECK(index.get_progress() < 1.0);
+    while (!index.build(lines, Job::Clock::now())) {
+    }
+    CHECK(index.is_complete());
+    CHECK(index.get_memory_usage() > 0);
+    TrigramQuery query = TrigramIndex::get_query({"line 9876 "});
+    int skipped = 0;
+    int run = 0;
+    for (int line = 0; line < 10000; line += run) {
+        if (!index.may_match(query, line, true, run)) {
+            skipped += run;
+        }
+    }
+    CHECK(skipped > 9000);
+    check_no_missed_lines(index, lines, "line 9876 ");
+}
+
+TEST_CASE("Trigram index runs", "[trigram_index]") {
+    std::vector<std::string> lines = get_numbered_lines(1000);
+    TrigramIndex index;
+    index.reset(lines);
+    TrigramQuery query = TrigramIndex::get_query({"line 500 "});
+    int run = 0;
+    SECTION("Lines that are not indexed may match") {
+        CHECK(index.may_match(query, 10, true, run));
+        CHECK(run == 990);
+        CHECK(index.may_match(query, 10, false, run));
+        CHECK(run == 11);
+    }
+    SECTION("Runs end at the block") {
+        index.build(lines, Job::Clock::time_point::max());
+        int forward_run = 0;
+        int backward_run = 0;
+        index.may_match(query, 500, true, forward_run);
+        index.may_match(query, 500, false, backward_run);
+        // Both runs include the line
+        int block_lines = forward_run + backward_run - 1;
+        CHECK(block_lines > 1);
+        CHECK(block_lines < 1000);
+        CHECK(index.may_match(query, 500 + forward_run - 1, false, run));
+        CHECK(run == block_lines);
+    }
+    SECTION("Short literals match every line") {
+        index.build(lines, Job::Clock::time_point::max());
+        CHECK(TrigramIndex::get_query({"ab", ""}).empty());
+        CHECK(index.may_match({}, 0, true, run));
+        CHECK(run == 1000);
+    }
+}
+
+TEST_CASE("Trigram index follows edits", "[trigram_index]") {
+    std::vector<std::string> lines = get_numbered_lines(5000);
+    TrigramIndex index;
+    index.reset(lines);
+    index.build(lines, Job::Clock::time_point::max());
+    std::mt19937 generator(42);
+    for (int i = 0; i < 300; ++i) {
+        int size = static_cast<int>(lines.size());
+        int row = std::uniform_int_distribution<int>(0, size - 1)(generator);
+        switch (i % 4) {
+            case 0:
+                lines[row] += " needle";
+                index.change_line(lines, row);
+                break;
+            case 1: {
+                int count =
+                    std::uniform_int_distribution<int>(1, 200)(generator);
+                lines.insert(lines.begin() + row, count, "inserted needle");
+                index.insert_lines(lines, row, count);
+            } break;
+            case 2: {
+                if (i % 8 == 6) {
+                    // Every other line of a range is removed at once
+                    std::vector<int> rows;
+                    for (int j = row; j < size && rows.size() < 400;
+                         j += 2) {
+                        rows.push_back(j);
+                    }
+                    if (static_cast<int>(rows.size()) == size) {
+                        rows.pop_back();
+                    }
+                    for (std::size_t j = rows.size(); j-- > 0;) {
+                        lines.erase(lines.begin() + rows[j]);
+                    }
+                    index.remove_lines(rows);
+                    break;
+                }
+                int count = std::min(
+                    size - 1,
+                    std::uniform_int_distribution<int>(1, 300)(generator));
+                row = std::min(row, size - count);
+                lines.erase(lines.begin() + row,
+                            lines.begin() + row + count);
+                index.remove_lines(row, count);
+            } break;
+            default:
+                lines.push_back("appended needle");
+                index.insert_lines(lines, size, 1);
+                break;
+        }
+        check_no_missed_lines(index, lines, "needle");
+    }
+    CHECK(index.is_complete());
+    int run = 0;
+    int total = 0;
+    for (int line = 0; line < static_cast<int>(lines.size()); line += run) {
+        index.may_match({}, line, true, run);
+        total += run;
+    }
+    CHECK(total == static_cast<int>(lines.size()));
+}
+
+TEST_CASE("Trigram index follows edits while it is built",
+          "[trigram_index]") {
+    std::vector<std::string> lines = get_numbered_lines(5000);
+    TrigramIndex index;
+    index.reset(lines);
+    index.build(lines, Job::Clock::now());
+    lines.insert(lines.begin() + 4000, "inserted needle");
+    index.insert_lines(lines, 4000, 1);
+    lines.erase(lines.begin() + 3000, lines.begin() + 3100);
+    index.remove_lines(3000, 100);
+    // Both indexed and pending lines are removed
+    std::vector<int> rows{5, 6, 2000, 4500};
+    for (std::size_t i = rows.size(); i-- > 0;) {
+        lines.erase(lines.begin() + rows[i]);
+    }
+    index.remove_lines(rows);
+    lines[10] += " needle";
+    index.change_line(lines, 10);
+    while (!index.build(lines, Job::Clock::now())) {
+    }
+    check_no_missed_lines(index, lines, "needle");
+    check_no_missed_lines(index, lines, "line 4500 ");
+}
+
+TEST_CASE("Trigram index is saved next to the file", "[trigram_index]") {
+    CHECK(TrigramIndex::get_index_path("dir/file.txt") ==
+          "dir/.file.txt.trigrams");
+    CHECK(TrigramIndex::get_index_path("file") == ".file.trigrams");
+
+    char path_template[] = "/tmp/claditor_trigram_index_XXXXXX";
+    int fd = mkstemp(path_template);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::string path = path_template;
+    std::string index_path = TrigramIndex::get_index_path(path);
+    std::vector<std::string> lines = get_numbered_lines(2000);
+    TrigramIndex index;
+    index.reset(lines);
+    // Incomplete indexes are not saved
+    CHECK_FALSE(index.save(index_path, path));
+    index.build(lines, Job::Clock::time_point::max());
+    REQUIRE(index.save(index_path, path));
+
+    TrigramIndex loaded;
+    SECTION("Loaded index matches the saved index") {
+        REQUIRE(loaded.load(index_path, path, lines));
+        CHECK(loaded.is_complete());
+        TrigramQuery query = TrigramIndex::get_query({"line 1234 "});
+        int differences = 0;
+        for (int line = 0; line < 2000; ++line) {
+            int run = 0;
+            int loaded_run = 0;
+            if (index.may_match(query, line, true, run) !=
+                    loaded.may_match(query, line, true, loaded_run) ||
+                run != loaded_run) {
+                ++differences;
+            }
+        }
+        CHECK(differences == 0);
+    }
+    SECTION("Index of different lines is not loaded") {
+        lines.pop_back();
+        CHECK_FALSE(loaded.load(index_path, path, lines));
+    }
+    SECTION("Index of a changed file is not loaded") {
+        std::ofstream file(path, std::ios::app);
+        file << "changed\n";
+        file.close();
+        CHECK_FALSE(loaded.load(index_path, path, lines));
+    }
+    SECTION("Index with blocks below the minimum size is not loaded") {
+        // Block size follows the magic, the file state and the line count
+        std::fstream file(index_path,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8 + 3 * sizeof(std::int64_t));
+        std::uint64_t block_bytes = 0;
+        file.write(reinterpret_cast<const char *>(&block_bytes),
+                   sizeof(block_bytes));
+        file.close();
+        CHECK_FALSE(loaded.load(index_path, path, lines));
+    }
+    SECTION("Missing index is not loaded") {
+        std::remove(index_path.c_str());
+        CHECK_FALSE(loaded.load(index_path, path, lines));
+    }
+    std::remove(index_path.c_str());
+    std::remove(path.c_str());
+}